@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace bento
+{
+	// 32 bit generational handle: the low bits pick a slot, the high bits count how often that slot has been reused, so a handle
+	// to something already destroyed is told apart from whatever lives in its slot now
+	// the tag keeps handles into different pools from converting into each other
+	template<typename Tag>
+	struct Handle
+	{
+		static constexpr uint32_t INDEX_BITS = 20;
+		static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+		static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+		// generations start at 1, so the default handle is never valid
+		uint32_t value = 0;
+
+		uint32_t index() const { return value & INDEX_MASK; }
+		uint32_t generation() const { return value >> INDEX_BITS; }
+
+		explicit operator bool() const { return value != 0; }
+		bool operator==(Handle other) const { return value == other.value; }
+		bool operator!=(Handle other) const { return value != other.value; }
+	};
+
+	// values stored densely for iteration, reached in O(1) through handles
+	// - erasing moves the last value into the gap, so the dense order (and any pointer or reference into it) isn't stable
+	// - erasing bumps the slot's generation; freed slots are reused most recently freed first
+	// - not thread safe
+	template<typename T, typename Tag = T>
+	class SlotMap
+	{
+	public:
+		using Handle = bento::Handle<Tag>;
+
+		template<typename... Args>
+		Handle emplace(Args&&... args)
+		{
+			uint32_t slot;
+			if (freeHead != NONE)
+			{
+				slot = freeHead;
+				freeHead = slots[slot].dense;
+			}
+			else
+			{
+				if (slots.size() > Handle::INDEX_MASK)
+				{
+					throw std::runtime_error("slot map is full!");
+				}
+
+				slot = static_cast<uint32_t>(slots.size());
+				slots.push_back({ NONE, 1 });
+			}
+
+			slots[slot].dense = static_cast<uint32_t>(values.size());
+			values.emplace_back(std::forward<Args>(args)...);
+			owners.push_back(slot);
+
+			return makeHandle(slot);
+		}
+
+		// nullptr if the handle is stale or was never valid
+		T* get(Handle handle)
+		{
+			const uint32_t slot = handle.index();
+			// a freed slot's generation has already moved on, so its old handles fail the comparison
+			if (!handle || slot >= slots.size() || slots[slot].generation != handle.generation())
+			{
+				return nullptr;
+			}
+			return &values[slots[slot].dense];
+		}
+
+		const T* get(Handle handle) const { return const_cast<SlotMap*>(this)->get(handle); }
+		bool contains(Handle handle) const { return get(handle) != nullptr; }
+
+		// moves the value out and frees its slot, e.g. to hand it to a deletion queue; nothing if the handle is stale
+		std::optional<T> take(Handle handle)
+		{
+			T* value = get(handle);
+			if (!value)
+			{
+				return std::nullopt;
+			}
+
+			std::optional<T> taken(std::move(*value));
+			remove(handle.index());
+			return taken;
+		}
+
+		bool erase(Handle handle)
+		{
+			if (!get(handle))
+			{
+				return false;
+			}
+
+			remove(handle.index());
+			return true;
+		}
+
+		void clear()
+		{
+			values.clear();
+			owners.clear();
+			slots.clear();
+			freeHead = NONE;
+		}
+
+		// dense iteration
+		size_t size() const { return values.size(); }
+		bool empty() const { return values.empty(); }
+		T& operator[](size_t i) { return values[i]; }
+		const T& operator[](size_t i) const { return values[i]; }
+		auto begin() { return values.begin(); }
+		auto end() { return values.end(); }
+		auto begin() const { return values.begin(); }
+		auto end() const { return values.end(); }
+		// the handle of the value at dense position i
+		Handle handleAt(size_t i) const { return makeHandle(owners[i]); }
+
+		void reserve(size_t count)
+		{
+			values.reserve(count);
+			owners.reserve(count);
+			slots.reserve(count);
+		}
+
+	private:
+		static constexpr uint32_t NONE = UINT32_MAX;
+
+		struct Slot
+		{
+			// position in values while alive; the next free slot while free
+			uint32_t dense;
+			uint32_t generation;
+		};
+
+		Handle makeHandle(uint32_t slot) const
+		{
+			return Handle{ slots[slot].generation << Handle::INDEX_BITS | slot };
+		}
+
+		void remove(uint32_t slot)
+		{
+			const uint32_t dense = slots[slot].dense;
+			const uint32_t last = static_cast<uint32_t>(values.size()) - 1;
+			if (dense != last)
+			{
+				values[dense] = std::move(values[last]);
+				owners[dense] = owners[last];
+				slots[owners[dense]].dense = dense;
+			}
+			values.pop_back();
+			owners.pop_back();
+
+			// generation 0 would make the handle look like the default one
+			uint32_t& generation = slots[slot].generation;
+			generation = (generation + 1) & Handle::GENERATION_MASK;
+			if (generation == 0)
+			{
+				generation = 1;
+			}
+
+			slots[slot].dense = freeHead;
+			freeHead = slot;
+		}
+
+		std::vector<T> values;
+		// the slot owning each value
+		std::vector<uint32_t> owners;
+		std::vector<Slot> slots;
+		uint32_t freeHead = NONE;
+	};
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "memory.h"
+
+// the replaceable global operator new and delete, counting into memory::heapAllocations
+// they define rather than declare, so include this in exactly one translation unit of each executable; entryPoint.h
+// already does. kept out of the static library on purpose: the linker only pulls an object out of a library for a symbol
+// nothing else defines, and the runtime's own operator new always is one, so a replacement in there would only ever be
+// linked by accident
+#if BENTO_COUNT_ALLOCATIONS
+// the array and nothrow forms call these, so they are counted too
+void* operator new(std::size_t size)
+{
+	bento::memory::countHeapAllocation();
+
+	if (void* pointer = std::malloc(size ? size : 1))
+	{
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	bento::memory::countHeapAllocation();
+
+	const std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _MSC_VER
+	void* pointer = _aligned_malloc(size ? size : 1, align);
+#else
+	void* pointer = std::aligned_alloc(align, ((size ? size : 1) + align - 1) & ~(align - 1));
+#endif
+	if (pointer)
+	{
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+#ifdef _MSC_VER
+	_aligned_free(pointer);
+#else
+	std::free(pointer);
+#endif
+}
+
+// what the compiler calls when it knows the size; left to the runtime they might not end up in the frees above
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(pointer, alignment);
+}
+#endif
@@ -4,11 +4,15 @@
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 #include "log.h"
+#include "profiler.h"
 
 namespace bento
 {
+	application* application::s_Instance = nullptr;
+
 	application::application()
 	{
+		s_Instance = this;
 	}
 
 
@@ -28,12 +32,15 @@ namespace bento
 		glfwSetWindowUserPointer(window.getHandle(), &renderer);
 		glfwSetFramebufferSizeCallback(window.getHandle(), Renderer::framebufferResizeCallback);
 
-		auto& plane = renderer.meshFactory.create(Plane::vertices, Plane::indices, glm::vec3(1.0f, 0.0f, 0.0f));
-		auto& quad = renderer.meshFactory.create(Quad::vertices, Quad::indices, glm::vec3(0.0f, 0.0f, 0.0f));
+		BENTO_LOG_INFO("initialized");
+	}
 
-		renderer.rebuildCommandBuffers();
+	void application::initializeHeadless(int width, int height)
+	{
+		headless = true;
+		renderer.initializeHeadless(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
 
-		log::info("initialized");
+		BENTO_LOG_INFO("initialized headless");
 	}
 
 	void application::run()
@@ -42,19 +49,72 @@ namespace bento
 		uint32_t extensionCount = 0;
 		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
 
-		log::info("extensions supported: {0}", extensionCount);
+		BENTO_LOG_INFO("extensions supported: {0}", extensionCount);
 
 		glm::mat4 matrix;
 		glm::vec4 vec;
 		auto test = matrix * vec;
 
+		profiler::setThreadName("main");
+
 		start();
-		while (!glfwWindowShouldClose(window.getHandle()))
+		// restart the clock so the time spent loading isn't simulated
+		clock = frameClock();
+
+		// from here on the renderer draws on its own thread; this one simulates and packs frames for it
+		renderer.startRenderThread();
+		try
 		{
-			glfwPollEvents();
+			loop();
+		}
+		catch (...)
+		{
+			renderer.stopRenderThread();
+			throw;
+		}
+		renderer.stopRenderThread();
+
+		renderer.flushReadbacks();
+	}
+
+	void application::loop()
+	{
+		while (running && (headless || !glfwWindowShouldClose(window.getHandle())))
+		{
+			// the budget is slept off before input is read rather than after, so the wait doesn't add to the latency
+			pacer.wait();
+
+			if (justInTimeInput)
+			{
+				renderer.waitForPreviousFrame();
+			}
+
+			if (!headless)
+			{
+				glfwPollEvents();
+				inputTime = profiler::now();
+			}
 			//ImGui_ImplGLFW
-			update();
-			render();
+
+			// offline frames are one simulation step apart no matter how long they take to render
+			if (headless)
+			{
+				clock.advance(clock.getFixedDelta());
+			}
+			else
+			{
+				clock.tick();
+			}
+
+			while (clock.step())
+			{
+				update(clock.getFixedDelta());
+			}
+			// offline frames line up exactly with steps, so there is nothing to blend
+			render(headless ? 1.0f : clock.getAlpha());
+
+			const FrameStats& stats = renderer.getFrameStats();
+			profiler::endFrame(stats.waitTime, stats.gpuTime);
 		}
 	}
 
@@ -62,8 +122,13 @@ namespace bento
 	{
 		renderer.clean();
 		glfwTerminate();
-		log::info("cleaned");
-		system("pause\n");
+		BENTO_LOG_INFO("cleaned");
+
+		// nobody is watching the console on a build machine
+		if (!headless)
+		{
+			system("pause\n");
+		}
 	}
 
 	void application::pushState(state* state)
@@ -81,14 +146,17 @@ namespace bento
 		stack.top()->start();
 	}
 
-	void application::update()
+	void application::update(float delta)
 	{
-		stack.top()->update();
+		BENTO_PROFILE_FUNCTION();
+		stack.top()->update(delta);
 	}
 
-	void application::render()
+	void application::render(float alpha)
 	{
-		renderer.drawFrame();
-		stack.top()->render();
+		BENTO_PROFILE_FUNCTION();
+		renderer.beginFrame(static_cast<float>(clock.getTime()), inputTime);
+		stack.top()->render(alpha);
+		renderer.submitFrame();
 	}
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include "Window.h"
 #include "stateStack.h"
+#include "frameClock.h"
+#include "framePacer.h"
 #include "bento/renderer/Renderer.h"
 
 int main(int argc, char** argv);
@@ -14,20 +16,49 @@ namespace bento
 		~application();
 
 		void initialize(const char* title, int screenWidth, int screenHeight);
+		// no window; frames are rendered offscreen and can be read back through the renderer
+		void initializeHeadless(int width, int height);
 		void run();
 		void clean();
 
+		// stops the main loop after the current frame
+		void close() { running = false; }
+		bool isHeadless() const { return headless; }
+
+		// caps how often frames are started; 0 (the default) leaves the pace to the present mode
+		void setFrameLimit(double framesPerSecond) { pacer.setFrameLimit(framesPerSecond); }
+		// waits for the gpu to finish the frame before the last one submitted before sampling input and simulating, so at most
+		// one frame is rendering ahead of the input; off by default since it costs throughput when the cpu is the bottleneck
+		// (the wait ends when rendering does, so presentation itself can still add a frame or so of the display's queue)
+		void setJustInTimeInput(bool enabled) { justInTimeInput = enabled; }
+
 		void pushState(state* state);
 		void popState();
 
+		Renderer& getRenderer() { return renderer; }
+		frameClock& getClock() { return clock; }
+
+		static application& get() { return *s_Instance; }
+
 	private:
+		static application* s_Instance;
+
 		Window window;
 		Renderer renderer;
 		stateStack stack;
+		frameClock clock;
+		framePacer pacer;
+
+		bool headless = false;
+		bool running = true;
+		bool justInTimeInput = false;
+		// when the input for the frame being built was polled
+		int64_t inputTime = 0;
 
 		void start();
-		void update();
-		void render();
+		void loop();
+		void update(float delta);
+		void render(float alpha);
 
 		friend int ::main(int argc, char** argv);
 	};
@@ -1,30 +1,54 @@
 #pragma once
+#include <cstring>
 #include <vulkan/vulkan.hpp>
 
+#include "allocationHooks.h"
+
 extern bento::application* bento::createApplication();
 
 int main(int argc, char** argv)
 {
-	bento::log::initialize();
+	bento::log::initialize(true);
+
+	// --headless renders offscreen without a window (servers, ci)
+	bool headless = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+		}
+	}
 
 	auto app = bento::createApplication();
-	app->initialize("Vulkan window", 800, 600);
+	if (headless)
+	{
+		app->initializeHeadless(800, 600);
+	}
+	else
+	{
+		app->initialize("Vulkan window", 800, 600);
+	}
 	try
 	{
 		app->run();
 	}
 	catch (vk::SystemError & err)
 	{
-		bento::log::error("vk::SystemError: {}", err.what());
+		BENTO_LOG_ERROR("vk::SystemError: {}", err.what());
+		bento::log::shutdown();
 		exit(-1);
 	}
 	catch (std::exception & err)
 	{
-		bento::log::error(err.what());
+		BENTO_LOG_ERROR(err.what());
+		bento::log::shutdown();
 		exit(-1);
 	}
 	app->clean();
 	delete app;
 
+	bento::log::shutdown();
+
 	return 0;
 }
\ No newline at end of file
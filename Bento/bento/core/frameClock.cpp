@@ -0,0 +1,52 @@
+#include "bpch.h"
+#include "frameClock.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace bento
+{
+	frameClock::frameClock()
+		: lastTick(Clock::now())
+	{
+	}
+
+	void frameClock::tick()
+	{
+		const Clock::time_point now = Clock::now();
+		const double elapsed = std::chrono::duration<double>(now - lastTick).count();
+		lastTick = now;
+
+		advance(elapsed);
+	}
+
+	void frameClock::advance(double seconds)
+	{
+		seconds = std::min(std::max(seconds, 0.0), maxFrameDelta);
+
+		frameDelta = static_cast<float>(seconds);
+		accumulator += seconds;
+		steps = 0;
+	}
+
+	bool frameClock::step()
+	{
+		if (accumulator < fixedDelta)
+		{
+			return false;
+		}
+
+		if (steps >= maxSteps)
+		{
+			// too far behind to catch up this frame; keep only the partial step so rendering stays smooth
+			accumulator = std::fmod(accumulator, static_cast<double>(fixedDelta));
+			return false;
+		}
+
+		accumulator -= fixedDelta;
+		time += fixedDelta;
+		stepCount++;
+		steps++;
+		return true;
+	}
+}
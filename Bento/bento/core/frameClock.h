@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace bento
+{
+	// drives a fixed timestep simulation from a variable rate render loop
+	// - tick (or advance) once per frame adds the elapsed time to an accumulator
+	// - step consumes it in fixed increments; call update for as long as it returns true
+	// - whatever is left over is the alpha between the last two simulated states to render at
+	class frameClock
+	{
+	public:
+		frameClock();
+
+		// measures real time since the previous tick; long stalls (breakpoints, loading) are clamped so the simulation doesn't spiral
+		void tick();
+		// advances by an exact amount instead of real time, e.g. one step per frame when rendering offline
+		void advance(double seconds);
+
+		bool step();
+
+		void setFixedDelta(float seconds) { fixedDelta = seconds; }
+		// the most steps a single frame may run; the rest of the backlog is dropped
+		void setMaxSteps(uint32_t steps) { maxSteps = steps; }
+
+		float getFixedDelta() const { return fixedDelta; }
+		// time the last frame took, after clamping
+		float getFrameDelta() const { return frameDelta; }
+		// how far between the previous and current simulation step the frame being rendered is, in [0, 1)
+		float getAlpha() const { return static_cast<float>(accumulator / fixedDelta); }
+		// simulated seconds; only ever moves in fixed steps
+		double getTime() const { return time; }
+		uint64_t getStepCount() const { return stepCount; }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		Clock::time_point lastTick;
+
+		float fixedDelta = 1.0f / 60.0f;
+		float frameDelta = 0.0f;
+		uint32_t maxSteps = 8;
+		uint32_t steps = 0;
+
+		double accumulator = 0.0;
+		double time = 0.0;
+		uint64_t stepCount = 0;
+
+		static constexpr double maxFrameDelta = 0.25;
+	};
+}
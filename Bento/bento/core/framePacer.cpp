@@ -0,0 +1,49 @@
+#include "bpch.h"
+#include "framePacer.h"
+
+#include "profiler.h"
+
+namespace bento
+{
+	void framePacer::setFrameLimit(double framesPerSecond)
+	{
+		frameLimit = std::max(framesPerSecond, 0.0);
+		interval = frameLimit > 0.0
+			? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frameLimit))
+			: Clock::duration::zero();
+		next = Clock::time_point();
+	}
+
+	void framePacer::wait()
+	{
+		if (interval == Clock::duration::zero())
+		{
+			return;
+		}
+
+		const Clock::time_point now = Clock::now();
+
+		// first frame, or too far behind to be worth catching up
+		if (next == Clock::time_point() || now > next + interval)
+		{
+			next = now + interval;
+			return;
+		}
+
+		if (now < next)
+		{
+			BENTO_PROFILE_SCOPE("frame limiter");
+
+			if (next - now > spinMargin)
+			{
+				std::this_thread::sleep_until(next - spinMargin);
+			}
+			while (Clock::now() < next)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		next += interval;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+
+namespace bento
+{
+	// cpu side frame limiter; sleeps off whatever is left of each frame's budget
+	// - frames are scheduled on a fixed grid, so a slightly late frame is made up by the next one
+	// - a frame more than a whole interval late restarts the grid instead of bursting to catch up
+	class framePacer
+	{
+	public:
+		// 0 removes the limit
+		void setFrameLimit(double framesPerSecond);
+		double getFrameLimit() const { return frameLimit; }
+
+		// call once per frame; returns once the next frame is due
+		void wait();
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		double frameLimit = 0.0;
+		Clock::duration interval = Clock::duration::zero();
+		Clock::time_point next;
+
+		// sleeping is only accurate to a millisecond or two (more on windows), so the end of the wait is spun
+		static constexpr std::chrono::microseconds spinMargin = std::chrono::microseconds(2000);
+	};
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace bento
+{
+	// 64 bit FNV-1a; used to identify assets by content and to key small things (paths, material state)
+	// pass a previous result as the seed to hash several buffers as one
+	constexpr uint64_t hashSeed = 14695981039346656037ull;
+
+	inline uint64_t hash(const void* data, size_t size, uint64_t seed = hashSeed)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+		uint64_t result = seed;
+		for (size_t i = 0; i < size; i++)
+		{
+			result ^= bytes[i];
+			result *= 1099511628211ull;
+		}
+
+		return result;
+	}
+
+	// 64 bit hash that consumes eight bytes per step instead of one, for large buffers (checksums of serialized data)
+	// unrelated to hash above, so the two can be used together as independent checks. the words are read in the
+	// machine's byte order, so results are only comparable between machines of the same endianness
+	inline uint64_t hashWords(const void* data, size_t size, uint64_t seed = hashSeed)
+	{
+		constexpr uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+		auto mix = [](uint64_t value)
+		{
+			value ^= value >> 33;
+			value *= 0xff51afd7ed558ccdull;
+			value ^= value >> 33;
+			return value;
+		};
+
+		uint64_t result = seed ^ (static_cast<uint64_t>(size) * multiplier);
+
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+			result = (result ^ mix(word * multiplier)) * multiplier;
+		}
+
+		// the last few bytes as one zero padded word; the length mixed in above tells paddings apart
+		if (i < size)
+		{
+			uint64_t word = 0;
+			std::memcpy(&word, bytes + i, size - i);
+			result = (result ^ mix(word * multiplier)) * multiplier;
+		}
+
+		return mix(result);
+	}
+}
@@ -1,6 +1,10 @@
 #include "bpch.h"
 #include "log.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 namespace bento
@@ -8,7 +12,106 @@ namespace bento
 	std::shared_ptr<spdlog::logger> log::s_CoreLogger;
 	// std::shared_ptr<spdlog::logger> log::s_ClientLogger;
 
-	void log::initialize()
+	std::atomic<bool> log::s_Async = false;
+
+	namespace
+	{
+		// bounded multi producer queue (Vyukov); each cell's sequence number says whether it is free to write or ready to read
+		// must be a power of two
+		constexpr size_t queueSize = 4096;
+
+		struct Message
+		{
+			spdlog::log_clock::time_point time;
+			spdlog::level::level_enum level;
+			size_t length;
+			char text[240];
+		};
+
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			Message message;
+		};
+
+		struct AsyncBackend
+		{
+			std::unique_ptr<Cell[]> cells;
+			std::atomic<size_t> enqueuePosition = 0;
+			// only touched by the flush thread
+			size_t dequeuePosition = 0;
+
+			std::atomic<bool> running = false;
+			std::thread thread;
+
+			AsyncBackend()
+				: cells(new Cell[queueSize])
+			{
+				for (size_t i = 0; i < queueSize; i++)
+				{
+					cells[i].sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+			bool tryEnqueue(spdlog::level::level_enum level, const char* text, size_t length)
+			{
+				size_t position = enqueuePosition.load(std::memory_order_relaxed);
+				Cell* cell;
+				for (;;)
+				{
+					cell = &cells[position & (queueSize - 1)];
+					const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+					const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+					if (difference == 0)
+					{
+						if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+					}
+					else if (difference < 0)
+					{
+						// full
+						return false;
+					}
+					else
+					{
+						position = enqueuePosition.load(std::memory_order_relaxed);
+					}
+				}
+
+				cell->message.time = spdlog::log_clock::now();
+				cell->message.level = level;
+				cell->message.length = length;
+				std::memcpy(cell->message.text, text, length);
+
+				cell->sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+
+			// writes everything currently queued; returns false if there was nothing
+			bool flush(spdlog::logger& logger)
+			{
+				bool wrote = false;
+				for (;;)
+				{
+					Cell& cell = cells[dequeuePosition & (queueSize - 1)];
+					if (cell.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) break;
+
+					const Message& message = cell.message;
+					logger.log(message.time, spdlog::source_loc{}, message.level, spdlog::string_view_t(message.text, message.length));
+
+					cell.sequence.store(dequeuePosition + queueSize, std::memory_order_release);
+					dequeuePosition++;
+					wrote = true;
+				}
+
+				return wrote;
+			}
+		};
+
+		std::unique_ptr<AsyncBackend> backend;
+	}
+
+	void log::initialize(bool async)
 	{
 		// set logging pattern
 		spdlog::set_pattern("%^[%T] %n: %v%$");
@@ -18,5 +121,51 @@ namespace bento
 
 		// s_ClientLogger = spdlog::stdout_color_mt("app");
 		// s_ClientLogger->set_level(spdlog::level::trace);
+
+		if (async)
+		{
+			// everything the background thread needs is allocated here, up front
+			backend = std::make_unique<AsyncBackend>();
+			backend->running = true;
+			backend->thread = std::thread([]()
+			{
+				while (backend->running.load(std::memory_order_acquire))
+				{
+					if (!backend->flush(*s_CoreLogger))
+					{
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					}
+				}
+
+				// pick up anything queued while stopping
+				backend->flush(*s_CoreLogger);
+				s_CoreLogger->flush();
+			});
+
+			s_Async.store(true, std::memory_order_release);
+		}
+	}
+
+	void log::shutdown()
+	{
+		if (!s_Async.exchange(false, std::memory_order_acq_rel))
+		{
+			return;
+		}
+
+		backend->running.store(false, std::memory_order_release);
+		backend->thread.join();
+		backend.reset();
+	}
+
+	void log::enqueue(spdlog::level::level_enum level, const char* text, size_t length)
+	{
+		static_assert(sizeof(Message::text) == maxMessageLength, "message buffer must match maxMessageLength");
+
+		// never drop a message; if the flush thread has fallen this far behind, wait for it
+		while (!backend->tryEnqueue(level, text, length))
+		{
+			std::this_thread::yield();
+		}
 	}
 }
@@ -1,28 +1,77 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 
 #include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
 #include "core.h"
 
+// messages below BENTO_LOG_LEVEL are compiled out; release builds keep info and above
+#define BENTO_LOG_LEVEL_TRACE 0
+#define BENTO_LOG_LEVEL_INFO 1
+#define BENTO_LOG_LEVEL_WARN 2
+#define BENTO_LOG_LEVEL_ERROR 3
+#define BENTO_LOG_LEVEL_OFF 4
+
+#ifndef BENTO_LOG_LEVEL
+	#if defined(NDEBUG) || (defined(_MSC_VER) && !defined(_DEBUG))
+		#define BENTO_LOG_LEVEL BENTO_LOG_LEVEL_INFO
+	#else
+		#define BENTO_LOG_LEVEL BENTO_LOG_LEVEL_TRACE
+	#endif
+#endif
+
+// log through these rather than calling log:: directly: a compiled out message doesn't evaluate its arguments either
+// (they sit in an unevaluated sizeof, so they still have to compile and don't trip unused variable warnings)
+#define BENTO_LOG_DISCARD(call) ((void)sizeof((call, 0)))
+
+#if BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_TRACE
+	#define BENTO_LOG_TRACE(...) ::bento::log::trace(__VA_ARGS__)
+#else
+	#define BENTO_LOG_TRACE(...) BENTO_LOG_DISCARD(::bento::log::trace(__VA_ARGS__))
+#endif
+
+#if BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_INFO
+	#define BENTO_LOG_INFO(...) ::bento::log::info(__VA_ARGS__)
+#else
+	#define BENTO_LOG_INFO(...) BENTO_LOG_DISCARD(::bento::log::info(__VA_ARGS__))
+#endif
+
+#if BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_WARN
+	#define BENTO_LOG_WARN(...) ::bento::log::warn(__VA_ARGS__)
+#else
+	#define BENTO_LOG_WARN(...) BENTO_LOG_DISCARD(::bento::log::warn(__VA_ARGS__))
+#endif
+
+#if BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_ERROR
+	#define BENTO_LOG_ERROR(...) ::bento::log::error(__VA_ARGS__)
+#else
+	#define BENTO_LOG_ERROR(...) BENTO_LOG_DISCARD(::bento::log::error(__VA_ARGS__))
+#endif
+
 namespace bento
 {
 	class log
 	{
 	public:
-		static void initialize();
+		// async formats on the calling thread into a preallocated ring and leaves the console i/o to a background thread
+		static void initialize(bool async = false);
+		// writes out anything still queued and stops the background thread; no other thread may be logging
+		static void shutdown();
 
-		template<typename FormatString, typename... Args> static void trace(const FormatString& fmt, const Args&... args) { GetLogger()->trace(fmt, args...); }
-		template<typename T> static void trace(const T& msg) { GetLogger()->trace(msg); }
+		template<typename FormatString, typename... Args> static void trace(const FormatString& fmt, const Args&... args) { if constexpr (BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_TRACE) write(spdlog::level::trace, fmt, args...); }
+		template<typename T> static void trace(const T& msg) { if constexpr (BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_TRACE) write(spdlog::level::trace, "{}", msg); }
 
-		template<typename FormatString, typename... Args> static void info(const FormatString& fmt, const Args&... args) { GetLogger()->info(fmt, args...); }
-		static void info(const char* msg) { GetLogger()->info(msg); }
+		template<typename FormatString, typename... Args> static void info(const FormatString& fmt, const Args&... args) { if constexpr (BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_INFO) write(spdlog::level::info, fmt, args...); }
+		template<typename T> static void info(const T& msg) { if constexpr (BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_INFO) write(spdlog::level::info, "{}", msg); }
 
-		template<typename FormatString, typename... Args> static void warn(const FormatString& fmt, const Args&... args) { GetLogger()->warn(fmt, args...); }
-		template<typename T> static void warn(const T& msg) { GetLogger()->warn(msg); }
+		template<typename FormatString, typename... Args> static void warn(const FormatString& fmt, const Args&... args) { if constexpr (BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_WARN) write(spdlog::level::warn, fmt, args...); }
+		template<typename T> static void warn(const T& msg) { if constexpr (BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_WARN) write(spdlog::level::warn, "{}", msg); }
 
-		template<typename FormatString, typename... Args> static void error(const FormatString& fmt, const Args&... args) { GetLogger()->error(fmt, args...); }
-		template<typename T> static void error(const T& msg) { GetLogger()->error(msg); }
+		template<typename FormatString, typename... Args> static void error(const FormatString& fmt, const Args&... args) { if constexpr (BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_ERROR) write(spdlog::level::err, fmt, args...); }
+		template<typename T> static void error(const T& msg) { if constexpr (BENTO_LOG_LEVEL <= BENTO_LOG_LEVEL_ERROR) write(spdlog::level::err, "{}", msg); }
 
 		//inline static std::shared_ptr<spdlog::logger>& GetCoreLogger() { return s_CoreLogger; }
 		//inline static std::shared_ptr<spdlog::logger>& GetClientLogger() { return s_ClientLogger; }
@@ -35,6 +84,30 @@ namespace bento
 	private:
 		static std::shared_ptr<spdlog::logger> s_CoreLogger;
 		//static std::shared_ptr<spdlog::logger> s_ClientLogger;
+
+		// read by every logging thread, so it has to be atomic even though it only changes in initialize and shutdown
+		static std::atomic<bool> s_Async;
+
+		// longer messages are truncated when logging asynchronously
+		static constexpr size_t maxMessageLength = 240;
+
+		template<typename FormatString, typename... Args>
+		static void write(spdlog::level::level_enum level, const FormatString& fmt, const Args&... args)
+		{
+			if (!s_Async.load(std::memory_order_acquire))
+			{
+				GetLogger()->log(level, fmt, args...);
+				return;
+			}
+
+			if (!GetLogger()->should_log(level)) return;
+
+			char text[maxMessageLength];
+			const auto result = fmt::format_to_n(text, maxMessageLength, fmt, args...);
+			enqueue(level, text, std::min(result.size, maxMessageLength));
+		}
+
+		static void enqueue(spdlog::level::level_enum level, const char* text, size_t length);
 	};
 
 }
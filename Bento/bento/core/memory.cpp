@@ -0,0 +1,86 @@
+#include "bpch.h"
+#include "memory.h"
+
+#include <atomic>
+
+namespace bento
+{
+	namespace
+	{
+		std::atomic<uint64_t> heapAllocationCount = 0;
+		thread_local uint64_t threadHeapAllocationCount = 0;
+
+		size_t alignUp(size_t value, size_t alignment)
+		{
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+	}
+
+	linearArena::linearArena(size_t capacity)
+		: block(std::make_unique<std::byte[]>(capacity)), capacity(capacity)
+	{
+	}
+
+	linearArena::~linearArena() = default;
+
+	void* linearArena::allocate(size_t size, size_t alignment)
+	{
+		// aligned relative to the block, which new aligns for max_align_t
+		const size_t offset = alignUp(used, alignment);
+		if (alignment <= alignof(std::max_align_t) && offset + size <= capacity)
+		{
+			used = offset + size;
+			return block.get() + offset;
+		}
+
+		// didn't fit (or needs more alignment than the block has); kept until the reset, which grows the block to fit next time
+		overflowBytes += size + alignment;
+		overflow.push_back(std::make_unique<std::byte[]>(size + alignment));
+		void* pointer = overflow.back().get();
+		size_t space = size + alignment;
+		return std::align(alignment, size, pointer, space);
+	}
+
+	void linearArena::reset()
+	{
+		const size_t total = used + overflowBytes;
+		if (total > highWater)
+		{
+			highWater = total;
+		}
+
+		if (!overflow.empty())
+		{
+			overflow.clear();
+			overflowBytes = 0;
+
+			// with some headroom, so a slowly growing frame doesn't reallocate every time
+			capacity = alignUp(highWater + highWater / 2, alignof(std::max_align_t));
+			block = std::make_unique<std::byte[]>(capacity);
+		}
+
+		used = 0;
+	}
+
+	linearArena& memory::threadArena()
+	{
+		thread_local linearArena arena;
+		return arena;
+	}
+
+	void memory::countHeapAllocation()
+	{
+		heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+		threadHeapAllocationCount++;
+	}
+
+	uint64_t memory::heapAllocations()
+	{
+		return heapAllocationCount.load(std::memory_order_relaxed);
+	}
+
+	uint64_t memory::threadHeapAllocations()
+	{
+		return threadHeapAllocationCount;
+	}
+}
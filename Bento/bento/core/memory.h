@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// counts every heap allocation made through operator new; compiled out when BENTO_COUNT_ALLOCATIONS is 0
+// the counting operator new lives in allocationHooks.h, which each executable has to include once (entryPoint.h does)
+#ifndef BENTO_COUNT_ALLOCATIONS
+	#define BENTO_COUNT_ALLOCATIONS 1
+#endif
+
+namespace bento
+{
+	// bump allocator for data that only lives until the next reset, e.g. for one frame or one job
+	// - allocating is a pointer bump, freeing does nothing; everything goes at once on reset
+	// - when a frame asks for more than there is, the rest comes from the heap (and is counted); the next reset
+	//   grows the block to fit, so once it has seen the largest frame it stops touching the heap
+	// - not thread safe; each thread allocates from its own
+	class linearArena
+	{
+	public:
+		explicit linearArena(size_t capacity = defaultCapacity);
+		~linearArena();
+
+		linearArena(const linearArena&) = delete;
+		linearArena& operator=(const linearArena&) = delete;
+
+		void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		template<typename T>
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		// frees everything allocated since the last reset
+		void reset();
+
+		// a point to rewind to, for a job that only needs its allocations while it runs
+		size_t mark() const { return used; }
+		void rewind(size_t marker) { used = marker; }
+
+		size_t getUsed() const { return used; }
+		size_t getCapacity() const { return capacity; }
+		// the most any reset has seen allocated, overflow included
+		size_t getHighWater() const { return highWater; }
+		// allocations that didn't fit since the last reset
+		uint32_t getOverflows() const { return static_cast<uint32_t>(overflow.size()); }
+
+		static constexpr size_t defaultCapacity = 256 * 1024;
+
+	private:
+		std::unique_ptr<std::byte[]> block;
+		size_t capacity = 0;
+		size_t used = 0;
+		size_t highWater = 0;
+
+		size_t overflowBytes = 0;
+		std::vector<std::unique_ptr<std::byte[]>> overflow;
+	};
+
+	// rewinds an arena to where it was when the scope started
+	class arenaScope
+	{
+	public:
+		explicit arenaScope(linearArena& arena) : arena(arena), marker(arena.mark()) {}
+		~arenaScope() { arena.rewind(marker); }
+
+		arenaScope(const arenaScope&) = delete;
+		arenaScope& operator=(const arenaScope&) = delete;
+
+	private:
+		linearArena& arena;
+		size_t marker;
+	};
+
+	// lets standard containers allocate from an arena; deallocating does nothing, so the container must not outlive
+	// the arena's next reset (or the scope it was made in)
+	template<typename T>
+	class arenaAllocator
+	{
+	public:
+		using value_type = T;
+
+		arenaAllocator(linearArena& arena) : arena(&arena) {}
+		template<typename U>
+		arenaAllocator(const arenaAllocator<U>& other) : arena(other.getArena()) {}
+
+		T* allocate(size_t count) { return arena->allocate<T>(count); }
+		void deallocate(T*, size_t) {}
+
+		linearArena* getArena() const { return arena; }
+
+		template<typename U>
+		bool operator==(const arenaAllocator<U>& other) const { return arena == other.getArena(); }
+		template<typename U>
+		bool operator!=(const arenaAllocator<U>& other) const { return arena != other.getArena(); }
+
+	private:
+		linearArena* arena;
+	};
+
+	template<typename T>
+	using arenaVector = std::vector<T, arenaAllocator<T>>;
+
+	class memory
+	{
+	public:
+		// the calling thread's arena, created the first time it is asked for; whoever runs jobs on the thread resets it
+		// (or scopes each job with an arenaScope)
+		static linearArena& threadArena();
+
+		// heap allocations made so far, by every thread and by the calling thread; both 0 when counting is compiled out
+		static uint64_t heapAllocations();
+		static uint64_t threadHeapAllocations();
+
+		// for the replacement operator new
+		static void countHeapAllocation();
+	};
+}
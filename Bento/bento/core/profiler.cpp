@@ -0,0 +1,233 @@
+#include "bpch.h"
+#include "profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#include "log.h"
+
+namespace bento
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point epoch = Clock::now();
+
+		// per thread; must be a power of two. a full buffer drops new zones until the next drain
+		constexpr uint64_t eventBufferSize = 16384;
+		constexpr uint32_t gpuTrack = 0xffff;
+
+		struct EventBuffer
+		{
+			std::array<profiler::Event, eventBufferSize> events;
+			// head is only written by the owning thread, tail only by the main thread
+			std::atomic<uint64_t> head = 0;
+			std::atomic<uint64_t> tail = 0;
+			std::atomic<uint64_t> dropped = 0;
+
+			uint32_t track = 0;
+			std::string name;
+		};
+
+		// only locked when a thread records for the first time and when draining, never per zone
+		std::mutex buffersMutex;
+		std::vector<std::unique_ptr<EventBuffer>> buffers;
+
+		std::atomic<bool> capturing = false;
+		std::vector<profiler::Event> captured;
+
+		std::array<profiler::FrameTiming, profiler::frameHistorySize> history;
+		size_t historyCursor = 0;
+		int64_t lastFrameEnd = -1;
+
+		EventBuffer& threadBuffer()
+		{
+			thread_local EventBuffer* buffer = nullptr;
+			if (!buffer)
+			{
+				std::lock_guard<std::mutex> lock(buffersMutex);
+				buffers.push_back(std::make_unique<EventBuffer>());
+				buffer = buffers.back().get();
+				buffer->track = static_cast<uint32_t>(buffers.size() - 1);
+				buffer->name = "thread " + std::to_string(buffer->track);
+			}
+
+			return *buffer;
+		}
+
+		void push(EventBuffer& buffer, const profiler::Event& event)
+		{
+			const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+			const uint64_t tail = buffer.tail.load(std::memory_order_acquire);
+			if (head - tail >= eventBufferSize)
+			{
+				buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			buffer.events[head & (eventBufferSize - 1)] = event;
+			buffer.head.store(head + 1, std::memory_order_release);
+		}
+
+		// empties every thread's buffer, keeping the events if a capture is running
+		void drain(bool keep)
+		{
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			for (auto& buffer : buffers)
+			{
+				const uint64_t head = buffer->head.load(std::memory_order_acquire);
+				const uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+
+				if (keep)
+				{
+					for (uint64_t i = tail; i < head; i++)
+					{
+						captured.push_back(buffer->events[i & (eventBufferSize - 1)]);
+					}
+				}
+
+				buffer->tail.store(head, std::memory_order_release);
+			}
+		}
+
+		void writeEscaped(std::ostream& stream, const char* text)
+		{
+			for (; *text; text++)
+			{
+				if (*text == '"' || *text == '\\') stream << '\\';
+				stream << *text;
+			}
+		}
+	}
+
+	int64_t profiler::now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+	}
+
+	void profiler::record(const char* name, int64_t start, int64_t end)
+	{
+		EventBuffer& buffer = threadBuffer();
+		push(buffer, { name, start, end - start, buffer.track });
+	}
+
+	void profiler::recordGpu(const char* name, int64_t start, int64_t end)
+	{
+		if (!isCapturing()) return;
+		push(threadBuffer(), { name, start, end - start, gpuTrack });
+	}
+
+	void profiler::setThreadName(const char* name)
+	{
+		EventBuffer& buffer = threadBuffer();
+
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		buffer.name = name;
+	}
+
+	void profiler::endFrame(double waitTime, double gpuTime)
+	{
+		const int64_t frameEnd = now();
+
+		if (lastFrameEnd >= 0)
+		{
+			FrameTiming& timing = history[historyCursor];
+			timing.frame = static_cast<float>(static_cast<double>(frameEnd - lastFrameEnd) / 1000000.0);
+			timing.cpu = std::max(0.0f, timing.frame - static_cast<float>(waitTime));
+			timing.gpu = static_cast<float>(gpuTime);
+
+			historyCursor = (historyCursor + 1) % frameHistorySize;
+		}
+		lastFrameEnd = frameEnd;
+
+		drain(isCapturing());
+	}
+
+	const profiler::FrameTiming& profiler::lastFrame()
+	{
+		return history[(historyCursor + frameHistorySize - 1) % frameHistorySize];
+	}
+
+	std::array<profiler::FrameTiming, profiler::frameHistorySize> profiler::frameHistory()
+	{
+		std::array<FrameTiming, frameHistorySize> ordered;
+		for (size_t i = 0; i < frameHistorySize; i++)
+		{
+			ordered[i] = history[(historyCursor + i) % frameHistorySize];
+		}
+
+		return ordered;
+	}
+
+	void profiler::beginCapture()
+	{
+		// anything recorded before the capture started isn't part of it
+		drain(false);
+		captured.clear();
+		capturing.store(true, std::memory_order_relaxed);
+
+		BENTO_LOG_TRACE("Started profiler capture");
+	}
+
+	void profiler::endCapture(const std::string& path)
+	{
+		capturing.store(false, std::memory_order_relaxed);
+		drain(true);
+
+		std::ofstream file(path);
+		if (!file)
+		{
+			throw std::runtime_error("failed to open " + path + " for writing");
+		}
+
+		// chrome trace event format; timestamps are in microseconds
+		file << "{\"traceEvents\":[\n";
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << gpuTrack << ",\"args\":{\"name\":\"gpu\"}}";
+
+		uint64_t dropped = 0;
+		{
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			for (auto& buffer : buffers)
+			{
+				file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->track << ",\"args\":{\"name\":\"";
+				writeEscaped(file, buffer->name.c_str());
+				file << "\"}}";
+
+				dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+			}
+		}
+
+		file.precision(3);
+		file << std::fixed;
+		for (const auto& event : captured)
+		{
+			file << ",\n{\"name\":\"";
+			writeEscaped(file, event.name);
+			file << "\",\"cat\":\"" << (event.track == gpuTrack ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.track
+				<< ",\"ts\":" << static_cast<double>(event.start) / 1000.0
+				<< ",\"dur\":" << static_cast<double>(event.duration) / 1000.0 << "}";
+		}
+		file << "\n]}\n";
+
+		if (!file)
+		{
+			throw std::runtime_error("failed to write " + path);
+		}
+
+		if (dropped > 0)
+		{
+			BENTO_LOG_WARN("Profiler dropped {} zones; a thread recorded more than {} between frames", dropped, eventBufferSize);
+		}
+
+		BENTO_LOG_TRACE("Wrote {} profiler events to {}", captured.size(), path);
+		captured.clear();
+	}
+
+	bool profiler::isCapturing()
+	{
+		return capturing.load(std::memory_order_relaxed);
+	}
+}
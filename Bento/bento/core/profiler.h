@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// scoped cpu zones; compiled out entirely when BENTO_PROFILING is 0
+#ifndef BENTO_PROFILING
+	#define BENTO_PROFILING 1
+#endif
+
+#define BENTO_PROFILE_CONCAT_INNER(a, b) a##b
+#define BENTO_PROFILE_CONCAT(a, b) BENTO_PROFILE_CONCAT_INNER(a, b)
+
+#if BENTO_PROFILING
+	#define BENTO_PROFILE_SCOPE(name) ::bento::profiler::zone BENTO_PROFILE_CONCAT(profileZone, __LINE__)(name)
+	#define BENTO_PROFILE_FUNCTION() BENTO_PROFILE_SCOPE(__FUNCTION__)
+#else
+	#define BENTO_PROFILE_SCOPE(name)
+	#define BENTO_PROFILE_FUNCTION()
+#endif
+
+namespace bento
+{
+	// cpu and gpu timeline profiler
+	// - zones are written to a fixed size buffer owned by the recording thread; no locks or allocations on the hot path
+	// - the main thread drains every buffer once per frame (endFrame), so each buffer has a single producer and consumer
+	// - zones are only kept while a capture is running; captures are exported as chrome trace json (chrome://tracing, perfetto)
+	// - a short history of frame timings is always kept for on screen graphs
+	class profiler
+	{
+	public:
+		// zone names must outlive the capture; string literals and __FUNCTION__ are fine
+		struct Event
+		{
+			const char* name;
+			// nanoseconds since the profiler started
+			int64_t start;
+			int64_t duration;
+			uint32_t track;
+		};
+
+		// milliseconds; cpu is the frame minus the time spent waiting on the gpu
+		struct FrameTiming
+		{
+			float frame = 0.0f;
+			float cpu = 0.0f;
+			float gpu = 0.0f;
+		};
+
+		static constexpr size_t frameHistorySize = 128;
+
+		class zone
+		{
+		public:
+			zone(const char* name)
+				: name(name), start(isCapturing() ? now() : -1) {}
+
+			~zone()
+			{
+				if (start >= 0) record(name, start, now());
+			}
+
+			zone(const zone&) = delete;
+			zone& operator=(const zone&) = delete;
+
+		private:
+			const char* name;
+			int64_t start;
+		};
+
+		static int64_t now();
+
+		static void record(const char* name, int64_t start, int64_t end);
+		// gpu work goes on its own track; times must already be converted to the profiler's clock
+		static void recordGpu(const char* name, int64_t start, int64_t end);
+
+		// names the calling thread's track in exported traces
+		static void setThreadName(const char* name);
+
+		// called once per frame from the main thread
+		static void endFrame(double waitTime, double gpuTime);
+		static const FrameTiming& lastFrame();
+		// oldest first
+		static std::array<FrameTiming, frameHistorySize> frameHistory();
+
+		static void beginCapture();
+		// writes everything recorded since beginCapture; throws if the file can't be written
+		static void endCapture(const std::string& path);
+		static bool isCapturing();
+	};
+}
@@ -7,11 +7,11 @@ namespace bento
 	{
 	}
 
-	void state::update()
+	void state::update(float delta)
 	{
 	}
 
-	void state::render()
+	void state::render(float alpha)
 	{
 	}
 }
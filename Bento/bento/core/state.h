@@ -9,8 +9,10 @@ namespace bento
 		virtual ~state() = default;
 
 		virtual void start();
-		virtual void update();
-		virtual void render();
+		// runs at the application's fixed timestep, possibly several times (or not at all) per frame
+		virtual void update(float delta);
+		// runs once per frame; alpha is how far the frame is between the last two updates
+		virtual void render(float alpha);
 	};
 }
 
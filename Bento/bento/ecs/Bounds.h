@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+namespace bento
+{
+	// axis aligned bounding box
+	struct AABB
+	{
+		glm::vec3 min{0.0f};
+		glm::vec3 max{0.0f};
+
+		AABB() = default;
+		AABB(const glm::vec3& min, const glm::vec3& max)
+			: min(min), max(max) {}
+
+		glm::vec3 center() const { return (min + max) * 0.5f; }
+		glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+		// used as the insertion cost heuristic by the spatial index
+		float surfaceArea() const
+		{
+			const glm::vec3 size = max - min;
+			return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
+
+		bool overlaps(const AABB& other) const
+		{
+			return min.x <= other.max.x && max.x >= other.min.x
+				&& min.y <= other.max.y && max.y >= other.min.y
+				&& min.z <= other.max.z && max.z >= other.min.z;
+		}
+
+		bool contains(const AABB& other) const
+		{
+			return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+				&& max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+		}
+
+		bool operator==(const AABB& other) const { return min == other.min && max == other.max; }
+		bool operator!=(const AABB& other) const { return !(*this == other); }
+
+		static AABB merge(const AABB& a, const AABB& b)
+		{
+			return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+		}
+
+		// bounds of a local space box after transformation (center and absolute-extent form)
+		static AABB transform(const AABB& local, const glm::mat4& matrix)
+		{
+			const glm::vec3 center = glm::vec3(matrix * glm::vec4(local.center(), 1.0f));
+			const glm::vec3 extents = local.extents();
+
+			glm::vec3 worldExtents;
+			for (int i = 0; i < 3; i++)
+			{
+				worldExtents[i] = std::abs(matrix[0][i]) * extents.x + std::abs(matrix[1][i]) * extents.y + std::abs(matrix[2][i]) * extents.z;
+			}
+
+			return AABB(center - worldExtents, center + worldExtents);
+		}
+	};
+
+	struct Ray
+	{
+		glm::vec3 origin{0.0f};
+		glm::vec3 direction{0.0f, 0.0f, -1.0f};
+		float maxDistance = FLT_MAX;
+
+		// slab test; on a hit, entry is the distance at which the ray enters the box (0 if it starts inside)
+		bool intersects(const AABB& bounds, float& entry) const
+		{
+			float enter = 0.0f;
+			float exit = maxDistance;
+
+			for (int i = 0; i < 3; i++)
+			{
+				const float inverse = 1.0f / direction[i];
+				float t0 = (bounds.min[i] - origin[i]) * inverse;
+				float t1 = (bounds.max[i] - origin[i]) * inverse;
+				if (t0 > t1) std::swap(t0, t1);
+
+				enter = t0 > enter ? t0 : enter;
+				exit = t1 < exit ? t1 : exit;
+
+				if (enter > exit) return false;
+			}
+
+			entry = enter;
+			return true;
+		}
+	};
+
+	struct Frustum
+	{
+		enum class Result { Outside, Intersects, Inside };
+
+		// planes point inwards: left, right, bottom, top, near, far
+		std::array<glm::vec4, 6> planes;
+
+		// extracts the planes from a (zero to one depth) view projection matrix
+		static Frustum fromMatrix(const glm::mat4& viewProjection)
+		{
+			const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+			const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+			const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+			const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+			Frustum frustum;
+			frustum.planes = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2 };
+
+			for (auto& plane : frustum.planes)
+			{
+				plane /= glm::length(glm::vec3(plane));
+			}
+
+			return frustum;
+		}
+
+		Result classify(const AABB& bounds) const
+		{
+			const glm::vec3 center = bounds.center();
+			const glm::vec3 extents = bounds.extents();
+
+			Result result = Result::Inside;
+			for (const auto& plane : planes)
+			{
+				const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+				const float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+
+				if (distance < -radius) return Result::Outside;
+				if (distance < radius) result = Result::Intersects;
+			}
+
+			return result;
+		}
+	};
+}
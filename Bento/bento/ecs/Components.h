@@ -1,6 +1,10 @@
 #pragma once
 
+#include <string>
+
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "Bounds.h"
 
 namespace bento
 {
@@ -14,23 +18,92 @@ namespace bento
 			: tag(tag) {}
 	};
 
-	struct TransformComponent
+	// transforms are split into translation, rotation and scale pools (rather than one mat4 per entity)
+	// so the transform system can stream each attribute contiguously and compose world matrices in batches
+
+	struct TranslationComponent
+	{
+		glm::vec3 translation{0.0f};
+
+		TranslationComponent() = default;
+		TranslationComponent(const TranslationComponent&) = default;
+		TranslationComponent(const glm::vec3& translation)
+			: translation(translation) {}
+	};
+
+	struct RotationComponent
+	{
+		// glm::quat takes (w, x, y, z)
+		glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+
+		RotationComponent() = default;
+		RotationComponent(const RotationComponent&) = default;
+		RotationComponent(const glm::quat& rotation)
+			: rotation(rotation) {}
+	};
+
+	struct ScaleComponent
+	{
+		glm::vec3 scale{1.0f};
+
+		ScaleComponent() = default;
+		ScaleComponent(const ScaleComponent&) = default;
+		ScaleComponent(const glm::vec3& scale)
+			: scale(scale) {}
+	};
+
+	// local space bounds; the scene keeps the world space version in its spatial index
+	struct BoundsComponent
 	{
-		glm::mat4 transform{1.0f};
+		AABB bounds{glm::vec3(-0.5f), glm::vec3(0.5f)};
 
-		TransformComponent() = default;
-		TransformComponent(const TransformComponent&) = default;
-		TransformComponent(const glm::mat4& transform)
-			: transform(transform) {}
+		BoundsComponent() = default;
+		BoundsComponent(const BoundsComponent&) = default;
+		BoundsComponent(const AABB& bounds)
+			: bounds(bounds) {}
 	};
 
 	struct MeshComponent
 	{
 		glm::vec4 color{1.0f};
+		// content hash of the mesh to draw (Mesh::getContentHash), resolved through MeshFactory::find
+		uint64_t mesh = 0;
 
 		MeshComponent() = default;
 		MeshComponent(const MeshComponent&) = default;
-		MeshComponent(const glm::vec4& color)
-			: color(color) {}
+		MeshComponent(const glm::vec4& color, uint64_t mesh = 0)
+			: color(color), mesh(mesh) {}
+	};
+
+	// marks an entity whose mesh rarely moves, so the shadows it casts can be cached until its mesh changes or it moves
+	// moving it (patching its translation, rotation or scale) redraws every static shadow, so it should stay the exception
+	struct StaticComponent
+	{
+	};
+
+	// a point or spot light at the entity's translation; spot lights point along the entity's -z
+	// directional lights shine along the entity's -z everywhere and cast shadows; only the first one is used
+	struct LightComponent
+	{
+		enum class Type
+		{
+			Point,
+			Spot,
+			Directional
+		};
+
+		Type type = Type::Point;
+		glm::vec3 color{1.0f};
+		float intensity = 1.0f;
+		// distance at which the light has faded out entirely; also how far it reaches when it is binned into clusters
+		float range = 5.0f;
+		// spot lights only; half angles in radians, fading out from the inner to the outer one
+		float innerAngle = 0.35f;
+		float outerAngle = 0.5f;
+
+		LightComponent() = default;
+		LightComponent(const LightComponent&) = default;
+		LightComponent(const glm::vec3& color, float intensity, float range)
+			: color(color), intensity(intensity), range(range) {}
 	};
-}
\ No newline at end of file
+}
@@ -13,13 +13,14 @@ namespace bento
 		Entity(entt::entity handle, Scene* scene);
 		Entity(const Entity& other) = default;
 
+		// returns the new component, or nothing for empty tag components (entt doesn't store those)
 		template<typename T, typename... Args>
-		T& AddComponent(Args&&... args)
+		decltype(auto) AddComponent(Args&&... args)
 		{
 			// change to assert
 			if (HasComponent<T>())
 			{
-				bento::log::warn("entity already has component");
+				BENTO_LOG_WARN("entity already has component");
 			}
 
 			// don't unpack everything here, forward it off to entt
@@ -32,13 +33,27 @@ namespace bento
 			// change to assert
 			if (!HasComponent<T>())
 			{
-				bento::log::warn("entity does not have component");
+				BENTO_LOG_WARN("entity does not have component");
 			}
 
 			// don't unpack everything here, forward it off to entt
 			return scene->registry.get<T>(entityHandle);
 		}
 
+		// changes a component in place and lets the scene know, e.g. so moved entities are refitted in the spatial index
+		// writing through GetComponent changes the data without anything hearing about it
+		template<typename T, typename... Func>
+		decltype(auto) PatchComponent(Func&&... func)
+		{
+			// change to assert
+			if (!HasComponent<T>())
+			{
+				BENTO_LOG_WARN("entity does not have component");
+			}
+
+			return scene->registry.patch<T>(entityHandle, std::forward<Func>(func)...);
+		}
+
 		template<typename T>
 		bool HasComponent()
 		{
@@ -51,7 +66,7 @@ namespace bento
 			// change to assert
 			if (!HasComponent<T>())
 			{
-				bento::log::warn("entity does not have component");
+				BENTO_LOG_WARN("entity does not have component");
 			}
 
 			scene->registry.remove<T>(entityHandle);
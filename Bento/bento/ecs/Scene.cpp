@@ -2,9 +2,13 @@
 #include "Scene.h"
 #include "Components.h"
 
+#include <cmath>
 #include <glm/mat4x4.hpp>
 #include "bento/core/log.h"
+#include "bento/core/profiler.h"
 #include "Entity.h"
+#include "TransformSystem.h"
+#include "bento/renderer/RenderSubmission.h"
 
 namespace bento
 {
@@ -65,17 +69,61 @@ namespace bento
 
 		//	// do stuff
 		//}
+
+		// keep the spatial index in step with bounds being added and removed
+		registry.on_construct<BoundsComponent>().connect<&Scene::onBoundsConstruct>(*this);
+		registry.on_destroy<BoundsComponent>().connect<&Scene::onBoundsDestroy>(*this);
+		registry.on_update<BoundsComponent>().connect<&Scene::onBoundsUpdate>(*this);
+
+		registry.on_construct<TranslationComponent>().connect<&Scene::onTransformsChanged>(*this);
+		registry.on_construct<RotationComponent>().connect<&Scene::onTransformsChanged>(*this);
+		registry.on_construct<ScaleComponent>().connect<&Scene::onTransformsChanged>(*this);
+		registry.on_destroy<TranslationComponent>().connect<&Scene::onTransformsChanged>(*this);
+		registry.on_destroy<RotationComponent>().connect<&Scene::onTransformsChanged>(*this);
+		registry.on_destroy<ScaleComponent>().connect<&Scene::onTransformsChanged>(*this);
+
+		// moved entities are refitted in the spatial index on the next OnUpdate
+		registry.on_update<TranslationComponent>().connect<&Scene::onTransformUpdate>(*this);
+		registry.on_update<RotationComponent>().connect<&Scene::onTransformUpdate>(*this);
+		registry.on_update<ScaleComponent>().connect<&Scene::onTransformUpdate>(*this);
+
+		registry.on_construct<StaticComponent>().connect<&Scene::onStaticChanged>(*this);
+		registry.on_destroy<StaticComponent>().connect<&Scene::onStaticChanged>(*this);
+		registry.on_construct<MeshComponent>().connect<&Scene::onStaticChanged>(*this);
+		registry.on_update<MeshComponent>().connect<&Scene::onStaticChanged>(*this);
+		registry.on_destroy<MeshComponent>().connect<&Scene::onStaticChanged>(*this);
 	}
 
 	Scene::~Scene()
 	{
+		registry.on_construct<BoundsComponent>().disconnect(*this);
+		registry.on_destroy<BoundsComponent>().disconnect(*this);
+		registry.on_update<BoundsComponent>().disconnect(*this);
+
+		registry.on_construct<TranslationComponent>().disconnect(*this);
+		registry.on_construct<RotationComponent>().disconnect(*this);
+		registry.on_construct<ScaleComponent>().disconnect(*this);
+		registry.on_destroy<TranslationComponent>().disconnect(*this);
+		registry.on_destroy<RotationComponent>().disconnect(*this);
+		registry.on_destroy<ScaleComponent>().disconnect(*this);
+		registry.on_update<TranslationComponent>().disconnect(*this);
+		registry.on_update<RotationComponent>().disconnect(*this);
+		registry.on_update<ScaleComponent>().disconnect(*this);
+
+		registry.on_construct<StaticComponent>().disconnect(*this);
+		registry.on_destroy<StaticComponent>().disconnect(*this);
+		registry.on_construct<MeshComponent>().disconnect(*this);
+		registry.on_update<MeshComponent>().disconnect(*this);
+		registry.on_destroy<MeshComponent>().disconnect(*this);
 	}
 
 	Entity Scene::CreateEntity(const std::string& name)
 	{
 		Entity entity { registry.create(), this };
 
-		entity.AddComponent<TransformComponent>();
+		entity.AddComponent<TranslationComponent>();
+		entity.AddComponent<RotationComponent>();
+		entity.AddComponent<ScaleComponent>();
 		auto& tag = entity.AddComponent<TagComponent>();
 		tag.tag = name.empty() ? "entity" : name;
 
@@ -84,6 +132,28 @@ namespace bento
 
 	void Scene::OnUpdate()
 	{
+		BENTO_PROFILE_FUNCTION();
+
+		// update the index to wherever entities moved this step; most moves stay inside the fattened leaf bounds
+		// anything that didn't move isn't looked at
+		auto moved = registry.view<TransformDirty, BoundsComponent>();
+		for (auto entity : moved)
+		{
+			spatialIndex.update(entity, worldBounds(entity));
+		}
+		registry.clear<TransformDirty>();
+
+		// keep the last two simulated states for OnRender to blend between
+		std::swap(previousTransforms, currentTransforms);
+		TransformSystem::capture(registry, currentTransforms);
+
+		if (transformsChanged)
+		{
+			// the old snapshot is in a different order now; start over from this step
+			previousTransforms = currentTransforms;
+			transformsChanged = false;
+		}
+
 		//auto group = registry.group<TransformComponent>(entt::get<MeshComponent>);
 		//for (auto entity : group)
 		//{
@@ -95,15 +165,184 @@ namespace bento
 		//}
 	}
 
-	void Scene::OnRender()
+	void Scene::OnRender(RenderSubmission& target, float alpha)
+	{
+		BENTO_PROFILE_FUNCTION();
+
+		// lights are sent where the last update left them, without blending
+		packLights(target);
+
+		// compose world matrices straight into the target (for the renderer, the frame's render packet)
+		uint32_t capacity = 0;
+		glm::mat4* instances = target.beginInstances(capacity);
+
+		// entities created or destroyed since the last update have nothing to blend from, so draw them as they are
+		size_t count = 0;
+		if (alpha >= 1.0f || transformsChanged || currentTransforms.size() == 0)
+		{
+			count = TransformSystem::update(registry, instances, capacity);
+		}
+		else
+		{
+			TransformSystem::interpolate(previousTransforms, currentTransforms, alpha, interpolatedTransforms);
+
+			count = std::min(interpolatedTransforms.size(), static_cast<size_t>(capacity));
+			TransformSystem::compose(
+				interpolatedTransforms.translations.data(),
+				interpolatedTransforms.rotations.data(),
+				interpolatedTransforms.scales.data(),
+				count,
+				instances
+			);
+		}
+		target.endInstances(static_cast<uint32_t>(count));
+
+		packDraws(target, static_cast<uint32_t>(count));
+	}
+
+	void Scene::packLights(RenderSubmission& target)
+	{
+		uint32_t capacity = 0;
+		Light* lights = target.beginLights(capacity);
+
+		uint32_t count = 0;
+		bool hasDirectional = false;
+		auto view = registry.view<LightComponent, TranslationComponent>();
+		for (auto entity : view)
+		{
+			const LightComponent& light = view.get<LightComponent>(entity);
+			const glm::quat rotation = registry.has<RotationComponent>(entity) ? registry.get<RotationComponent>(entity).rotation : glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+			// the sun isn't binned into clusters; it lights (and shadows) everything
+			if (light.type == LightComponent::Type::Directional)
+			{
+				if (!hasDirectional)
+				{
+					Light sun;
+					sun.colorIntensity = glm::vec4(light.color, light.intensity);
+					sun.directionCone = glm::vec4(rotation * glm::vec3(0.0f, 0.0f, -1.0f), -2.0f);
+					target.setDirectionalLight(sun);
+					hasDirectional = true;
+				}
+				continue;
+			}
+
+			if (count == capacity)
+			{
+				continue;
+			}
+
+			Light& packed = lights[count++];
+			packed = Light();
+			packed.positionRange = glm::vec4(view.get<TranslationComponent>(entity).translation, light.range);
+			packed.colorIntensity = glm::vec4(light.color, light.intensity);
+
+			if (light.type == LightComponent::Type::Spot)
+			{
+				packed.directionCone = glm::vec4(rotation * glm::vec3(0.0f, 0.0f, -1.0f), std::cos(light.outerAngle));
+				packed.spot.x = std::cos(light.innerAngle);
+			}
+		}
+
+		target.endLights(count);
+	}
+
+	void Scene::packDraws(RenderSubmission& target, uint32_t instanceCount)
 	{
-		auto group = registry.group<TransformComponent>(entt::get<MeshComponent>);
-		for (auto entity : group)
+		uint32_t capacity = 0;
+		MeshDraw* draws = target.beginDraws(capacity);
+
+		// instance i is the world matrix of the i-th entity in the transform group's pool order
+		const entt::entity* entities = TransformSystem::group(registry).data();
+
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < instanceCount && count < capacity; i++)
 		{
-			auto[transform, mesh] = group.get<TransformComponent, MeshComponent>(entity);
-			// draw!
+			const MeshComponent* mesh = registry.try_get<MeshComponent>(entities[i]);
+			if (!mesh || mesh->mesh == 0)
+			{
+				continue;
+			}
 
-			//log::warn("color is r:{0} g:{1} b:{2}", mesh.color.r, mesh.color.g, mesh.color.b);
+			draws[count++] = MeshDraw{ mesh->mesh, i, registry.has<StaticComponent>(entities[i]) };
+		}
+
+		target.endDraws(count, staticVersion);
+	}
+
+	void Scene::QueryFrustum(const glm::mat4& viewProjection, std::vector<entt::entity>& result) const
+	{
+		spatialIndex.queryFrustum(Frustum::fromMatrix(viewProjection), [&](entt::entity entity) { result.push_back(entity); });
+	}
+
+	void Scene::QueryOverlap(const AABB& bounds, std::vector<entt::entity>& result) const
+	{
+		spatialIndex.queryOverlap(bounds, [&](entt::entity entity) { result.push_back(entity); });
+	}
+
+	bool Scene::Raycast(const Ray& ray, entt::entity& hit, float& distance) const
+	{
+		return spatialIndex.raycast(ray, hit, distance);
+	}
+
+	AABB Scene::worldBounds(entt::entity entity) const
+	{
+		const AABB& local = registry.get<BoundsComponent>(entity).bounds;
+		if (!registry.has<TranslationComponent, RotationComponent, ScaleComponent>(entity))
+		{
+			return local;
+		}
+
+		glm::mat4 world;
+		TransformSystem::compose(
+			&registry.get<TranslationComponent>(entity),
+			&registry.get<RotationComponent>(entity),
+			&registry.get<ScaleComponent>(entity),
+			1, &world
+		);
+
+		return AABB::transform(local, world);
+	}
+
+	void Scene::onBoundsConstruct(entt::registry& registry, entt::entity entity)
+	{
+		spatialIndex.insert(entity, worldBounds(entity));
+	}
+
+	void Scene::onBoundsDestroy(entt::registry& registry, entt::entity entity)
+	{
+		spatialIndex.remove(entity);
+	}
+
+	void Scene::onBoundsUpdate(entt::registry& registry, entt::entity entity)
+	{
+		// the local bounds were patched; the transform hasn't changed, so this can't wait for the refit in OnUpdate
+		spatialIndex.update(entity, worldBounds(entity));
+	}
+
+	void Scene::onTransformsChanged(entt::registry& registry, entt::entity entity)
+	{
+		transformsChanged = true;
+	}
+
+	void Scene::onTransformUpdate(entt::registry& registry, entt::entity entity)
+	{
+		if (!registry.has<TransformDirty>(entity))
+		{
+			registry.emplace<TransformDirty>(entity);
+		}
+
+		// a static entity that moved takes its cached shadow with it
+		onStaticChanged(registry, entity);
+	}
+
+	void Scene::onStaticChanged(entt::registry& registry, entt::entity entity)
+	{
+		// destroy signals fire while the component is still there, so removing either component is seen here too
+		// moving a static entity is seen here as well
+		if (registry.has<StaticComponent>(entity))
+		{
+			staticVersion++;
 		}
 	}
 }
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <vector>
+
 #include <entt.hpp>
+#include <glm/mat4x4.hpp>
+#include "SpatialIndex.h"
+#include "TransformSystem.h"
 
 namespace bento
 {
 	class Entity;
+	class RenderSubmission;
 
 	class Scene
 	{
@@ -14,12 +20,47 @@ namespace bento
 
 		Entity CreateEntity(const std::string& name = std::string());
 
+		// call once per fixed step, after moving entities
+		// only entities whose transform was patched (Entity::PatchComponent) since the last step are refitted in the spatial index
 		void OnUpdate();
-		void OnRender();
+		// submits the scene alpha of the way from the previous OnUpdate's transforms to the latest ones
+		// (usually to the renderer, between its beginFrame and submitFrame)
+		void OnRender(RenderSubmission& target, float alpha = 1.0f);
+
+		// spatial queries over entities with a BoundsComponent, using the bounds from the last OnUpdate
+		void QueryFrustum(const glm::mat4& viewProjection, std::vector<entt::entity>& result) const;
+		void QueryOverlap(const AABB& bounds, std::vector<entt::entity>& result) const;
+		bool Raycast(const Ray& ray, entt::entity& hit, float& distance) const;
 
 	private:
+		SpatialIndex spatialIndex;
 		entt::registry registry;
 
+		// transforms as of the last two OnUpdates, and the blend of them that gets rendered
+		TransformSystem::Snapshot previousTransforms;
+		TransformSystem::Snapshot currentTransforms;
+		TransformSystem::Snapshot interpolatedTransforms;
+		// set when transforms are added or removed, which reorders the pools and invalidates the snapshots
+		bool transformsChanged = true;
+		// bumped whenever a static entity's mesh comes, goes, changes or moves; the renderer keeps its static shadows until it does
+		uint64_t staticVersion = 0;
+
+		// tags the entities whose transform was patched since the last OnUpdate
+		struct TransformDirty {};
+
+		AABB worldBounds(entt::entity entity) const;
+		// copies every LightComponent into the frame's render packet
+		void packLights(RenderSubmission& target);
+		// lists the mesh entities among the first instanceCount instances as draws, which cast the shadows too
+		void packDraws(RenderSubmission& target, uint32_t instanceCount);
+		void onBoundsConstruct(entt::registry& registry, entt::entity entity);
+		void onBoundsDestroy(entt::registry& registry, entt::entity entity);
+		void onBoundsUpdate(entt::registry& registry, entt::entity entity);
+		void onTransformsChanged(entt::registry& registry, entt::entity entity);
+		void onTransformUpdate(entt::registry& registry, entt::entity entity);
+		void onStaticChanged(entt::registry& registry, entt::entity entity);
+
 		friend class Entity;
+		friend class SceneSerializer;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,404 @@
+#include "bpch.h"
+#include "SceneSerializer.h"
+
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+
+#include <entt.hpp>
+#include "Scene.h"
+#include "Components.h"
+#include "bento/core/hash.h"
+#include "bento/core/log.h"
+
+namespace bento
+{
+	namespace
+	{
+		// file layout: FileHeader, one ChunkHeader per chunk, then the chunk payloads
+		constexpr char fileMagic[4] = { 'B', 'S', 'C', 'N' };
+		constexpr uint32_t fileVersion = 2;
+
+		struct FileHeader
+		{
+			char magic[4];
+			uint32_t version;
+			uint32_t chunkCount;
+			uint32_t reserved;
+		};
+
+		struct ChunkHeader
+		{
+			uint32_t id;
+			uint32_t count;
+			uint64_t offset;
+			uint64_t size;
+			uint64_t hash;
+		};
+
+		// chunk ids are part of the file format; never reuse or renumber them
+		enum ChunkId : uint32_t
+		{
+			EntitiesChunk = 0,
+			TagChunk = 1,
+			TranslationChunk = 2,
+			RotationChunk = 3,
+			ScaleChunk = 4,
+			BoundsChunk = 5,
+			MeshChunk = 6,
+			LightChunk = 7,
+		};
+
+		template<typename Component> struct ChunkTraits;
+		template<> struct ChunkTraits<TagComponent> { static constexpr uint32_t id = TagChunk; };
+		template<> struct ChunkTraits<TranslationComponent> { static constexpr uint32_t id = TranslationChunk; };
+		template<> struct ChunkTraits<RotationComponent> { static constexpr uint32_t id = RotationChunk; };
+		template<> struct ChunkTraits<ScaleComponent> { static constexpr uint32_t id = ScaleChunk; };
+		template<> struct ChunkTraits<BoundsComponent> { static constexpr uint32_t id = BoundsChunk; };
+		template<> struct ChunkTraits<MeshComponent> { static constexpr uint32_t id = MeshChunk; };
+		template<> struct ChunkTraits<LightComponent> { static constexpr uint32_t id = LightChunk; };
+
+		template<typename... Component>
+		struct ComponentList {};
+
+		// components saved with a scene, in load order; transforms come before bounds so the spatial index sees world bounds
+		// new components need a chunk id and, unless they are trivially copyable, their own encode/decode overloads
+		using SerializedComponents = ComponentList<TranslationComponent, RotationComponent, ScaleComponent, BoundsComponent, MeshComponent, LightComponent, TagComponent>;
+
+		using EntityCount = entt::entt_traits<entt::entity>::entity_type;
+
+		struct ChunkWriter
+		{
+			uint32_t id;
+			EntityCount count = 0;
+			std::vector<uint8_t> data;
+
+			void write(const void* source, size_t size)
+			{
+				const size_t offset = data.size();
+				data.resize(offset + size);
+				std::memcpy(data.data() + offset, source, size);
+			}
+		};
+
+		class ChunkReader
+		{
+		public:
+			ChunkReader(const uint8_t* data, size_t size)
+				: data(data), size(size) {}
+
+			void read(void* destination, size_t count)
+			{
+				if (count > size - cursor)
+				{
+					throw std::runtime_error("scene chunk is truncated");
+				}
+
+				std::memcpy(destination, data + cursor, count);
+				cursor += count;
+			}
+
+		private:
+			const uint8_t* data;
+			size_t size;
+			size_t cursor = 0;
+		};
+
+		template<typename Component>
+		void encode(ChunkWriter& writer, const Component& component)
+		{
+			static_assert(std::is_trivially_copyable_v<Component>, "component needs its own encode/decode overloads");
+			writer.write(&component, sizeof(Component));
+		}
+
+		template<typename Component>
+		void decode(ChunkReader& reader, Component& component)
+		{
+			static_assert(std::is_trivially_copyable_v<Component>, "component needs its own encode/decode overloads");
+			reader.read(&component, sizeof(Component));
+		}
+
+		void encode(ChunkWriter& writer, const TagComponent& component)
+		{
+			const uint32_t length = static_cast<uint32_t>(component.tag.size());
+			writer.write(&length, sizeof(length));
+			writer.write(component.tag.data(), length);
+		}
+
+		void decode(ChunkReader& reader, TagComponent& component)
+		{
+			uint32_t length;
+			reader.read(&length, sizeof(length));
+			component.tag.resize(length);
+			reader.read(component.tag.data(), length);
+		}
+
+		// receives entt's snapshot output for a single chunk
+		class OutputArchive
+		{
+		public:
+			OutputArchive(ChunkWriter& chunk)
+				: chunk(chunk) {}
+
+			void operator()(EntityCount count) { chunk.count = count; }
+			void operator()(entt::entity entity) { chunk.write(&entity, sizeof(entity)); }
+
+			template<typename Component>
+			void operator()(entt::entity entity, const Component& component)
+			{
+				chunk.write(&entity, sizeof(entity));
+				encode(chunk, component);
+			}
+
+		private:
+			ChunkWriter& chunk;
+		};
+
+		template<typename Component>
+		void writeChunk(const entt::snapshot& snapshot, std::vector<ChunkWriter>& chunks)
+		{
+			chunks.push_back({ ChunkTraits<Component>::id });
+			OutputArchive archive(chunks.back());
+			snapshot.component<Component>(archive);
+		}
+
+		template<typename... Component>
+		std::vector<ChunkWriter> writeChunks(const entt::registry& registry, ComponentList<Component...>)
+		{
+			const entt::snapshot snapshot(registry);
+			std::vector<ChunkWriter> chunks;
+
+			chunks.push_back({ EntitiesChunk });
+			OutputArchive archive(chunks.back());
+			snapshot.entities(archive);
+
+			(writeChunk<Component>(snapshot, chunks), ...);
+
+			return chunks;
+		}
+
+		template<typename Component>
+		struct DecodedChunk
+		{
+			std::vector<entt::entity> entities;
+			std::vector<Component> components;
+		};
+
+		void verify(const uint8_t* data, const ChunkHeader& header)
+		{
+			if (header.count > header.size / sizeof(entt::entity))
+			{
+				throw std::runtime_error("scene chunk is truncated");
+			}
+
+			if (hashWords(data + header.offset, header.size) != header.hash)
+			{
+				throw std::runtime_error("scene chunk failed its content hash check");
+			}
+		}
+
+		// a missing chunk (e.g. a component added after the file was written) decodes as empty
+		std::vector<entt::entity> decodeEntities(const uint8_t* data, const ChunkHeader* header)
+		{
+			std::vector<entt::entity> entities;
+			if (!header) return entities;
+
+			verify(data, *header);
+
+			entities.resize(header->count);
+			ChunkReader reader(data + header->offset, header->size);
+			reader.read(entities.data(), entities.size() * sizeof(entt::entity));
+
+			return entities;
+		}
+
+		template<typename Component>
+		DecodedChunk<Component> decodeChunk(const uint8_t* data, const ChunkHeader* header)
+		{
+			DecodedChunk<Component> chunk;
+			if (!header) return chunk;
+
+			verify(data, *header);
+
+			chunk.entities.resize(header->count);
+			chunk.components.resize(header->count);
+
+			ChunkReader reader(data + header->offset, header->size);
+			for (EntityCount i = 0; i < header->count; i++)
+			{
+				reader.read(&chunk.entities[i], sizeof(entt::entity));
+				decode(reader, chunk.components[i]);
+			}
+
+			return chunk;
+		}
+
+		// feeds already decoded chunks to entt's snapshot loader
+		template<typename... Component>
+		class InputArchive
+		{
+		public:
+			std::vector<entt::entity> entities;
+			std::tuple<DecodedChunk<Component>...> chunks;
+
+			void loadEntities(const entt::snapshot_loader& loader)
+			{
+				length = static_cast<EntityCount>(entities.size());
+				cursor = 0;
+				loader.entities(*this);
+			}
+
+			template<typename T>
+			void loadComponent(const entt::snapshot_loader& loader)
+			{
+				length = static_cast<EntityCount>(std::get<DecodedChunk<T>>(chunks).entities.size());
+				cursor = 0;
+				loader.component<T>(*this);
+			}
+
+			void operator()(EntityCount& count) { count = length; }
+			void operator()(entt::entity& entity) { entity = entities[cursor++]; }
+
+			template<typename T>
+			void operator()(entt::entity& entity, T& component)
+			{
+				auto& chunk = std::get<DecodedChunk<T>>(chunks);
+				entity = chunk.entities[cursor];
+				component = std::move(chunk.components[cursor]);
+				cursor++;
+			}
+
+		private:
+			EntityCount length = 0;
+			size_t cursor = 0;
+		};
+
+		template<typename... Component>
+		void readChunks(entt::registry& registry, const std::vector<uint8_t>& data, const std::vector<ChunkHeader>& table, ComponentList<Component...>)
+		{
+			auto find = [&](uint32_t id) -> const ChunkHeader*
+			{
+				for (const auto& header : table)
+				{
+					if (header.id == id) return &header;
+				}
+				return nullptr;
+			};
+
+			// verifying and decoding dominates load time and every chunk is independent, so each gets its own thread
+			auto entities = std::async(std::launch::async, decodeEntities, data.data(), find(EntitiesChunk));
+			auto chunks = std::make_tuple(std::async(std::launch::async, decodeChunk<Component>, data.data(), find(ChunkTraits<Component>::id))...);
+
+			InputArchive<Component...> archive;
+			archive.entities = entities.get();
+			archive.chunks = std::make_tuple(std::get<std::future<DecodedChunk<Component>>>(chunks).get()...);
+
+			// registry insertion itself is not thread safe
+			const entt::snapshot_loader loader(registry);
+			archive.loadEntities(loader);
+			(archive.template loadComponent<Component>(loader), ...);
+		}
+	}
+
+	SceneSerializer::SceneSerializer(Scene& scene)
+		: scene(scene)
+	{
+	}
+
+	void SceneSerializer::Serialize(const std::string& path) const
+	{
+		const std::vector<ChunkWriter> chunks = writeChunks(scene.registry, SerializedComponents{});
+
+		FileHeader header{};
+		std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+		header.version = fileVersion;
+		header.chunkCount = static_cast<uint32_t>(chunks.size());
+
+		std::vector<ChunkHeader> table;
+		uint64_t offset = sizeof(FileHeader) + sizeof(ChunkHeader) * chunks.size();
+		for (const auto& chunk : chunks)
+		{
+			table.push_back({ chunk.id, chunk.count, offset, chunk.data.size(), hashWords(chunk.data.data(), chunk.data.size()) });
+			offset += chunk.data.size();
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+		{
+			throw std::runtime_error("failed to open " + path + " for writing");
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(table.data()), sizeof(ChunkHeader) * table.size());
+		for (const auto& chunk : chunks)
+		{
+			file.write(reinterpret_cast<const char*>(chunk.data.data()), chunk.data.size());
+		}
+
+		if (!file)
+		{
+			throw std::runtime_error("failed to write " + path);
+		}
+
+		BENTO_LOG_TRACE("Saved scene to {}", path);
+	}
+
+	void SceneSerializer::Deserialize(const std::string& path)
+	{
+		if (!scene.registry.empty())
+		{
+			throw std::runtime_error("scenes can only be loaded into an empty scene");
+		}
+
+		// read the whole file up front; chunks are decoded straight out of this buffer
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			throw std::runtime_error("failed to open " + path);
+		}
+
+		std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+		FileHeader header;
+		if (data.size() < sizeof(header))
+		{
+			throw std::runtime_error(path + " is not a scene file");
+		}
+
+		std::memcpy(&header, data.data(), sizeof(header));
+		if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0)
+		{
+			throw std::runtime_error(path + " is not a scene file");
+		}
+
+		if (header.version != fileVersion)
+		{
+			throw std::runtime_error(path + " has an unsupported scene version");
+		}
+
+		if (header.chunkCount > (data.size() - sizeof(header)) / sizeof(ChunkHeader))
+		{
+			throw std::runtime_error(path + " is truncated");
+		}
+
+		std::vector<ChunkHeader> table(header.chunkCount);
+		std::memcpy(table.data(), data.data() + sizeof(header), sizeof(ChunkHeader) * table.size());
+
+		for (const auto& chunk : table)
+		{
+			if (chunk.offset > data.size() || chunk.size > data.size() - chunk.offset)
+			{
+				throw std::runtime_error(path + " is truncated");
+			}
+		}
+
+		readChunks(scene.registry, data, table, SerializedComponents{});
+
+		BENTO_LOG_TRACE("Loaded scene from {}", path);
+	}
+}
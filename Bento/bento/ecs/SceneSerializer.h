@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+namespace bento
+{
+	class Scene;
+
+	// saves and loads scenes as chunked binary snapshots
+	// - one chunk per component pool, written through entt's snapshot
+	// - every chunk carries a content hash that is verified on load
+	// - chunks are decoded in parallel before being handed to entt's snapshot loader
+	class SceneSerializer
+	{
+	public:
+		SceneSerializer(Scene& scene);
+
+		void Serialize(const std::string& path) const;
+
+		// the scene must be empty; throws if the file is missing, truncated or corrupt
+		void Deserialize(const std::string& path);
+
+	private:
+		Scene& scene;
+	};
+}
@@ -0,0 +1,366 @@
+#include "bpch.h"
+#include "SpatialIndex.h"
+
+namespace bento
+{
+	void SpatialIndex::insert(entt::entity entity, const AABB& bounds)
+	{
+		const size_t index = indexOf(entity);
+		if (index >= leaves.size())
+		{
+			leaves.resize(index + 1, nullNode);
+		}
+
+		assert(leaves[index] == nullNode && "entity is already in the spatial index");
+
+		const int32_t leaf = allocateNode();
+		nodes[leaf].bounds = fatten(bounds);
+		nodes[leaf].tightBounds = bounds;
+		nodes[leaf].entity = entity;
+		nodes[leaf].height = 0;
+
+		insertLeaf(leaf);
+		leaves[index] = leaf;
+		leafCount++;
+	}
+
+	void SpatialIndex::update(entt::entity entity, const AABB& bounds)
+	{
+		const int32_t leaf = leaves[indexOf(entity)];
+		assert(leaf != nullNode && "entity is not in the spatial index");
+
+		// queries test the exact bounds, so they are always kept current
+		nodes[leaf].tightBounds = bounds;
+
+		// still inside the fattened bounds, and they aren't much larger than needed (e.g. after shrinking); nothing else to do
+		if (nodes[leaf].bounds.contains(bounds) && fatten(bounds, hugeMargin).contains(nodes[leaf].bounds))
+		{
+			return;
+		}
+
+		// refitting in place would leave the leaf under ancestors picked for where it used to be; reinserting finds it a sibling near where it is now
+		removeLeaf(leaf);
+		nodes[leaf].bounds = fatten(bounds);
+		insertLeaf(leaf);
+	}
+
+	void SpatialIndex::remove(entt::entity entity)
+	{
+		const size_t index = indexOf(entity);
+		if (index >= leaves.size() || leaves[index] == nullNode)
+		{
+			return;
+		}
+
+		const int32_t leaf = leaves[index];
+		removeLeaf(leaf);
+		freeNode(leaf);
+
+		leaves[index] = nullNode;
+		leafCount--;
+	}
+
+	void SpatialIndex::clear()
+	{
+		nodes.clear();
+		leaves.clear();
+		root = nullNode;
+		freeList = nullNode;
+		leafCount = 0;
+	}
+
+	bool SpatialIndex::contains(entt::entity entity) const
+	{
+		const size_t index = indexOf(entity);
+		return index < leaves.size() && leaves[index] != nullNode;
+	}
+
+	bool SpatialIndex::raycast(const Ray& ray, entt::entity& hit, float& distance) const
+	{
+		if (root == nullNode) return false;
+
+		Ray clipped = ray;
+		bool found = false;
+
+		int32_t stack[maxStackSize];
+		int count = 0;
+		stack[count++] = root;
+
+		while (count > 0)
+		{
+			const Node& node = nodes[stack[--count]];
+
+			// the ray is shortened to the closest hit so far, which prunes everything behind it
+			float entry;
+			if (!clipped.intersects(node.bounds, entry)) continue;
+
+			if (node.isLeaf())
+			{
+				// the fat bounds were hit, but the distance has to be the entity's own
+				if (!clipped.intersects(node.tightBounds, entry)) continue;
+
+				hit = node.entity;
+				distance = entry;
+				clipped.maxDistance = entry;
+				found = true;
+				continue;
+			}
+
+			assert(count + 2 <= maxStackSize);
+			stack[count++] = node.left;
+			stack[count++] = node.right;
+		}
+
+		return found;
+	}
+
+	int32_t SpatialIndex::allocateNode()
+	{
+		if (freeList == nullNode)
+		{
+			nodes.emplace_back();
+			return static_cast<int32_t>(nodes.size() - 1);
+		}
+
+		const int32_t node = freeList;
+		freeList = nodes[node].parent;
+		nodes[node] = Node();
+		return node;
+	}
+
+	void SpatialIndex::freeNode(int32_t node)
+	{
+		// free nodes are chained through their parent index
+		nodes[node].parent = freeList;
+		nodes[node].height = -1;
+		freeList = node;
+	}
+
+	void SpatialIndex::insertLeaf(int32_t leaf)
+	{
+		if (root == nullNode)
+		{
+			root = leaf;
+			nodes[root].parent = nullNode;
+			return;
+		}
+
+		// descend towards the cheapest sibling for the new leaf
+		const AABB leafBounds = nodes[leaf].bounds;
+		int32_t index = root;
+		while (!nodes[index].isLeaf())
+		{
+			const Node& node = nodes[index];
+			const float area = node.bounds.surfaceArea();
+			const float combinedArea = AABB::merge(node.bounds, leafBounds).surfaceArea();
+
+			// cost of making a new parent for this node and the new leaf
+			const float cost = 2.0f * combinedArea;
+			// minimum cost of pushing the leaf further down the tree
+			const float inheritanceCost = 2.0f * (combinedArea - area);
+
+			auto descendCost = [&](int32_t child)
+			{
+				const float merged = AABB::merge(leafBounds, nodes[child].bounds).surfaceArea();
+				return (nodes[child].isLeaf() ? merged : merged - nodes[child].bounds.surfaceArea()) + inheritanceCost;
+			};
+
+			const float leftCost = descendCost(node.left);
+			const float rightCost = descendCost(node.right);
+
+			if (cost < leftCost && cost < rightCost) break;
+
+			index = leftCost < rightCost ? node.left : node.right;
+		}
+
+		const int32_t sibling = index;
+
+		// create a new parent for the sibling and the leaf
+		const int32_t oldParent = nodes[sibling].parent;
+		const int32_t newParent = allocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].bounds = AABB::merge(leafBounds, nodes[sibling].bounds);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].left = sibling;
+		nodes[newParent].right = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		if (oldParent != nullNode)
+		{
+			if (nodes[oldParent].left == sibling) nodes[oldParent].left = newParent;
+			else nodes[oldParent].right = newParent;
+		}
+		else
+		{
+			root = newParent;
+		}
+
+		// walk back up fixing heights and bounds
+		index = nodes[leaf].parent;
+		while (index != nullNode)
+		{
+			index = balance(index);
+
+			Node& node = nodes[index];
+			node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+			node.bounds = AABB::merge(nodes[node.left].bounds, nodes[node.right].bounds);
+
+			index = node.parent;
+		}
+	}
+
+	void SpatialIndex::removeLeaf(int32_t leaf)
+	{
+		if (leaf == root)
+		{
+			root = nullNode;
+			return;
+		}
+
+		const int32_t parent = nodes[leaf].parent;
+		const int32_t grandParent = nodes[parent].parent;
+		const int32_t sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+		// the sibling takes the parent's place
+		freeNode(parent);
+
+		if (grandParent == nullNode)
+		{
+			root = sibling;
+			nodes[sibling].parent = nullNode;
+			return;
+		}
+
+		if (nodes[grandParent].left == parent) nodes[grandParent].left = sibling;
+		else nodes[grandParent].right = sibling;
+		nodes[sibling].parent = grandParent;
+
+		int32_t index = grandParent;
+		while (index != nullNode)
+		{
+			index = balance(index);
+
+			Node& node = nodes[index];
+			node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+			node.bounds = AABB::merge(nodes[node.left].bounds, nodes[node.right].bounds);
+
+			index = node.parent;
+		}
+	}
+
+	// performs a left or right rotation if the subtree at a is imbalanced; returns the new subtree root
+	int32_t SpatialIndex::balance(int32_t a)
+	{
+		Node& nodeA = nodes[a];
+		if (nodeA.isLeaf() || nodeA.height < 2)
+		{
+			return a;
+		}
+
+		const int32_t b = nodeA.left;
+		const int32_t c = nodeA.right;
+		Node& nodeB = nodes[b];
+		Node& nodeC = nodes[c];
+
+		const int32_t difference = nodeC.height - nodeB.height;
+
+		// rotate c up
+		if (difference > 1)
+		{
+			const int32_t f = nodeC.left;
+			const int32_t g = nodeC.right;
+			Node& nodeF = nodes[f];
+			Node& nodeG = nodes[g];
+
+			// swap a and c
+			nodeC.left = a;
+			nodeC.parent = nodeA.parent;
+			nodeA.parent = c;
+
+			if (nodeC.parent != nullNode)
+			{
+				if (nodes[nodeC.parent].left == a) nodes[nodeC.parent].left = c;
+				else nodes[nodeC.parent].right = c;
+			}
+			else
+			{
+				root = c;
+			}
+
+			// the taller of f and g stays under c
+			if (nodeF.height > nodeG.height)
+			{
+				nodeC.right = f;
+				nodeA.right = g;
+				nodeG.parent = a;
+				nodeA.bounds = AABB::merge(nodeB.bounds, nodeG.bounds);
+				nodeC.bounds = AABB::merge(nodeA.bounds, nodeF.bounds);
+				nodeA.height = 1 + std::max(nodeB.height, nodeG.height);
+				nodeC.height = 1 + std::max(nodeA.height, nodeF.height);
+			}
+			else
+			{
+				nodeC.right = g;
+				nodeA.right = f;
+				nodeF.parent = a;
+				nodeA.bounds = AABB::merge(nodeB.bounds, nodeF.bounds);
+				nodeC.bounds = AABB::merge(nodeA.bounds, nodeG.bounds);
+				nodeA.height = 1 + std::max(nodeB.height, nodeF.height);
+				nodeC.height = 1 + std::max(nodeA.height, nodeG.height);
+			}
+
+			return c;
+		}
+
+		// rotate b up
+		if (difference < -1)
+		{
+			const int32_t d = nodeB.left;
+			const int32_t e = nodeB.right;
+			Node& nodeD = nodes[d];
+			Node& nodeE = nodes[e];
+
+			// swap a and b
+			nodeB.left = a;
+			nodeB.parent = nodeA.parent;
+			nodeA.parent = b;
+
+			if (nodeB.parent != nullNode)
+			{
+				if (nodes[nodeB.parent].left == a) nodes[nodeB.parent].left = b;
+				else nodes[nodeB.parent].right = b;
+			}
+			else
+			{
+				root = b;
+			}
+
+			// the taller of d and e stays under b
+			if (nodeD.height > nodeE.height)
+			{
+				nodeB.right = d;
+				nodeA.left = e;
+				nodeE.parent = a;
+				nodeA.bounds = AABB::merge(nodeC.bounds, nodeE.bounds);
+				nodeB.bounds = AABB::merge(nodeA.bounds, nodeD.bounds);
+				nodeA.height = 1 + std::max(nodeC.height, nodeE.height);
+				nodeB.height = 1 + std::max(nodeA.height, nodeD.height);
+			}
+			else
+			{
+				nodeB.right = e;
+				nodeA.left = d;
+				nodeD.parent = a;
+				nodeA.bounds = AABB::merge(nodeC.bounds, nodeD.bounds);
+				nodeB.bounds = AABB::merge(nodeA.bounds, nodeE.bounds);
+				nodeA.height = 1 + std::max(nodeC.height, nodeD.height);
+				nodeB.height = 1 + std::max(nodeA.height, nodeE.height);
+			}
+
+			return b;
+		}
+
+		return a;
+	}
+}
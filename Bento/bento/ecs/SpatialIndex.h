@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+
+#include <entt.hpp>
+#include "Bounds.h"
+
+namespace bento
+{
+	// dynamic bounding volume hierarchy keyed by entity
+	// - leaves store fattened bounds, so small movements don't touch the tree at all
+	// - a leaf whose bounds leave its fat bounds (or shrink well inside them) is reinserted, like box2d's dynamic tree
+	// - queries descend by the fat bounds but test each leaf's exact bounds, so they never report the margin
+	// - inserts pick the sibling with the lowest surface area cost and rotations keep the tree balanced
+	class SpatialIndex
+	{
+	public:
+		SpatialIndex() = default;
+		~SpatialIndex() = default;
+
+		void insert(entt::entity entity, const AABB& bounds);
+		void update(entt::entity entity, const AABB& bounds);
+		void remove(entt::entity entity);
+		void clear();
+
+		bool contains(entt::entity entity) const;
+		size_t size() const { return leafCount; }
+
+		// calls func(entity) for every entity whose bounds overlap the given bounds
+		template<typename Func>
+		void queryOverlap(const AABB& bounds, Func func) const
+		{
+			traverse([&](const AABB& nodeBounds) { return nodeBounds.overlaps(bounds); }, func);
+		}
+
+		// calls func(entity) for every entity whose bounds are at least partially inside the frustum
+		// subtrees that are fully inside are reported without testing their children
+		template<typename Func>
+		void queryFrustum(const Frustum& frustum, Func func) const
+		{
+			if (root == nullNode) return;
+
+			StackEntry stack[maxStackSize];
+			int count = 0;
+			stack[count++] = { root, false };
+
+			while (count > 0)
+			{
+				const StackEntry entry = stack[--count];
+				const Node& node = nodes[entry.node];
+
+				bool inside = entry.inside;
+				if (!inside)
+				{
+					const Frustum::Result result = frustum.classify(node.bounds);
+					if (result == Frustum::Result::Outside) continue;
+					inside = result == Frustum::Result::Inside;
+				}
+
+				if (node.isLeaf())
+				{
+					// inside fat bounds means inside the exact ones too
+					if (inside || frustum.classify(node.tightBounds) != Frustum::Result::Outside)
+					{
+						func(node.entity);
+					}
+					continue;
+				}
+
+				assert(count + 2 <= maxStackSize);
+				stack[count++] = { node.left, inside };
+				stack[count++] = { node.right, inside };
+			}
+		}
+
+		// finds the closest entity whose bounds are hit by the ray
+		bool raycast(const Ray& ray, entt::entity& hit, float& distance) const;
+
+	private:
+		static constexpr int32_t nullNode = -1;
+		static constexpr int maxStackSize = 256;
+
+		// extra room given to leaf bounds so small movements don't update the tree
+		static constexpr float fatMargin = 0.1f;
+		// fat bounds that would still hold the exact bounds grown by this much are too loose, and the leaf is reinserted to shrink them
+		static constexpr float hugeMargin = 4.0f * fatMargin;
+
+		struct Node
+		{
+			// fattened for leaves, the union of the children otherwise
+			AABB bounds;
+			// leaves only: the bounds the entity was inserted or last updated with
+			AABB tightBounds;
+			int32_t parent = nullNode;
+			int32_t left = nullNode;
+			int32_t right = nullNode;
+			// leaves have height 0, free nodes -1
+			int32_t height = -1;
+			entt::entity entity = entt::null;
+
+			bool isLeaf() const { return left == nullNode; }
+		};
+
+		struct StackEntry
+		{
+			int32_t node;
+			bool inside;
+		};
+
+		std::vector<Node> nodes;
+		int32_t root = nullNode;
+		int32_t freeList = nullNode;
+		size_t leafCount = 0;
+
+		// entity index -> leaf node
+		std::vector<int32_t> leaves;
+
+		template<typename Test, typename Func>
+		void traverse(Test test, Func func) const
+		{
+			if (root == nullNode) return;
+
+			int32_t stack[maxStackSize];
+			int count = 0;
+			stack[count++] = root;
+
+			while (count > 0)
+			{
+				const Node& node = nodes[stack[--count]];
+				if (!test(node.bounds)) continue;
+
+				if (node.isLeaf())
+				{
+					if (test(node.tightBounds))
+					{
+						func(node.entity);
+					}
+					continue;
+				}
+
+				assert(count + 2 <= maxStackSize);
+				stack[count++] = node.left;
+				stack[count++] = node.right;
+			}
+		}
+
+		static size_t indexOf(entt::entity entity)
+		{
+			return static_cast<size_t>(entt::to_integral(entity) & entt::entt_traits<entt::entity>::entity_mask);
+		}
+
+		static AABB fatten(const AABB& bounds, float margin = fatMargin)
+		{
+			return AABB(bounds.min - glm::vec3(margin), bounds.max + glm::vec3(margin));
+		}
+
+		int32_t allocateNode();
+		void freeNode(int32_t node);
+
+		void insertLeaf(int32_t leaf);
+		void removeLeaf(int32_t leaf);
+		int32_t balance(int32_t node);
+	};
+}
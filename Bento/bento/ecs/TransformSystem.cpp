@@ -0,0 +1,182 @@
+#include "bpch.h"
+#include "TransformSystem.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define BENTO_TRANSFORM_SSE
+	#include <xmmintrin.h>
+#endif
+
+namespace bento::TransformSystem
+{
+	// the kernel reads the component arrays as flat floats
+	static_assert(sizeof(TranslationComponent) == 3 * sizeof(float), "translation must be tightly packed");
+	static_assert(sizeof(ScaleComponent) == 3 * sizeof(float), "scale must be tightly packed");
+	static_assert(sizeof(RotationComponent) == 4 * sizeof(float), "rotation must be tightly packed");
+	static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "mat4 must be tightly packed");
+	static_assert(offsetof(glm::quat, w) == 3 * sizeof(float), "the SIMD path expects quaternions stored as x, y, z, w");
+
+	namespace
+	{
+		// same math as the SIMD path, one entity at a time
+		void composeScalar(const glm::vec3& t, const glm::quat& q, const glm::vec3& s, glm::mat4& out)
+		{
+			const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+			const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+			const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+			out[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy + wz) * s.x, 2.0f * (xz - wy) * s.x, 0.0f);
+			out[1] = glm::vec4(2.0f * (xy - wz) * s.y, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz + wx) * s.y, 0.0f);
+			out[2] = glm::vec4(2.0f * (xz + wy) * s.z, 2.0f * (yz - wx) * s.z, (1.0f - 2.0f * (xx + yy)) * s.z, 0.0f);
+			out[3] = glm::vec4(t, 1.0f);
+		}
+
+#ifdef BENTO_TRANSFORM_SSE
+		// splits four packed vec3s (x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) into x, y and z lanes
+		inline void loadVec3x4(const float* src, __m128& x, __m128& y, __m128& z)
+		{
+			const __m128 a = _mm_loadu_ps(src);
+			const __m128 b = _mm_loadu_ps(src + 4);
+			const __m128 c = _mm_loadu_ps(src + 8);
+
+			x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+			z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+		}
+
+		void composeSSE(const float* translations, const float* rotations, const float* scales, float* out)
+		{
+			__m128 tx, ty, tz, sx, sy, sz;
+			loadVec3x4(translations, tx, ty, tz);
+			loadVec3x4(scales, sx, sy, sz);
+
+			// glm stores quaternions as x, y, z, w
+			__m128 qx = _mm_loadu_ps(rotations);
+			__m128 qy = _mm_loadu_ps(rotations + 4);
+			__m128 qz = _mm_loadu_ps(rotations + 8);
+			__m128 qw = _mm_loadu_ps(rotations + 12);
+			_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 two = _mm_set1_ps(2.0f);
+			const __m128 zero = _mm_setzero_ps();
+
+			const __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+			const __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+			const __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+			// rotation columns scaled per axis, one lane per entity
+			__m128 c0x = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+			__m128 c0y = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+			__m128 c0z = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+			__m128 c0w = zero;
+
+			__m128 c1x = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+			__m128 c1y = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+			__m128 c1z = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+			__m128 c1w = zero;
+
+			__m128 c2x = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+			__m128 c2y = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+			__m128 c2z = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+			__m128 c2w = zero;
+
+			__m128 c3w = one;
+
+			// transpose back so each register holds one column of one entity
+			_MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+			_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+			_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+			_MM_TRANSPOSE4_PS(tx, ty, tz, c3w);
+
+			// write the four matrices front to back
+			_mm_storeu_ps(out + 0, c0x);  _mm_storeu_ps(out + 4, c1x);  _mm_storeu_ps(out + 8, c2x);  _mm_storeu_ps(out + 12, tx);
+			_mm_storeu_ps(out + 16, c0y); _mm_storeu_ps(out + 20, c1y); _mm_storeu_ps(out + 24, c2y); _mm_storeu_ps(out + 28, ty);
+			_mm_storeu_ps(out + 32, c0z); _mm_storeu_ps(out + 36, c1z); _mm_storeu_ps(out + 40, c2z); _mm_storeu_ps(out + 44, tz);
+			_mm_storeu_ps(out + 48, c0w); _mm_storeu_ps(out + 52, c1w); _mm_storeu_ps(out + 56, c2w); _mm_storeu_ps(out + 60, c3w);
+		}
+#endif
+	}
+
+	void compose(const TranslationComponent* translations, const RotationComponent* rotations, const ScaleComponent* scales,
+	             size_t count, glm::mat4* destination)
+	{
+		size_t i = 0;
+
+#ifdef BENTO_TRANSFORM_SSE
+		for (; i + 4 <= count; i += 4)
+		{
+			composeSSE(
+				reinterpret_cast<const float*>(translations + i),
+				reinterpret_cast<const float*>(rotations + i),
+				reinterpret_cast<const float*>(scales + i),
+				reinterpret_cast<float*>(destination + i)
+			);
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			composeScalar(translations[i].translation, rotations[i].rotation, scales[i].scale, destination[i]);
+		}
+	}
+
+	void composeNaive(const TranslationComponent* translations, const RotationComponent* rotations, const ScaleComponent* scales,
+	                  size_t count, glm::mat4* destination)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			destination[i] = glm::translate(glm::mat4(1.0f), translations[i].translation)
+				* glm::mat4_cast(rotations[i].rotation)
+				* glm::scale(glm::mat4(1.0f), scales[i].scale);
+		}
+	}
+
+	void capture(entt::registry& registry, Snapshot& snapshot)
+	{
+		auto transforms = group(registry);
+		const size_t count = transforms.size();
+
+		snapshot.translations.assign(transforms.raw<TranslationComponent>(), transforms.raw<TranslationComponent>() + count);
+		snapshot.rotations.assign(transforms.raw<RotationComponent>(), transforms.raw<RotationComponent>() + count);
+		snapshot.scales.assign(transforms.raw<ScaleComponent>(), transforms.raw<ScaleComponent>() + count);
+	}
+
+	void interpolate(const Snapshot& previous, const Snapshot& current, float alpha, Snapshot& result)
+	{
+		const size_t count = current.size();
+		result.translations.resize(count);
+		result.rotations.resize(count);
+		result.scales.resize(count);
+
+		const float beta = 1.0f - alpha;
+		for (size_t i = 0; i < count; i++)
+		{
+			result.translations[i].translation = previous.translations[i].translation * beta + current.translations[i].translation * alpha;
+			result.scales[i].scale = previous.scales[i].scale * beta + current.scales[i].scale * alpha;
+
+			// steps are short, so a normalized lerp is indistinguishable from slerp and much cheaper
+			const glm::quat& a = previous.rotations[i].rotation;
+			const glm::quat& b = current.rotations[i].rotation;
+			const float sign = glm::dot(a, b) < 0.0f ? -1.0f : 1.0f;
+			result.rotations[i].rotation = glm::normalize(a * beta + b * (alpha * sign));
+		}
+	}
+
+	size_t update(entt::registry& registry, glm::mat4* destination, size_t capacity)
+	{
+		auto transforms = group(registry);
+		const size_t count = std::min(transforms.size(), capacity);
+
+		compose(
+			transforms.raw<TranslationComponent>(),
+			transforms.raw<RotationComponent>(),
+			transforms.raw<ScaleComponent>(),
+			count,
+			destination
+		);
+
+		return count;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include <entt.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "Components.h"
+
+namespace bento::TransformSystem
+{
+	// composes world matrices (translation * rotation * scale) for count entities into destination
+	// - the SIMD path handles four entities per iteration, the remainder falls back to scalar code
+	// - destination may point straight into mapped (write-combined) memory; it is only ever written sequentially
+	void compose(const TranslationComponent* translations, const RotationComponent* rotations, const ScaleComponent* scales,
+	             size_t count, glm::mat4* destination);
+
+	// reference path using plain glm calls, kept for validation and benchmarking
+	void composeNaive(const TranslationComponent* translations, const RotationComponent* rotations, const ScaleComponent* scales,
+	                  size_t count, glm::mat4* destination);
+
+	// owning group that keeps the three transform pools packed in the same order
+	inline auto group(entt::registry& registry)
+	{
+		return registry.group<TranslationComponent, RotationComponent, ScaleComponent>();
+	}
+
+	// copy of the transform pools in raw pool order, kept so rendering can blend between simulation steps
+	struct Snapshot
+	{
+		std::vector<TranslationComponent> translations;
+		std::vector<RotationComponent> rotations;
+		std::vector<ScaleComponent> scales;
+
+		size_t size() const { return translations.size(); }
+	};
+
+	// reuses the snapshot's storage, so this only allocates while the scene grows
+	void capture(entt::registry& registry, Snapshot& snapshot);
+
+	// lerps translation and scale, nlerps rotation along the shortest arc; both snapshots must be the same size and order
+	void interpolate(const Snapshot& previous, const Snapshot& current, float alpha, Snapshot& result);
+
+	// writes the world matrix of every transformed entity into destination (up to capacity)
+	// returns the number of matrices written; matrix i belongs to group(registry).data()[i] (raw pool order, not iteration order)
+	size_t update(entt::registry& registry, glm::mat4* destination, size_t capacity);
+}
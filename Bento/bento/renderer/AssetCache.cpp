@@ -0,0 +1,138 @@
+#include "bpch.h"
+#include "AssetCache.h"
+
+#include "Mesh.h"
+#include "Timeline.h"
+#include "VulkanUtils.h"
+#include "bento/core/hash.h"
+
+#include <cstring>
+#include <stb_image.h>
+#include "bento/core/log.h"
+
+namespace bento
+{
+	Texture::~Texture()
+	{
+		// the view goes first, as it references the image
+		timeline->retire(std::move(view));
+		if (image.image)
+		{
+			timeline->retire(std::move(image), allocator);
+		}
+	}
+
+	namespace
+	{
+		uint64_t hashGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+		{
+			return hash(indices.data(), indices.size() * sizeof(uint32_t), hash(vertices.data(), vertices.size() * sizeof(Vertex)));
+		}
+	}
+
+	GeometrySource::GeometrySource(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+		: vertexCount(vertices.size()), indexCount(indices.size()),
+		check(hashWords(indices.data(), indices.size() * sizeof(uint32_t), hashWords(vertices.data(), vertices.size() * sizeof(Vertex))))
+	{
+	}
+
+	GeometryHandle AssetCache::loadGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		const uint64_t contentHash = hashGeometry(vertices, indices);
+
+		return geometries.acquire(contentHash, GeometrySource(vertices, indices), [&]()
+		{
+			return std::make_unique<MeshGeometry>(context, vertices, indices, contentHash);
+		});
+	}
+
+	GeometryHandle AssetCache::findGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		return geometries.find(hashGeometry(vertices, indices), GeometrySource(vertices, indices));
+	}
+
+	TextureHandle AssetCache::loadTexture(const std::string& path)
+	{
+		return textures.acquire(hash(path.data(), path.size()), path, [&]()
+		{
+			// retrieve image pixels with stbi
+			int texWidth, texHeight, texChannels;
+			stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+			if (!pixels) {
+				throw std::runtime_error("failed to load texture image!");
+			}
+
+			// calculate image size (x4 for the rgba)
+			vk::DeviceSize imageSize = texWidth * texHeight * 4;
+
+			// create a staging buffer for the image pixels so we can then transfer
+			BufferData stagingBuffer = VulkanUtils::createBuffer(
+				context->device,
+				imageSize,
+				context->physicalDevice,
+				vk::BufferUsageFlagBits::eTransferSrc,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+			);
+
+			// copy the pixel data to the staging buffer
+			void* data = context->device.mapMemory(stagingBuffer.memory.get(), 0, imageSize, {});
+			memcpy(data, pixels, static_cast<size_t>(imageSize));
+			context->device.unmapMemory(stagingBuffer.memory.get());
+
+			// free image pixel memory
+			stbi_image_free(pixels);
+
+			auto texture = std::make_unique<Texture>();
+			texture->allocator = context->allocator;
+			texture->timeline = context->timeline;
+			texture->width = static_cast<uint32_t>(texWidth);
+			texture->height = static_cast<uint32_t>(texHeight);
+
+			texture->image = VulkanUtils::createImage(
+				context->allocator,
+				context->device,
+				context->physicalDevice,
+				texWidth,
+				texHeight,
+				vk::Format::eR8G8B8A8Srgb,
+				vk::ImageTiling::eOptimal,
+				vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+				vk::MemoryPropertyFlagBits::eDeviceLocal
+			);
+
+			// prepare the image to be copied (using transfer destination optimal)
+			VulkanUtils::transitionImageLayout(
+				context->device, context->commandPool, *context->timeline,
+				texture->image.image.get(),
+				vk::Format::eR8G8B8A8Srgb,
+				vk::ImageLayout::eUndefined,
+				vk::ImageLayout::eTransferDstOptimal
+			);
+
+			// copy staging buffer contents to image
+			VulkanUtils::copyBufferToImage(
+				context->device, context->commandPool, *context->timeline,
+				stagingBuffer.buffer.get(),
+				texture->image.image.get(),
+				texWidth,
+				texHeight
+			);
+
+			// transition layout to prepare for shader access
+			VulkanUtils::transitionImageLayout(
+				context->device, context->commandPool, *context->timeline,
+				texture->image.image.get(),
+				vk::Format::eR8G8B8A8Srgb,
+				vk::ImageLayout::eTransferDstOptimal,
+				vk::ImageLayout::eShaderReadOnlyOptimal
+			);
+			context->timeline->retire(std::move(stagingBuffer));
+
+			texture->view = VulkanUtils::createImageView(context->device, texture->image.image.get(), vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor);
+
+			BENTO_LOG_TRACE("Loaded texture {}", path);
+			return texture;
+		});
+	}
+}
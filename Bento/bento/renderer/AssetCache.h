@@ -0,0 +1,227 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Vertex.h"
+#include "ImageData.h"
+#include "VulkanContext.h"
+
+namespace bento
+{
+	class MeshGeometry;
+
+	// a sampled image and its view; unlike ImageData it frees its allocation when destroyed, through the timeline since
+	// frames still in flight may sample it. so the last handle has to go on the thread that submits, before the timeline is cleaned
+	struct Texture
+	{
+		VmaAllocator allocator = nullptr;
+		Timeline* timeline = nullptr;
+		ImageData image;
+		vk::UniqueImageView view;
+		uint32_t width = 0;
+		uint32_t height = 0;
+
+		~Texture();
+	};
+
+	using GeometryHandle = std::shared_ptr<MeshGeometry>;
+	using TextureHandle = std::shared_ptr<Texture>;
+
+	// geometry as it is kept with its cache entry, to tell it apart from other geometry with the same key
+	// the sizes and a second hash that has nothing in common with the key's, instead of a copy of the vertices and indices;
+	// two different meshes would have to collide in both 64 bit hashes at once to be mixed up
+	struct GeometrySource
+	{
+		GeometrySource(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+		size_t vertexCount;
+		size_t indexCount;
+		uint64_t check;
+
+		bool operator==(const GeometrySource& other) const
+		{
+			return vertexCount == other.vertexCount && indexCount == other.indexCount && check == other.check;
+		}
+	};
+
+	// assets shared by what they were loaded from, counted by their handles; the registry only keeps weak references, so an
+	// asset is destroyed the moment its last handle goes, and loading it again afterwards loads it anew
+	// - each entry keeps its Source, so assets whose 64 bit keys collide are still told apart (or at least their second check)
+	// - an asset is only ever loaded once at a time; acquiring it while it loads waits for that load
+	// - loading goes through the timeline, so load from one thread at a time; handles may be dropped on any thread
+	// - the registry has to outlive every handle it gave out
+	template<typename T, typename Source>
+	class AssetRegistry
+	{
+	public:
+		using Handle = std::shared_ptr<T>;
+
+		// the asset loaded from source if anything still holds it, otherwise what load returns (a std::unique_ptr<T>),
+		// registered under key; Source has to be constructible from and comparable to Lookup
+		template<typename Lookup, typename Load>
+		Handle acquire(uint64_t key, const Lookup& source, Load&& load)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			Entry* entry = nullptr;
+			while ((entry = findEntry(key, source)) != nullptr && entry->loading)
+			{
+				loaded.wait(lock);
+			}
+
+			if (entry)
+			{
+				if (Handle existing = entry->asset.lock())
+				{
+					hits++;
+					return existing;
+				}
+			}
+			else
+			{
+				entry = &assets.emplace(key, Entry(source))->second;
+			}
+
+			// claimed while loading, so neither another acquire nor the last handle of what was here before touches it
+			entry->loading = true;
+			lock.unlock();
+
+			std::unique_ptr<T> asset;
+			try
+			{
+				asset = load();
+			}
+			catch (...)
+			{
+				lock.lock();
+				erase(key, entry);
+				loaded.notify_all();
+				throw;
+			}
+
+			Handle handle(asset.release(), [this, key](T* asset)
+			{
+				release(key);
+				delete asset;
+			});
+
+			lock.lock();
+			entry->asset = handle;
+			entry->loading = false;
+			loads++;
+			loaded.notify_all();
+			return handle;
+		}
+
+		// nullptr if nothing loaded from source is alive (or it is still loading)
+		template<typename Lookup>
+		Handle find(uint64_t key, const Lookup& source)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			Entry* entry = findEntry(key, source);
+			return entry ? entry->asset.lock() : nullptr;
+		}
+
+		// assets currently alive or loading
+		size_t size()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return assets.size();
+		}
+
+		// acquires served by an asset that was already loaded, and those that had to load it
+		uint64_t getHits() const { return hits; }
+		uint64_t getLoads() const { return loads; }
+
+	private:
+		struct Entry
+		{
+			template<typename Lookup>
+			explicit Entry(const Lookup& source) : source(source) { }
+
+			Source source;
+			std::weak_ptr<T> asset;
+			bool loading = false;
+		};
+
+		// call with the mutex held
+		template<typename Lookup>
+		Entry* findEntry(uint64_t key, const Lookup& source)
+		{
+			auto range = assets.equal_range(key);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (it->second.source == source)
+				{
+					return &it->second;
+				}
+			}
+			return nullptr;
+		}
+
+		// call with the mutex held
+		void erase(uint64_t key, Entry* entry)
+		{
+			auto range = assets.equal_range(key);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (&it->second == entry)
+				{
+					assets.erase(it);
+					return;
+				}
+			}
+		}
+
+		void release(uint64_t key)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			// the one released is expired by now; the same source may already be loading again under a new asset
+			auto range = assets.equal_range(key);
+			for (auto it = range.first; it != range.second;)
+			{
+				it = !it->second.loading && it->second.asset.expired() ? assets.erase(it) : std::next(it);
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable loaded;
+		// node based, so an entry stays put while its asset loads without the mutex held
+		std::unordered_multimap<uint64_t, Entry> assets;
+		std::atomic<uint64_t> hits = 0;
+		std::atomic<uint64_t> loads = 0;
+	};
+
+	// geometry by content and textures by path, so each is uploaded once however many meshes (or materials) use it
+	// geometry is only drawn through meshes, which the mesh factory retires through the timeline, so by the time the last
+	// handle goes the gpu is done with it and it can be released right away
+	class AssetCache
+	{
+	public:
+		AssetCache(VulkanContext* context) : context(context) { }
+
+		GeometryHandle loadGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		// nullptr if no geometry with that content is alive
+		GeometryHandle findGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+		// rgba8 srgb, decoded and uploaded only if nothing holds the texture at that path yet
+		TextureHandle loadTexture(const std::string& path);
+
+		AssetRegistry<MeshGeometry, GeometrySource>& getGeometries() { return geometries; }
+		AssetRegistry<Texture, std::string>& getTextures() { return textures; }
+
+	private:
+		VulkanContext* context;
+
+		AssetRegistry<MeshGeometry, GeometrySource> geometries;
+		AssetRegistry<Texture, std::string> textures;
+	};
+}
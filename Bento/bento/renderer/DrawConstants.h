@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+
+// pushed once per scene pass to the fragment stage; the world matrices come from the instance buffer. the push constant block
+// in shader.frag has to match
+struct DrawConstants {
+	// which of the material textures to sample; there is only the one texture so far
+	uint32_t material;
+};
@@ -0,0 +1,80 @@
+#include "bpch.h"
+#include "DrawSort.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace bento::DrawSort
+{
+	namespace
+	{
+		constexpr uint32_t MATERIAL_SHIFT = MESH_BITS + DEPTH_BITS;
+		constexpr uint32_t PIPELINE_SHIFT = MATERIAL_BITS + MATERIAL_SHIFT;
+
+		constexpr uint64_t mask(uint32_t bits)
+		{
+			return (uint64_t(1) << bits) - 1;
+		}
+	}
+
+	uint32_t quantizeDepth(float depth, float nearPlane, float farPlane)
+	{
+		const float t = std::clamp((depth - nearPlane) / (farPlane - nearPlane), 0.0f, 1.0f);
+		return static_cast<uint32_t>(t * static_cast<float>(mask(DEPTH_BITS)));
+	}
+
+	uint64_t opaqueKey(uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth)
+	{
+		return (static_cast<uint64_t>(pipeline) & mask(PIPELINE_BITS)) << PIPELINE_SHIFT
+			| (static_cast<uint64_t>(material) & mask(MATERIAL_BITS)) << MATERIAL_SHIFT
+			| (static_cast<uint64_t>(mesh) & mask(MESH_BITS)) << DEPTH_BITS
+			| (static_cast<uint64_t>(depth) & mask(DEPTH_BITS));
+	}
+
+	uint64_t depthKey(uint32_t depth, uint32_t mesh)
+	{
+		return (static_cast<uint64_t>(depth) & mask(DEPTH_BITS)) << MESH_BITS
+			| (static_cast<uint64_t>(mesh) & mask(MESH_BITS));
+	}
+
+	void radixSort(Item* items, Item* scratch, size_t count)
+	{
+		Item* source = items;
+		Item* destination = scratch;
+
+		for (uint32_t shift = 0; shift < 64; shift += 8)
+		{
+			size_t offsets[256] = {};
+			for (size_t i = 0; i < count; i++)
+			{
+				offsets[source[i].key >> shift & 0xff]++;
+			}
+
+			// nothing to reorder when every key has the same byte here, which is common for the unused high bits
+			if (count == 0 || offsets[source[0].key >> shift & 0xff] == count)
+			{
+				continue;
+			}
+
+			size_t total = 0;
+			for (size_t& offset : offsets)
+			{
+				const size_t bucket = offset;
+				offset = total;
+				total += bucket;
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				destination[offsets[source[i].key >> shift & 0xff]++] = source[i];
+			}
+
+			std::swap(source, destination);
+		}
+
+		if (source != items)
+		{
+			std::memcpy(items, source, sizeof(Item) * count);
+		}
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace bento::DrawSort
+{
+	// one draw and the key it is ordered by; index is whatever the caller draws from (e.g. a mesh index)
+	struct Item
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+	// bits per key field, from the most significant down
+	constexpr uint32_t PIPELINE_BITS = 8;
+	constexpr uint32_t MATERIAL_BITS = 16;
+	constexpr uint32_t MESH_BITS = 16;
+	constexpr uint32_t DEPTH_BITS = 24;
+
+	// view space depth as an unsigned integer that grows with distance, clamped to [nearPlane, farPlane]
+	uint32_t quantizeDepth(float depth, float nearPlane, float farPlane);
+
+	// orders by state first, so pipeline, material and mesh changes are as rare as they can be, then front to back among draws sharing all three
+	uint64_t opaqueKey(uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth);
+	// strictly front to back, mesh only breaking ties; for depth only passes, where the state hardly changes and early rejection is all that matters
+	uint64_t depthKey(uint32_t depth, uint32_t mesh);
+
+	// stable lsd radix sort on the keys, one byte per pass; passes where every key has the same byte are skipped
+	// scratch must hold count items; the result ends up in items
+	void radixSort(Item* items, Item* scratch, size_t count);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+namespace bento
+{
+	// counters and timings for the most recently submitted frame
+	struct FrameStats
+	{
+		uint32_t drawCalls = 0;
+		uint32_t pipelineBinds = 0;
+		uint32_t descriptorSetBinds = 0;
+		uint32_t vertexBufferBinds = 0;
+		uint32_t pushConstantUpdates = 0;
+
+		// heap allocations the render thread made in drawFrame, which should stay at 0 once the frame loop has warmed up,
+		// and how much of the frame arena it used instead
+		uint32_t heapAllocations = 0;
+		uint32_t arenaBytes = 0;
+
+		// milliseconds of cpu time spent in drawFrame, and how much of that was waiting on the frame's fence
+		double cpuTime = 0.0;
+		double waitTime = 0.0;
+
+		// milliseconds of gpu time for the most recently completed frame; 0 if the queue has no timestamp support
+		double gpuTime = 0.0;
+
+		// milliseconds from sampling the frame's input to queueing it for presentation; 0 when headless or unmeasured
+		double inputLatency = 0.0;
+	};
+}
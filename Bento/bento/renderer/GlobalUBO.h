@@ -1,5 +1,6 @@
 #pragma once
 #include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
 
 // Note: Make sure to consider alignment in memory...
 // -Scalars have to be aligned by N(= 4 bytes given 32 bit floats).
@@ -13,4 +14,18 @@ struct GlobalUBO {
 	//alignas(16) glm::mat4 model;
 	alignas(16) glm::mat4 view;
 	alignas(16) glm::mat4 proj;
+
+	// clustered lighting; the grid is split into tiles across the screen and exponential slices between the near and far planes
+	alignas(16) glm::mat4 inverseProj;
+	// framebuffer width and height, near and far plane
+	alignas(16) glm::vec4 screen;
+	// grid size in x, y and z, and the number of lights
+	alignas(16) glm::uvec4 clusters;
+
+	// the directional light's direction, w 1 if there is one; rgb color, a intensity
+	alignas(16) glm::vec4 lightDirection;
+	alignas(16) glm::vec4 lightColor;
+	// world to shadow map for each cascade (must match Renderer::SHADOW_CASCADES), and the view space depth each one ends at
+	alignas(16) glm::mat4 cascadeViewProj[4];
+	alignas(16) glm::vec4 cascadeSplits;
 };
\ No newline at end of file
@@ -4,13 +4,14 @@
 
 #include <imgui.h>
 #include "bento/core/log.h"
+#include "bento/core/profiler.h"
 #include "Shader.h"
 
 namespace bento
 {
 	ImGuiLayer::ImGuiLayer(VulkanContext* vulkanContext)
 	{
-		bento::log::warn("doing imgui things");
+		BENTO_LOG_TRACE("Created imgui context");
 		this->context = vulkanContext;
 
 		ImGui::CreateContext();
@@ -21,22 +22,59 @@ namespace bento
 		ImGui::DestroyContext();
 	}
 
-	void ImGuiLayer::initialize(vk::RenderPass renderPass, float width, float height)
+	void ImGuiLayer::initialize(vk::RenderPass renderPass, vk::Format colorFormat, float width, float height, uint32_t framesInFlight)
 	{
-		log::info("Initializing ImGui layer...");
+		BENTO_LOG_INFO("Initializing ImGui layer...");
 
-		vertexBufferData.device = context->device;
-		indexBufferData.device = context->device;
+		frameBuffers.resize(framesInFlight);
+		for (auto& buffers : frameBuffers)
+		{
+			buffers.vertexBufferData.device = context->device;
+			buffers.indexBufferData.device = context->device;
+		}
 
 		setImGuiStyle(width, height);
-		createResources(renderPass);
+		createResources(renderPass, colorFormat);
 
-		log::info("ImGui layer initialized");
+		BENTO_LOG_INFO("ImGui layer initialized");
 	}
 
-	void ImGuiLayer::drawFrame(vk::CommandBuffer commandBuffer)
+	void ImGuiLayer::resize(float width, float height)
+	{
+		ImGui::GetIO().DisplaySize = ImVec2(width, height);
+	}
+
+	void ImGuiLayer::clean()
+	{
+		// everything here belongs to the device, which is destroyed before this layer is
+		for (auto& buffers : frameBuffers)
+		{
+			buffers.vertexBufferData.unmap();
+			buffers.vertexBufferData.destroy();
+			buffers.indexBufferData.unmap();
+			buffers.indexBufferData.destroy();
+		}
+		frameBuffers.clear();
+
+		if (fontImageData.image)
+		{
+			vmaDestroyImage(context->allocator, static_cast<VkImage>(fontImageData.image.release()), fontImageData.allocation);
+		}
+
+		fontImageView.reset();
+		sampler.reset();
+		pipeline.reset();
+		pipelineLayout.reset();
+		pipelineCache.reset();
+		descriptorSets.clear();
+		descriptorSetLayout.reset();
+		descriptorPool.reset();
+	}
+
+	void ImGuiLayer::drawFrame(vk::CommandBuffer commandBuffer, uint32_t frame)
 	{
 		ImGuiIO& io = ImGui::GetIO();
+		const FrameBuffers& buffers = frameBuffers[frame];
 
 		// worried about this one
 		commandBuffer.bindDescriptorSets(
@@ -61,11 +99,11 @@ namespace bento
 		int32_t vertexOffset = 0;
 		int32_t indexOffset = 0;
 
-		if (imDrawData->CmdListsCount > 0) {
+		if (imDrawData->CmdListsCount > 0 && imDrawData->TotalVtxCount > 0 && imDrawData->TotalIdxCount > 0) {
 
 			vk::DeviceSize offsets[1] = { 0 };
-			commandBuffer.bindVertexBuffers(0, 1, &vertexBufferData.buffer.get(), offsets);
-			commandBuffer.bindIndexBuffer(indexBufferData.buffer.get(), 0, vk::IndexType::eUint16);
+			commandBuffer.bindVertexBuffers(0, 1, &buffers.vertexBufferData.buffer.get(), offsets);
+			commandBuffer.bindIndexBuffer(buffers.indexBufferData.buffer.get(), 0, sizeof(ImDrawIdx) == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32);
 
 			for (int32_t i = 0; i < imDrawData->CmdListsCount; i++)
 			{
@@ -103,7 +141,7 @@ namespace bento
 		io.DisplayFramebufferScale = ImVec2(1.0f, 1.0f);
 	}
 
-	void ImGuiLayer::createResources(vk::RenderPass renderPass/*vk::RenderPass renderPass, vk::Queue copyQueue, const std::string& shadersPath*/)
+	void ImGuiLayer::createResources(vk::RenderPass renderPass, vk::Format colorFormat/*vk::RenderPass renderPass, vk::Queue copyQueue, const std::string& shadersPath*/)
 	{
 		ImGuiIO& io = ImGui::GetIO();
 
@@ -124,11 +162,11 @@ namespace bento
 			vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
 			vk::MemoryPropertyFlagBits::eDeviceLocal
 		);
-		log::trace("Created font image");
+		BENTO_LOG_TRACE("Created font image");
 
 		// prepare the image to be copied (using transfer destination optimal)
 		VulkanUtils::transitionImageLayout(
-			context->device, context->commandPool, context->queue,
+			context->device, context->commandPool, *context->timeline,
 			fontImageData.image.get(),
 			vk::Format::eR8G8B8A8Unorm,
 			vk::ImageLayout::eUndefined,
@@ -143,7 +181,7 @@ namespace bento
 			vk::Format::eR8G8B8A8Unorm,
 			vk::ImageAspectFlagBits::eColor
 		);
-		log::trace("Created font image view");
+		BENTO_LOG_TRACE("Created font image view");
 
 		// Staging buffers for font data upload
 		vk::DeviceSize bufferSize = texWidth * texHeight * 4 * sizeof(char);
@@ -154,34 +192,35 @@ namespace bento
 			vk::BufferUsageFlagBits::eTransferSrc,
 			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
 		);
-		log::trace("   Created staging buffer");
+		BENTO_LOG_TRACE("   Created staging buffer");
 
 		// copy the data to the staging buffer
 		void* data = context->device.mapMemory(stagingBufferData.memory.get(), 0, bufferSize, {});
 		memcpy(data, fontData, static_cast<size_t>(bufferSize));
 		context->device.unmapMemory(stagingBufferData.memory.get());
-		log::trace("   Copied data to staging buffer");
+		BENTO_LOG_TRACE("   Copied data to staging buffer");
 
 		// copy staging buffer contents to image
 		VulkanUtils::copyBufferToImage(
-			context->device, context->commandPool, context->queue,
+			context->device, context->commandPool, *context->timeline,
 			stagingBufferData.buffer.get(),
 			fontImageData.image.get(),
 			texWidth,
 			texHeight
 		);
-		log::trace("   Copied staging buffer contents to image");
-		log::trace("Copied font data to image");
+		context->timeline->retire(std::move(stagingBufferData));
+		BENTO_LOG_TRACE("   Copied staging buffer contents to image");
+		BENTO_LOG_TRACE("Copied font data to image");
 
 		// Prepare for shader read
 		VulkanUtils::transitionImageLayout(
-			context->device, context->commandPool, context->queue,
+			context->device, context->commandPool, *context->timeline,
 			fontImageData.image.get(),
 			vk::Format::eR8G8B8A8Unorm,
 			vk::ImageLayout::eTransferDstOptimal,
 			vk::ImageLayout::eShaderReadOnlyOptimal
 		);
-		log::warn("transitioned image layout for shader access");
+		BENTO_LOG_WARN("transitioned image layout for shader access");
 
 		/*vks::tools::setImageLayout(
 			copyCmd,
@@ -202,14 +241,14 @@ namespace bento
 			vk::SamplerAddressMode::eClampToEdge,
 			vk::SamplerAddressMode::eClampToEdge,
 			0.0f,
-			true, 16.0f,
+			false, 1.0f,
 			false, vk::CompareOp::eAlways,
 			0.0f, 0.0f,
 			vk::BorderColor::eFloatOpaqueWhite,
 			false
 		);
 		sampler = context->device.createSamplerUnique(samplerInfo);
-		log::trace("Created sampler");
+		BENTO_LOG_TRACE("Created sampler");
 
 		// set up descriptor
 		// Descriptor pool
@@ -220,7 +259,7 @@ namespace bento
 		// check this
 		vk::DescriptorPoolCreateInfo poolInfo({}, 2, 1, poolSizes.data());
 		descriptorPool = context->device.createDescriptorPoolUnique(poolInfo);
-		log::trace("Created descriptor pool");
+		BENTO_LOG_TRACE("Created descriptor pool");
 
 		// Descriptor set layout
 		std::array<vk::DescriptorSetLayoutBinding, 1> setLayoutBindings = {
@@ -233,13 +272,13 @@ namespace bento
 		};
 		vk::DescriptorSetLayoutCreateInfo descriptorLayoutInfo({}, setLayoutBindings.size(), setLayoutBindings.data());
 		descriptorSetLayout = context->device.createDescriptorSetLayoutUnique(descriptorLayoutInfo);
-		log::trace("Created descriptor set layout");
+		BENTO_LOG_TRACE("Created descriptor set layout");
 
 		// Descriptor set
 		vk::DescriptorSetAllocateInfo allocateInfo(descriptorPool.get(), 1, &descriptorSetLayout.get());
 		descriptorSets.resize(1);
 		descriptorSets = context->device.allocateDescriptorSetsUnique(allocateInfo);
-		log::trace("Allocated descriptor set");
+		BENTO_LOG_TRACE("Allocated descriptor set");
 
 		vk::DescriptorImageInfo fontDescriptor(sampler.get(), fontImageView.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
 
@@ -257,11 +296,11 @@ namespace bento
 		};
 
 		context->device.updateDescriptorSets(descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
-		log::trace("Updated descriptor set");
+		BENTO_LOG_TRACE("Updated descriptor set");
 
 		// Pipeline cache
 		pipelineCache = context->device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
-		log::trace("Created pipeline cache");
+		BENTO_LOG_TRACE("Created pipeline cache");
 
 		// Pipeline layout --------------------------
 
@@ -271,7 +310,7 @@ namespace bento
 		// create pipeline layout
 		vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo({}, 1, &descriptorSetLayout.get(), 1, &pushConstantRange);
 		pipelineLayout = context->device.createPipelineLayoutUnique(pipelineLayoutCreateInfo);
-		log::trace("Created pipeline layout");
+		BENTO_LOG_TRACE("Created pipeline layout");
 
 		// Setup graphics pipeline for UI rendering
 		vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState({}, vk::PrimitiveTopology::eTriangleList, false);
@@ -335,7 +374,7 @@ namespace bento
 			false,
 			false
 		);
-		log::warn("Disabling multisampling");
+		BENTO_LOG_WARN("Disabling multisampling");
 
 		std::vector<vk::DynamicState> dynamicStateEnables = {
 			vk::DynamicState::eViewport,
@@ -394,17 +433,27 @@ namespace bento
 			&multisampleState,							// pMultisampleState
 			&depthStencil,								// pDepthStencilState
 			&colorBlendState,							// pColorBlendState
-			nullptr,						// pDynamicState
+			&dynamicState,								// pDynamicState
 			pipelineLayout.get(),					// layout
 			renderPass									// renderPass
 		);
+
+		// no render pass with dynamic rendering; the ui only draws into the color attachment
+		vk::PipelineRenderingCreateInfoKHR renderingInfo(0, 1, &colorFormat);
+		if (!renderPass)
+		{
+			graphicsPipelineCreateInfo.pNext = &renderingInfo;
+		}
 		pipeline = context->device.createGraphicsPipelineUnique(pipelineCache.get(), graphicsPipelineCreateInfo);
 
-		log::trace("Created pipeline");
+		BENTO_LOG_TRACE("Created pipeline");
 	}
 
-	void ImGuiLayer::newFrame(bool updateFrameGraph)
+	void ImGuiLayer::newFrame(const profiler::FrameTiming& timing, bool updateFrameGraph)
 	{
+		ImGuiIO& io = ImGui::GetIO();
+		io.DeltaTime = timing.frame > 0.0f ? timing.frame / 1000.0f : 1.0f / 60.0f;
+
 		ImGui::NewFrame();
 
 		// Init imGui windows and elements
@@ -416,21 +465,23 @@ namespace bento
 
 		//ImGui::End();
 
-		//// Update frame time display
-		//if (updateFrameGraph) {
-		//	std::rotate(uiSettings.frameTimes.begin(), uiSettings.frameTimes.begin() + 1, uiSettings.frameTimes.end());
-		//	//float frameTime = 1000.0f / (example->frameTimer * 1000.0f);
-		//	float frameTime = 10f;
-		//	uiSettings.frameTimes.back() = frameTime;
-		//	if (frameTime < uiSettings.frameTimeMin) {
-		//		uiSettings.frameTimeMin = frameTime;
-		//	}
-		//	if (frameTime > uiSettings.frameTimeMax) {
-		//		uiSettings.frameTimeMax = frameTime;
-		//	}
-		//}
-
-		//ImGui::PlotLines("Frame Times", &uiSettings.frameTimes[0], 50, 0, "", uiSettings.frameTimeMin, uiSettings.frameTimeMax, ImVec2(0, 80));
+		// update frame time display; times come from the profiler, so cpu and gpu can be compared directly
+		if (updateFrameGraph)
+		{
+			std::rotate(uiSettings.frameTimes.begin(), uiSettings.frameTimes.begin() + 1, uiSettings.frameTimes.end());
+			std::rotate(uiSettings.gpuFrameTimes.begin(), uiSettings.gpuFrameTimes.begin() + 1, uiSettings.gpuFrameTimes.end());
+			uiSettings.frameTimes.back() = timing.cpu;
+			uiSettings.gpuFrameTimes.back() = timing.gpu;
+
+			uiSettings.frameTimeMin = std::min({ uiSettings.frameTimeMin, timing.cpu, timing.gpu });
+			uiSettings.frameTimeMax = std::max({ uiSettings.frameTimeMax, timing.cpu, timing.gpu });
+		}
+
+		ImGui::Begin("Frame Times");
+		ImGui::Text("frame %.2f ms, cpu %.2f ms, gpu %.2f ms (%s bound)", timing.frame, timing.cpu, timing.gpu, timing.cpu > timing.gpu ? "cpu" : "gpu");
+		ImGui::PlotLines("cpu", &uiSettings.frameTimes[0], static_cast<int>(uiSettings.frameTimes.size()), 0, "", uiSettings.frameTimeMin, uiSettings.frameTimeMax, ImVec2(0, 80));
+		ImGui::PlotLines("gpu", &uiSettings.gpuFrameTimes[0], static_cast<int>(uiSettings.gpuFrameTimes.size()), 0, "", uiSettings.frameTimeMin, uiSettings.frameTimeMax, ImVec2(0, 80));
+		ImGui::End();
 
 		//ImGui::Text("Camera");
 		////ImGui::InputFloat3("position", &example->camera.position.x, 2);
@@ -452,93 +503,25 @@ namespace bento
 		ImGui::Render();
 	}
 
-	void ImGuiLayer::updateBuffers()
+	void ImGuiLayer::updateBuffers(uint32_t frame)
 	{
 		ImDrawData* imDrawData = ImGui::GetDrawData();
-
-		vk::DeviceSize vertexBufferSize = imDrawData->TotalVtxCount * sizeof(ImDrawVert);
-		vk::DeviceSize indexBufferSize = imDrawData->TotalIdxCount * sizeof(ImDrawIdx);
-
-		// Update buffers only if vertex or index count has been changed compared to current buffer size
-
-		// Vertex buffer
-		//if ((vertexBufferData.buffer.get() == nullptr) || (vertexCount != imDrawData->TotalVtxCount)) {
-		//	context->device.unmapMemory(vertexBufferData.memory.get());
-		//	context->device.destroyBuffer(vertexBufferData.buffer.release());
-		//	context->device.freeMemory(vertexBufferData.memory.release());
-
-		//	vertexBufferData = VulkanUtils::createBuffer(
-		//		context->device,
-		//		vertexBufferSize,
-		//		context->physicalDevice,
-		//		vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-		//		vk::MemoryPropertyFlagBits::eHostVisible
-		//	);
-
-		//	vertexCount = imDrawData->TotalVtxCount;
-
-		//	// map?
-		//	void* mapped = nullptr;
-		//	context->device.mapMemory(vertexBufferData.memory.get(), 0, VK_WHOLE_SIZE, {}, &mapped);
-		//}
-
-		//if ((indexBufferData.buffer.get() == nullptr) || (indexCount != imDrawData->TotalIdxCount)) {
-		//	context->device.unmapMemory(indexBufferData.memory.get());
-		//	context->device.destroyBuffer(indexBufferData.buffer.release());
-		//	context->device.freeMemory(indexBufferData.memory.release());
-
-		//	indexBufferData = VulkanUtils::createBuffer(
-		//		context->device,
-		//		indexBufferSize,
-		//		context->physicalDevice,
-		//		vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-		//		vk::MemoryPropertyFlagBits::eHostVisible
-		//	);
-
-		//	indexCount = imDrawData->TotalIdxCount;
-
-		//	// map?
-		//	void* mapped = nullptr;
-		//	context->device.mapMemory(indexBufferData.memory.get(), 0, VK_WHOLE_SIZE, {}, &mapped);
-		//}
-
-		// Vertex buffer
-		if ((vertexBufferData.buffer.get() == nullptr) || (vertexCount != imDrawData->TotalVtxCount)) {
-			vertexBufferData.unmap();
-			vertexBufferData.destroy();
-			
-			vertexBufferData = VulkanUtils::createBuffer(
-				context->device,
-				vertexBufferSize,
-				context->physicalDevice,
-				vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-				vk::MemoryPropertyFlagBits::eHostVisible
-			);
-
-			vertexCount = imDrawData->TotalVtxCount;
-			vertexBufferData.map();
+		if (imDrawData->TotalVtxCount == 0 || imDrawData->TotalIdxCount == 0)
+		{
+			return;
 		}
 
-		// Index buffer
-		if ((indexBufferData.buffer.get() == nullptr) || (indexCount < imDrawData->TotalIdxCount)) {
-			indexBufferData.unmap();
-			indexBufferData.destroy();
-			
-			indexBufferData = VulkanUtils::createBuffer(
-				context->device,
-				indexBufferSize,
-				context->physicalDevice,
-				vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-				vk::MemoryPropertyFlagBits::eHostVisible
-			);
-
-			indexCount = imDrawData->TotalIdxCount;
-			indexBufferData.map();
-		}
+		FrameBuffers& buffers = frameBuffers[frame];
+
+		const vk::DeviceSize vertexBufferSize = imDrawData->TotalVtxCount * sizeof(ImDrawVert);
+		const vk::DeviceSize indexBufferSize = imDrawData->TotalIdxCount * sizeof(ImDrawIdx);
+
+		reserve(buffers.vertexBufferData, buffers.vertexCapacity, vertexBufferSize, vk::BufferUsageFlagBits::eVertexBuffer);
+		reserve(buffers.indexBufferData, buffers.indexCapacity, indexBufferSize, vk::BufferUsageFlagBits::eIndexBuffer);
 
-		// Upload data
-		ImDrawVert* vtxDst = (ImDrawVert*)vertexBufferData.mapped;
-		ImDrawIdx* idxDst = (ImDrawIdx*)indexBufferData.mapped;
+		// upload data; the memory is host coherent, so there is nothing to flush
+		ImDrawVert* vtxDst = (ImDrawVert*)buffers.vertexBufferData.mapped;
+		ImDrawIdx* idxDst = (ImDrawIdx*)buffers.indexBufferData.mapped;
 
 		for (int n = 0; n < imDrawData->CmdListsCount; n++) {
 			const ImDrawList* cmd_list = imDrawData->CmdLists[n];
@@ -547,9 +530,36 @@ namespace bento
 			vtxDst += cmd_list->VtxBuffer.Size;
 			idxDst += cmd_list->IdxBuffer.Size;
 		}
+	}
+
+	void ImGuiLayer::reserve(BufferData& bufferData, vk::DeviceSize& capacity, vk::DeviceSize size, vk::BufferUsageFlags usage)
+	{
+		if (size <= capacity)
+		{
+			return;
+		}
+
+		// grow geometrically so windows opening and closing settle on a size instead of reallocating every time
+		vk::DeviceSize newCapacity = std::max(minimumBufferSize, capacity * 2);
+		while (newCapacity < size)
+		{
+			newCapacity *= 2;
+		}
+
+		// only this frame's buffer is replaced, and the gpu is done with this frame
+		bufferData.unmap();
+		bufferData.destroy();
+
+		bufferData = VulkanUtils::createBuffer(
+			context->device,
+			newCapacity,
+			context->physicalDevice,
+			usage,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+		bufferData.map();
+		capacity = newCapacity;
 
-		// Flush to make writes visible to GPU
-		vertexBufferData.flush();
-		indexBufferData.flush();
+		BENTO_LOG_TRACE("Grew imgui buffer to {} bytes", newCapacity);
 	}
 }
@@ -6,6 +6,7 @@
 #include "ImageData.h"
 #include "VulkanContext.h"
 #include <glm/vec2.hpp>
+#include "bento/core/profiler.h"
 
 namespace bento
 {
@@ -24,7 +25,9 @@ namespace bento
 			bool displayBackground = true;
 			bool animateLight = false;
 			float lightSpeed = 0.25f;
+			// cpu and gpu milliseconds for the last 50 frames
 			std::array<float, 50> frameTimes{};
+			std::array<float, 50> gpuFrameTimes{};
 			float frameTimeMin = 9999.0f, frameTimeMax = 0.0f;
 			float lightTimer = 0.0f;
 		} uiSettings;
@@ -32,11 +35,16 @@ namespace bento
 		ImGuiLayer(VulkanContext* vulkanContext);
 		~ImGuiLayer();
 
-		void initialize(vk::RenderPass renderPass, float width, float height);
+		// renderPass is null when drawing with dynamic rendering; the pipeline is then built against colorFormat
+		void initialize(vk::RenderPass renderPass, vk::Format colorFormat, float width, float height, uint32_t framesInFlight);
+		void resize(float width, float height);
+		void clean();
 
-		void newFrame(bool updateFrameGraph);
-		void updateBuffers();
-		void drawFrame(vk::CommandBuffer commandBuffer);
+		// timing is the profiler's last frame, passed in since this runs on the render thread
+		void newFrame(const profiler::FrameTiming& timing, bool updateFrameGraph);
+		// copies the frame's draw data into that frame's buffers; the gpu must be done with the frame
+		void updateBuffers(uint32_t frame);
+		void drawFrame(vk::CommandBuffer commandBuffer, uint32_t frame);
 
 	private:
 		VulkanContext* context;
@@ -44,10 +52,18 @@ namespace bento
 		//vk::PhysicalDevice physicalDevice;
 
 		vk::UniqueSampler sampler;
-		BufferData vertexBufferData;
-		BufferData indexBufferData;
-		int32_t vertexCount = 0;
-		int32_t indexCount = 0;
+
+		// geometry buffers for one frame in flight; persistently mapped and only ever grown
+		struct FrameBuffers
+		{
+			BufferData vertexBufferData;
+			BufferData indexBufferData;
+			vk::DeviceSize vertexCapacity = 0;
+			vk::DeviceSize indexCapacity = 0;
+		};
+		std::vector<FrameBuffers> frameBuffers;
+
+		static constexpr vk::DeviceSize minimumBufferSize = 64 * 1024;
 
 		ImageData fontImageData;
 		vk::UniqueImageView fontImageView;
@@ -61,6 +77,7 @@ namespace bento
 		std::vector<vk::UniqueDescriptorSet> descriptorSets;
 
 		void setImGuiStyle(float width, float height);
-		void createResources(vk::RenderPass renderPass/*vk::RenderPass renderPass, vk::Queue copyQueue, const std::string& shadersPath*/);
+		void reserve(BufferData& bufferData, vk::DeviceSize& capacity, vk::DeviceSize size, vk::BufferUsageFlags usage);
+		void createResources(vk::RenderPass renderPass, vk::Format colorFormat/*vk::RenderPass renderPass, vk::Queue copyQueue, const std::string& shadersPath*/);
 	};
 }
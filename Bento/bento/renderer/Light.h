@@ -0,0 +1,18 @@
+#pragma once
+#include <glm/vec4.hpp>
+
+namespace bento
+{
+	// one light as the shaders see it (std430); everything is in world space
+	struct Light
+	{
+		// xyz position, w the distance at which the light has faded out
+		glm::vec4 positionRange{0.0f};
+		// rgb color, a intensity
+		glm::vec4 colorIntensity{0.0f};
+		// xyz the direction a spot light points in, w the cosine of its outer cone angle; point lights use -2 so nothing is outside the cone
+		glm::vec4 directionCone{0.0f, 0.0f, -1.0f, -2.0f};
+		// x the cosine of the inner cone angle, where the spot starts to fade; unused for point lights
+		glm::vec4 spot{-2.0f, 0.0f, 0.0f, 0.0f};
+	};
+}
@@ -0,0 +1,47 @@
+#include "bpch.h"
+#include "Material.h"
+
+#include "bento/core/hash.h"
+
+namespace bento
+{
+	uint64_t Material::key() const
+	{
+		// the lengths go in too, so moving characters from one path to the other can't give the same key
+		const uint64_t vertexLength = vertexShader.size();
+		const uint64_t fragmentLength = fragmentShader.size();
+
+		uint64_t result = hash(&vertexLength, sizeof(vertexLength));
+		result = hash(vertexShader.data(), vertexShader.size(), result);
+		result = hash(&fragmentLength, sizeof(fragmentLength), result);
+		result = hash(fragmentShader.data(), fragmentShader.size(), result);
+
+		const uint8_t state[] = {
+			static_cast<uint8_t>(vertexLayout),
+			static_cast<uint8_t>(blend),
+			static_cast<uint8_t>(cull),
+			static_cast<uint8_t>(depthTest),
+			static_cast<uint8_t>(depthWrite),
+			static_cast<uint8_t>(depthCompare)
+		};
+		return hash(state, sizeof(state), result);
+	}
+
+	Material Material::depthOnly() const
+	{
+		Material material;
+		material.vertexShader = vertexShader;
+		material.fragmentShader.clear();
+		material.vertexLayout = vertexLayout;
+		material.cull = cull;
+		return material;
+	}
+
+	Material Material::depthEqual() const
+	{
+		Material material = *this;
+		material.depthWrite = false;
+		material.depthCompare = vk::CompareOp::eEqual;
+		return material;
+	}
+}
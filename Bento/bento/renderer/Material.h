@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vulkan/vulkan.hpp>
+
+namespace bento
+{
+	enum class BlendMode : uint8_t
+	{
+		Opaque,
+		// src alpha over one minus src alpha
+		Alpha,
+		Additive
+	};
+
+	enum class CullMode : uint8_t
+	{
+		None,
+		Back,
+		Front
+	};
+
+	// which attributes of Vertex the vertex shader reads; all of them live in the same buffer either way
+	enum class VertexLayout : uint8_t
+	{
+		Standard,
+		PositionOnly
+	};
+
+	// everything about how a surface is rasterized that needs a pipeline of its own; materials that are equal share one
+	// every scene pipeline uses the renderer's pipeline layout, so the shaders have to stick to its descriptor sets
+	struct Material
+	{
+		// spir-v, relative to the working directory; without a fragment shader nothing but depth is written
+		std::string vertexShader = "shaders/vert.spv";
+		std::string fragmentShader = "shaders/frag.spv";
+		VertexLayout vertexLayout = VertexLayout::Standard;
+
+		BlendMode blend = BlendMode::Opaque;
+		CullMode cull = CullMode::None;
+
+		bool depthTest = true;
+		bool depthWrite = true;
+		vk::CompareOp depthCompare = vk::CompareOp::eLess;
+
+		// identifies the permutation; the pipeline cache is keyed on it
+		uint64_t key() const;
+
+		// whether the surface can be laid down by a depth prepass and then shaded at exactly that depth
+		bool isOpaque() const { return blend == BlendMode::Opaque && depthTest && depthWrite; }
+
+		// the same geometry with no fragment stage, for the depth prepass
+		Material depthOnly() const;
+		// shades only where the prepass left this surface's depth, without writing any
+		Material depthEqual() const;
+	};
+}
@@ -2,9 +2,7 @@
 #include "Mesh.h"
 
 #include "VulkanUtils.h"
-
-#include "ObjectUBO.h"
-#include <chrono>
+#include "Timeline.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -13,35 +11,15 @@
 
 namespace bento
 {
-	void Mesh::updateUniformBuffer(VulkanContext* context, uint32_t currentImage)
-	{
-		static auto startTime = std::chrono::high_resolution_clock::now();
-
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
-		glm::mat4 model = glm::mat4(1.0f);
-		model = glm::translate(model, position);
-		model = glm::rotate(model, time * glm::radians(90.0f), glm::vec3(0.5f, 0.0f, 1.0f));
-
-		ObjectUBO ubo{};
-		ubo.model = model;
-
-		void* data = context->device.mapMemory(transformationBufferData[currentImage].memory.get(), 0, sizeof(ubo), {});
-		memcpy(data, &ubo, sizeof(ubo));
-		context->device.unmapMemory(transformationBufferData[currentImage].memory.get());
-	}
-
-	void Mesh::setupMesh(VulkanContext* context)
+	MeshGeometry::MeshGeometry(VulkanContext* context, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint64_t contentHash)
+		: contentHash(contentHash), indexCount(static_cast<uint32_t>(indices.size()))
 	{
-		bento::log::warn("setting up mesh");
-		createVertexBuffer(context);
-		createIndexBuffer(context);
-		createUniformBuffer(context);
-		createDescriptorSet(context);
+		BENTO_LOG_TRACE("Setting up mesh geometry");
+		createVertexBuffer(context, vertices);
+		createIndexBuffer(context, indices);
 	}
 
-	void Mesh::createVertexBuffer(VulkanContext* context)
+	void MeshGeometry::createVertexBuffer(VulkanContext* context, const std::vector<Vertex>& vertices)
 	{
 		// create the staging buffer
 		vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
@@ -71,14 +49,15 @@ namespace bento
 		VulkanUtils::copyBuffer(
 			context->device,
 			context->commandPool,
-			context->queue,
+			*context->timeline,
 			stagingBufferData.buffer.get(),
 			vertexBufferData.buffer.get(), bufferSize
 		);
-		bento::log::warn("created vertex buffer");
+		context->timeline->retire(std::move(stagingBufferData));
+		BENTO_LOG_TRACE("Created vertex buffer");
 	}
 
-	void Mesh::createIndexBuffer(VulkanContext* context)
+	void MeshGeometry::createIndexBuffer(VulkanContext* context, const std::vector<uint32_t>& indices)
 	{
 		// create the staging buffer
 		vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
@@ -109,84 +88,42 @@ namespace bento
 		VulkanUtils::copyBuffer(
 			context->device,
 			context->commandPool,
-			context->queue,
+			*context->timeline,
 			stagingBufferData.buffer.get(),
 			indexBufferData.buffer.get(), bufferSize
 		);
-		bento::log::warn("created index buffer");
+		context->timeline->retire(std::move(stagingBufferData));
+		BENTO_LOG_TRACE("Created index buffer");
 	}
 
-	void Mesh::createUniformBuffer(VulkanContext* context)
+	bool MeshFactory::destroy(MeshHandle handle)
 	{
-		/*vk::DeviceSize bufferSize = sizeof(GlobalUBO);
-
-		uniformBufferData.resize(context->swapChainImageCount);
-		for (size_t i = 0; i < context->swapChainImageCount; i++) {
-			uniformBufferData[i] = VulkanUtils::createBuffer(
-				context->device,
-				bufferSize,
-				context->physicalDevice,
-				vk::BufferUsageFlagBits::eUniformBuffer,
-				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-			);
-		}*/
-
-		vk::DeviceSize transformBufferSize = sizeof(ObjectUBO);
-		transformationBufferData.resize(context->swapChainImageCount);
-
-		for (size_t i = 0; i < context->swapChainImageCount; i++) {
-			transformationBufferData[i] = VulkanUtils::createBuffer(
-				context->device,
-				transformBufferSize,
-				context->physicalDevice,
-				vk::BufferUsageFlagBits::eUniformBuffer,
-				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-			);
+		std::optional<Mesh> mesh = meshes.take(handle);
+		if (!mesh)
+		{
+			return false;
 		}
-		bento::log::warn("created uniform buffer");
-	}
 
-	void Mesh::createDescriptorSet(VulkanContext* context)
-	{
-		std::vector<vk::DescriptorSetLayout> layouts(context->swapChainImageCount, context->descriptorSetLayout);
-
-		vk::DescriptorSetAllocateInfo allocateInfo(context->descriptorPool, context->swapChainImageCount, layouts.data());
-
-		descriptorSets.resize(context->swapChainImageCount);
-		descriptorSets = context->device.allocateDescriptorSetsUnique(allocateInfo);
-
-		// populate descriptors
-		for (size_t i = 0; i < context->swapChainImageCount; i++) {
-			//vk::DescriptorBufferInfo uniformBufferInfo(uniformBufferData[i].buffer.get(), 0, sizeof(GlobalUBO));
-			vk::DescriptorBufferInfo modelMatInfo(transformationBufferData[i].buffer.get(), 0, sizeof(ObjectUBO));
-			vk::DescriptorImageInfo imageInfo(context->sampler, context->imageView, vk::ImageLayout::eShaderReadOnlyOptimal);
-
-			std::array<vk::WriteDescriptorSet, 2> descriptorWrites = {
-				vk::WriteDescriptorSet(
-					descriptorSets[i].get(),
-					0,
-					0,
-					1,
-					vk::DescriptorType::eUniformBuffer,
-					nullptr,
-					&modelMatInfo,
-					nullptr
-				),
-				vk::WriteDescriptorSet(
-					descriptorSets[i].get(),
-					1,
-					0,
-					1,
-					vk::DescriptorType::eCombinedImageSampler,
-					&imageInfo,
-					nullptr,
-					nullptr
-				)
-			};
-
-			context->device.updateDescriptorSets(descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+		// the mesh holds a handle to its geometry, so the geometry goes (if this was its last mesh) once the mesh is released
+		const uint64_t contentHash = mesh->getContentHash();
+		context->timeline->retire(std::move(*mesh));
+
+		// other meshes with the same content can still be found
+		auto it = meshesByHash.find(contentHash);
+		if (it != meshesByHash.end() && it->second == handle)
+		{
+			auto other = std::find_if(meshes.begin(), meshes.end(), [&](const Mesh& m) { return m.getContentHash() == contentHash; });
+			if (other != meshes.end())
+			{
+				it->second = meshes.handleAt(other - meshes.begin());
+			}
+			else
+			{
+				meshesByHash.erase(it);
+			}
 		}
 
-		bento::log::warn("created descriptor sets");
+		BENTO_LOG_TRACE("Retired mesh");
+		return true;
 	}
 }
@@ -1,7 +1,12 @@
 #pragma once
+#include <glm/mat4x4.hpp>
 #include "Vertex.h"
 #include "VulkanContext.h"
 #include "BufferData.h"
+#include "Material.h"
+#include "AssetCache.h"
+#include "bento/core/hash.h"
+#include "bento/core/SlotMap.h"
 
 namespace bento
 {
@@ -9,15 +14,35 @@ namespace bento
 	class Mesh;
 	class MeshFactory;
 
+	// the vertex and index buffers of one piece of geometry; shared by every mesh with the same content through the asset cache
+	class MeshGeometry
+	{
+	public:
+		MeshGeometry(VulkanContext* context, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint64_t contentHash);
+
+		vk::Buffer getVertexBuffer() const { return vertexBufferData.buffer.get(); }
+		vk::Buffer getIndexBuffer() const { return indexBufferData.buffer.get(); }
+		uint32_t getIndexCount() const { return indexCount; }
+		uint64_t getContentHash() const { return contentHash; }
+
+	private:
+		uint64_t contentHash;
+		uint32_t indexCount;
+
+		BufferData vertexBufferData;
+		BufferData indexBufferData;
+
+		void createVertexBuffer(VulkanContext* context, const std::vector<Vertex>& vertices);
+		void createIndexBuffer(VulkanContext* context, const std::vector<uint32_t>& indices);
+	};
+
 	class Mesh
 	{
 	public:
-		std::vector<Vertex> vertices;
-		std::vector<uint32_t> indices;
 		// Texture
-		Mesh(MeshFactory& manager, VulkanContext* context, std::vector<Vertex> vertices, std::vector<uint32_t> indices, glm::vec3 position) : vertices(vertices), indices(indices), manager(manager), position(position)
+		// placed by the entities that draw it, through their instances
+		Mesh(GeometryHandle geometry) : geometry(std::move(geometry))
 		{
-			setupMesh(context);
 			setrandoms();
 		}
 
@@ -28,66 +53,81 @@ namespace bento
 			//std::cout << "Random is " << random << std::endl;
 		}
 
-		vk::Buffer getVertexBufferData() { return vertexBufferData.buffer.get(); }
-		vk::Buffer getIndexBufferData() { return indexBufferData.buffer.get(); }
-		vk::DescriptorSet getDescriptorSet(int frame) { return descriptorSets[frame].get(); }
-		//vk::Buffer getIndexBufferData() { return &indexBufferData; }
+		vk::Buffer getVertexBufferData() { return geometry->getVertexBuffer(); }
+		vk::Buffer getIndexBufferData() { return geometry->getIndexBuffer(); }
+		uint32_t getIndexCount() const { return geometry->getIndexCount(); }
+		const GeometryHandle& getGeometry() const { return geometry; }
 
-		void updateUniformBuffer(VulkanContext* context, uint32_t currentImage);
+		// identifies the mesh by its geometry so scenes can reference it independent of load order
+		uint64_t getContentHash() const { return geometry->getContentHash(); }
+
+		// the pipeline is looked up every frame, so this applies from the next one
+		void setMaterial(const Material& material) { this->material = material; }
+		const Material& getMaterial() const { return material; }
 
 	private:
-		glm::vec3 position;
+		GeometryHandle geometry;
+		Material material;
 		float xpos = 0.f;
 		float random;
-
-		MeshFactory& manager;
-
-		BufferData vertexBufferData;
-		BufferData indexBufferData;
-		//std::vector<BufferData> uniformBufferData;
-		std::vector<BufferData> transformationBufferData;
-
-		std::vector<vk::UniqueDescriptorSet> descriptorSets;
-
-		void setupMesh(VulkanContext* context);
-		void createVertexBuffer(VulkanContext* context);
-		void createIndexBuffer(VulkanContext* context);
-		void createUniformBuffer(VulkanContext* context);
-		void createDescriptorSet(VulkanContext* context);
 	};
 
+	// 32 bits, so components and packets can refer to a mesh without a pointer into storage that moves
+	using MeshHandle = Handle<Mesh>;
+
 	class MeshFactory
 	{
 	public:
-		MeshFactory(VulkanContext* context) : context(context) { }
+		MeshFactory(VulkanContext* context, AssetCache* assets) : context(context), assets(assets) { }
+
+		// geometry already loaded for another mesh is shared rather than uploaded again
+		MeshHandle create(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+		{
+			return create(assets->loadGeometry(vertices, indices));
+		}
 
-		Mesh& create(std::vector<Vertex> vertices, std::vector<uint32_t> indices, glm::vec3 position)
+		MeshHandle create(GeometryHandle geometry)
 		{
-			Mesh* mesh = new Mesh(*this, context, vertices, indices, position);
-			std::unique_ptr<Mesh> uPtr{ mesh };
-			meshes.emplace_back(std::move(uPtr));
+			const uint64_t contentHash = geometry->getContentHash();
+			const MeshHandle handle = meshes.emplace(std::move(geometry));
+			meshesByHash[contentHash] = handle;
 
-			return *mesh;
+			return handle;
 		}
 
-		// not great; correctly implemented, unique pointers should remove the need for this!
-		void clean()
+		// nullptr once the mesh has been destroyed, even if its slot has been reused since
+		// creating or destroying meshes moves the others, so don't hold on to the pointer
+		Mesh* get(MeshHandle handle) { return meshes.get(handle); }
+
+		// resolves a MeshComponent reference to one of the meshes with that content; an invalid handle if there is none
+		MeshHandle findHandle(uint64_t contentHash)
 		{
-			for (auto& mesh : meshes)
-			{
-				const auto meshPtr = mesh.release();
-				delete meshPtr;
-			}
+			auto it = meshesByHash.find(contentHash);
+			return it != meshesByHash.end() ? it->second : MeshHandle();
 		}
+		Mesh* find(uint64_t contentHash) { return meshes.get(findHandle(contentHash)); }
+
+		// removes the mesh now; it is released once the frames that may still draw it have finished,
+		// and its geometry with it if no other mesh shares it. entities still referencing it are no longer drawn
+		bool destroy(MeshHandle handle);
+		// destroys one of the meshes with that content
+		bool destroy(uint64_t contentHash) { return destroy(findHandle(contentHash)); }
 
-		//std::vector<std::unique_ptr<Mesh>>* getMeshes() { return &meshes; }
+		void clean()
+		{
+			meshes.clear();
+			meshesByHash.clear();
+		}
 
-		Mesh* getMesh(const unsigned int iterator) { return meshes[iterator].get(); }
-		int count() const { return meshes.size(); }
+		// dense, for drawing every mesh; the order changes whenever a mesh is destroyed
+		Mesh* getMesh(const unsigned int iterator) { return &meshes[iterator]; }
+		int count() const { return static_cast<int>(meshes.size()); }
 
 	private:
 		VulkanContext* context;
+		AssetCache* assets;
 
-		std::vector<std::unique_ptr<Mesh>> meshes;
+		SlotMap<Mesh> meshes;
+		std::unordered_map<uint64_t, MeshHandle> meshesByHash;
 	};
 }
\ No newline at end of file
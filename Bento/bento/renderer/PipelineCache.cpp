@@ -0,0 +1,356 @@
+#include "bpch.h"
+#include "PipelineCache.h"
+
+#include "Shader.h"
+#include "Vertex.h"
+
+#include <optional>
+
+#include "bento/core/log.h"
+
+namespace bento
+{
+	PipelineCache::~PipelineCache()
+	{
+		clean();
+	}
+
+	void PipelineCache::initialize(vk::Device device, vk::PipelineLayout layout, const PipelineTargets& targets, uint32_t workerCount)
+	{
+		this->device = device;
+		this->layout = layout;
+		this->targets = targets;
+
+		driverCache = device.createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
+
+		stopping = false;
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			workers.emplace_back(&PipelineCache::work, this);
+		}
+
+		BENTO_LOG_TRACE("Created pipeline cache with {} workers", workerCount);
+	}
+
+	void PipelineCache::clean()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			queue.clear();
+		}
+		queued.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		workers.clear();
+
+		entries.clear();
+		handles.clear();
+		driverCache.reset();
+	}
+
+	vk::Pipeline PipelineCache::require(const Material& material)
+	{
+		const uint64_t key = material.key();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = handles.find(key);
+			if (it != handles.end())
+			{
+				Entry* entry = entries.get(it->second);
+				if (entry->state == State::Ready)
+				{
+					return entry->pipeline.get();
+				}
+			}
+		}
+
+		// failing to build a default is as fatal as it was before there was a cache, so this one throws
+		vk::UniquePipeline pipeline = build(material);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		Entry* entry = entries.get(acquire(key).first);
+		// a worker may have finished the same material in the meantime; the one built here is then just dropped
+		if (entry->state != State::Ready)
+		{
+			entry->pipeline = std::move(pipeline);
+			entry->state = State::Ready;
+		}
+		return entry->pipeline.get();
+	}
+
+	vk::Pipeline PipelineCache::get(const Material& material, vk::Pipeline fallback)
+	{
+		return get(handleFor(material), fallback);
+	}
+
+	PipelineHandle PipelineCache::handleFor(const Material& material)
+	{
+		const uint64_t key = material.key();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		auto [handle, created] = acquire(key);
+		if (created)
+		{
+			queue.emplace_back(handle, material);
+			lock.unlock();
+			queued.notify_one();
+		}
+
+		return handle;
+	}
+
+	vk::Pipeline PipelineCache::get(PipelineHandle handle, vk::Pipeline fallback)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const Entry* entry = entries.get(handle);
+		return entry && entry->state == State::Ready ? entry->pipeline.get() : fallback;
+	}
+
+	std::pair<PipelineHandle, bool> PipelineCache::acquire(uint64_t key)
+	{
+		auto it = handles.find(key);
+		if (it != handles.end())
+		{
+			return { it->second, false };
+		}
+
+		const PipelineHandle handle = entries.emplace();
+		handles.emplace(key, handle);
+		return { handle, true };
+	}
+
+	void PipelineCache::waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		drained.wait(lock, [this] { return queue.empty() && building == 0; });
+	}
+
+	void PipelineCache::work()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			queued.wait(lock, [this] { return stopping || !queue.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+
+			auto [handle, material] = std::move(queue.front());
+			queue.pop_front();
+
+			// require may have built it on another thread while it sat in the queue
+			if (entries.get(handle)->state != State::Queued)
+			{
+				continue;
+			}
+
+			building++;
+			lock.unlock();
+
+			vk::UniquePipeline pipeline;
+			bool failed = false;
+			try
+			{
+				pipeline = build(material);
+			}
+			catch (const std::exception& e)
+			{
+				BENTO_LOG_ERROR("Failed to build the pipeline for {} / {}: {}", material.vertexShader, material.fragmentShader, e.what());
+				failed = true;
+			}
+
+			lock.lock();
+			building--;
+
+			// looked up again, since entries may have been added (and moved) while building
+			Entry* entry = entries.get(handle);
+			if (entry->state == State::Queued)
+			{
+				entry->pipeline = std::move(pipeline);
+				entry->state = failed ? State::Failed : State::Ready;
+			}
+
+			if (queue.empty() && building == 0)
+			{
+				drained.notify_all();
+			}
+		}
+	}
+
+	vk::UniquePipeline PipelineCache::build(const Material& material) const
+	{
+		vk::Device device = this->device;
+
+		// assign the shaders to a specific pipeline stage; a depth only material has no fragment stage at all
+		const bool depthOnly = material.fragmentShader.empty();
+		Shader vertexShader(device, material.vertexShader.c_str());
+		std::optional<Shader> fragmentShader;
+		if (!depthOnly)
+		{
+			fragmentShader.emplace(device, material.fragmentShader.c_str());
+		}
+
+		std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = {
+			vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertexShader.shaderModule.get(), "main"),
+			vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, depthOnly ? nullptr : fragmentShader->shaderModule.get(), "main")
+		};
+
+		// describe the format of the vertex data; every layout reads from the same interleaved Vertex buffer
+		auto bindingDescription = Vertex::getBindingDescription();
+		auto attributeDescriptions = Vertex::getAttributeDescriptions();
+
+		vk::PipelineVertexInputStateCreateInfo vertexInputInfo(
+			{},
+			1,
+			&bindingDescription,
+			material.vertexLayout == VertexLayout::PositionOnly ? 1 : static_cast<uint32_t>(attributeDescriptions.size()),
+			attributeDescriptions.data()
+		);
+
+		// describe the kind of geometry being drawn and if primitive restart should be enabled
+		vk::PipelineInputAssemblyStateCreateInfo inputAssembly(
+			{},
+			vk::PrimitiveTopology::eTriangleList,
+			false
+		);
+
+		// the viewport and scissor are set while recording, so the pipeline doesn't depend on the swap chain extent
+		vk::PipelineViewportStateCreateInfo viewportState(
+			{},
+			1,
+			nullptr,
+			1,
+			nullptr
+		);
+
+		std::array<vk::DynamicState, 2> dynamicStates = {
+			vk::DynamicState::eViewport,
+			vk::DynamicState::eScissor
+		};
+		vk::PipelineDynamicStateCreateInfo dynamicState({}, dynamicStates.size(), dynamicStates.data());
+
+		vk::CullModeFlags cullMode = vk::CullModeFlagBits::eNone;
+		switch (material.cull)
+		{
+			case CullMode::Back: cullMode = vk::CullModeFlagBits::eBack; break;
+			case CullMode::Front: cullMode = vk::CullModeFlagBits::eFront; break;
+			default: break;
+		}
+
+		vk::PipelineRasterizationStateCreateInfo rasterizer(
+			{},
+			false,
+			false,
+			vk::PolygonMode::eFill,
+			cullMode,
+			vk::FrontFace::eCounterClockwise,
+			false,
+			0.0f,
+			0.0f,
+			0.0f,
+			1.0f
+		);
+
+		// the sample count has to match the attachments drawn into
+		vk::PipelineMultisampleStateCreateInfo multisampling(
+			{},
+			targets.samples,
+			false,
+			1.0f,
+			nullptr,
+			false,
+			false
+		);
+
+		// not using stencil for now
+		vk::PipelineDepthStencilStateCreateInfo depthStencil(
+			{},
+			material.depthTest,
+			material.depthWrite,
+			material.depthCompare,
+			false,
+			false,
+			{},
+			{},
+			0.0f,
+			1.0f
+		);
+
+		vk::PipelineColorBlendAttachmentState colorBlendAttachment(
+			false,
+			vk::BlendFactor::eOne,
+			vk::BlendFactor::eZero,
+			vk::BlendOp::eAdd,
+			vk::BlendFactor::eOne,
+			vk::BlendFactor::eZero,
+			vk::BlendOp::eAdd,
+			vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+		);
+		switch (material.blend)
+		{
+			case BlendMode::Alpha:
+				colorBlendAttachment.blendEnable = true;
+				colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+				colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+				colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+				break;
+			case BlendMode::Additive:
+				colorBlendAttachment.blendEnable = true;
+				colorBlendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+				colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOne;
+				colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eZero;
+				colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eOne;
+				break;
+			default:
+				break;
+		}
+		if (depthOnly)
+		{
+			colorBlendAttachment.colorWriteMask = vk::ColorComponentFlags();
+		}
+
+		vk::PipelineColorBlendStateCreateInfo colorBlending(
+			{},
+			false,
+			vk::LogicOp::eCopy,
+			1,
+			&colorBlendAttachment
+		);
+
+		vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
+			{},									// flags
+			depthOnly ? 1 : 2,							// stageCount
+			shaderStages.data(),						// pStages
+			&vertexInputInfo,							// pVertexInputState
+			&inputAssembly,								// pInputAssemblyState
+			nullptr,									// pTessellationState
+			&viewportState,								// pViewportState
+			&rasterizer,								// pRasterizationState
+			&multisampling,								// pMultisampleState
+			&depthStencil,								// pDepthStencilState
+			&colorBlending,								// pColorBlendState
+			&dynamicState,								// pDynamicState
+			layout,										// layout
+			targets.renderPass							// renderPass; null with dynamic rendering
+		);
+
+		// with dynamic rendering the pipeline is built against the attachment formats instead of a render pass
+		vk::PipelineRenderingCreateInfoKHR renderingInfo(
+			0,
+			1,
+			&targets.colorFormat,
+			targets.depthFormat
+		);
+		if (!targets.renderPass)
+		{
+			graphicsPipelineCreateInfo.pNext = &renderingInfo;
+		}
+
+		return device.createGraphicsPipelineUnique(driverCache.get(), graphicsPipelineCreateInfo);
+	}
+}
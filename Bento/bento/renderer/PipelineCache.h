@@ -0,0 +1,90 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <unordered_map>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Material.h"
+#include "bento/core/SlotMap.h"
+
+namespace bento
+{
+	// what the scene's pipelines draw into; they are all built against the same targets
+	struct PipelineTargets
+	{
+		// null with dynamic rendering, where the formats are used instead
+		vk::RenderPass renderPass;
+		vk::Format colorFormat = vk::Format::eUndefined;
+		vk::Format depthFormat = vk::Format::eUndefined;
+		vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+	};
+
+	struct PipelineTag;
+	using PipelineHandle = Handle<PipelineTag>;
+
+	// the scene's pipelines by material key, built on demand on a few background threads so recording never waits on a compile
+	// pipelines live until clean; there are only ever as many as there are distinct materials
+	class PipelineCache
+	{
+	public:
+		~PipelineCache();
+
+		void initialize(vk::Device device, vk::PipelineLayout layout, const PipelineTargets& targets, uint32_t workerCount);
+		// stops the workers (finishing the pipeline each is on) and destroys every pipeline
+		void clean();
+
+		// builds the material's pipeline on the calling thread if it isn't there yet; for the defaults that stand in for the rest
+		vk::Pipeline require(const Material& material);
+		// the material's pipeline if it has been built; otherwise it is queued (once) and fallback is returned in the meantime
+		// a material whose pipeline fails to build keeps getting the fallback
+		vk::Pipeline get(const Material& material, vk::Pipeline fallback);
+
+		// the material's slot, created (and queued) on first use; stays the same for as long as the cache lives,
+		// so it can be kept instead of hashing the material again
+		PipelineHandle handleFor(const Material& material);
+		// the pipeline behind a handle if it has been built, otherwise fallback
+		vk::Pipeline get(PipelineHandle handle, vk::Pipeline fallback);
+
+		// blocks until nothing is queued or being built, e.g. before a benchmark starts measuring
+		void waitIdle();
+
+	private:
+		enum class State
+		{
+			Queued,
+			Ready,
+			Failed
+		};
+
+		struct Entry
+		{
+			State state = State::Queued;
+			vk::UniquePipeline pipeline;
+		};
+
+		// finds or creates the material's entry; call with the mutex held. the bool is true if it was created
+		std::pair<PipelineHandle, bool> acquire(uint64_t key);
+		vk::UniquePipeline build(const Material& material) const;
+		void work();
+
+		vk::Device device;
+		vk::PipelineLayout layout;
+		PipelineTargets targets;
+		// shared by every build so the driver can reuse what it compiled for earlier permutations
+		vk::UniquePipelineCache driverCache;
+
+		std::mutex mutex;
+		std::condition_variable queued;
+		std::condition_variable drained;
+		// entries move whenever one is added, so only ever hold on to a handle, and only dereference it under the mutex
+		SlotMap<Entry, PipelineTag> entries;
+		std::unordered_map<uint64_t, PipelineHandle> handles;
+		std::deque<std::pair<PipelineHandle, Material>> queue;
+		uint32_t building = 0;
+		bool stopping = false;
+		std::vector<std::thread> workers;
+	};
+}
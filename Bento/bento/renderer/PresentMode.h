@@ -0,0 +1,17 @@
+#pragma once
+
+namespace bento
+{
+	// how finished frames are handed to the display
+	enum class PresentMode
+	{
+		// fifo; never tears, and the cpu is held back to the refresh rate once the queue is full
+		Vsync,
+		// the newest frame replaces any still waiting; no tearing, and rendering is never blocked by the display
+		Mailbox,
+		// shown as soon as it is ready; may tear, lowest latency and highest throughput
+		Immediate,
+		// fifo, except that a frame which missed its refresh is shown right away (and may tear) instead of a whole refresh later
+		FifoRelaxed
+	};
+}
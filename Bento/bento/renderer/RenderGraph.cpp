@@ -0,0 +1,718 @@
+#include "bpch.h"
+#include "RenderGraph.h"
+#include "Timeline.h"
+#include "VulkanUtils.h"
+
+#include <numeric>
+
+#include "bento/core/log.h"
+
+namespace bento
+{
+	namespace
+	{
+		const vk::AccessFlags writeAccessMask =
+			vk::AccessFlagBits::eColorAttachmentWrite |
+			vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+			vk::AccessFlagBits::eTransferWrite |
+			vk::AccessFlagBits::eShaderWrite;
+
+		bool isDepthFormat(vk::Format format)
+		{
+			switch (format)
+			{
+			case vk::Format::eD16Unorm:
+			case vk::Format::eX8D24UnormPack32:
+			case vk::Format::eD32Sfloat:
+			case vk::Format::eD16UnormS8Uint:
+			case vk::Format::eD24UnormS8Uint:
+			case vk::Format::eD32SfloatS8Uint:
+				return true;
+			default:
+				return false;
+			}
+		}
+	}
+
+	void RenderGraph::PassBuilder::writeColor(Image image, std::optional<vk::ClearColorValue> clear, std::optional<Image> resolve)
+	{
+		graph.use(pass, image, Access::ColorWrite, clear ? std::optional<vk::ClearValue>(vk::ClearValue(*clear)) : std::nullopt);
+		if (!resolve)
+		{
+			return;
+		}
+
+		graph.use(pass, *resolve, Access::ColorResolve, std::nullopt);
+		if (graph.resources[image].samples == vk::SampleCountFlagBits::e1 || graph.resources[*resolve].samples != vk::SampleCountFlagBits::e1)
+		{
+			throw std::logic_error("only a multisampled image can be resolved, and only into a single sampled one!");
+		}
+
+		// the color write is the use before the resolve
+		Pass& owner = graph.passes[pass];
+		owner.uses[owner.uses.size() - 2].resolve = resolve;
+	}
+
+	void RenderGraph::PassBuilder::writeDepth(Image image, std::optional<vk::ClearDepthStencilValue> clear)
+	{
+		graph.use(pass, image, Access::DepthWrite, clear ? std::optional<vk::ClearValue>(vk::ClearValue(*clear)) : std::nullopt);
+	}
+
+	void RenderGraph::PassBuilder::sample(Image image)
+	{
+		graph.use(pass, image, Access::Sampled, std::nullopt);
+	}
+
+	void RenderGraph::PassBuilder::copyFrom(Image image)
+	{
+		graph.use(pass, image, Access::TransferSource, std::nullopt);
+	}
+
+	void RenderGraph::PassBuilder::copyTo(Image image)
+	{
+		graph.use(pass, image, Access::TransferDestination, std::nullopt);
+	}
+
+	void RenderGraph::PassBuilder::sideEffect()
+	{
+		graph.passes[pass].sideEffect = true;
+	}
+
+	void RenderGraph::initialize(vk::Device device, VmaAllocator allocator, PFN_vkCmdBeginRenderingKHR beginRendering, PFN_vkCmdEndRenderingKHR endRendering)
+	{
+		this->device = device;
+		this->allocator = allocator;
+		this->beginRendering = beginRendering;
+		this->endRendering = endRendering;
+	}
+
+	RenderGraph::Image RenderGraph::importImage(const std::string& name, vk::Format format, vk::Extent2D extent,
+	                                            vk::ImageLayout finalLayout, vk::PipelineStageFlags finalStages, vk::AccessFlags finalAccess)
+	{
+		const Image image = createImage(name, format, extent);
+
+		Resource& resource = resources[image];
+		resource.imported = true;
+		resource.finalLayout = finalLayout;
+		resource.finalStages = finalStages;
+		resource.finalAccess = finalAccess;
+
+		return image;
+	}
+
+	RenderGraph::Image RenderGraph::createImage(const std::string& name, vk::Format format, vk::Extent2D extent, vk::SampleCountFlagBits samples)
+	{
+		if (compiled)
+		{
+			throw std::logic_error("render graph is already compiled!");
+		}
+
+		Resource resource;
+		resource.name = name;
+		resource.format = format;
+		resource.extent = extent;
+		resource.samples = samples;
+		resource.aspect = vk::ImageAspectFlagBits::eColor;
+		if (isDepthFormat(format))
+		{
+			resource.aspect = vk::ImageAspectFlagBits::eDepth;
+			if (VulkanUtils::hasStencilComponent(format))
+			{
+				resource.aspect |= vk::ImageAspectFlagBits::eStencil;
+			}
+		}
+
+		resources.push_back(std::move(resource));
+		return static_cast<Image>(resources.size() - 1);
+	}
+
+	void RenderGraph::addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, Execute execute)
+	{
+		if (compiled)
+		{
+			throw std::logic_error("render graph is already compiled!");
+		}
+
+		Pass pass;
+		pass.name = name;
+		pass.execute = std::move(execute);
+		passes.push_back(std::move(pass));
+
+		PassBuilder builder(*this, static_cast<uint32_t>(passes.size() - 1));
+		setup(builder);
+	}
+
+	void RenderGraph::use(uint32_t pass, Image image, Access access, std::optional<vk::ClearValue> clear)
+	{
+		if (image >= resources.size())
+		{
+			throw std::out_of_range("render graph image doesn't exist!");
+		}
+
+		Use use;
+		use.image = image;
+		use.access = access;
+		use.clear = clear;
+		passes[pass].uses.push_back(use);
+
+		resources[image].usage |= describe(use).usage;
+	}
+
+	RenderGraph::AccessInfo RenderGraph::describe(const Use& use)
+	{
+		// attachments that aren't cleared are read before they are written
+		const bool loads = use.loadOp == vk::AttachmentLoadOp::eLoad;
+
+		switch (use.access)
+		{
+		case Access::ColorWrite:
+			return {
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::AccessFlagBits::eColorAttachmentWrite | (loads ? vk::AccessFlagBits::eColorAttachmentRead : vk::AccessFlags()),
+				vk::ImageLayout::eColorAttachmentOptimal,
+				vk::ImageUsageFlagBits::eColorAttachment,
+				true
+			};
+		case Access::ColorResolve:
+			return {
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::AccessFlagBits::eColorAttachmentWrite,
+				vk::ImageLayout::eColorAttachmentOptimal,
+				vk::ImageUsageFlagBits::eColorAttachment,
+				true
+			};
+		case Access::DepthWrite:
+			return {
+				vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+				vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+				vk::ImageLayout::eDepthStencilAttachmentOptimal,
+				vk::ImageUsageFlagBits::eDepthStencilAttachment,
+				true
+			};
+		case Access::Sampled:
+			return {
+				vk::PipelineStageFlagBits::eFragmentShader,
+				vk::AccessFlagBits::eShaderRead,
+				vk::ImageLayout::eShaderReadOnlyOptimal,
+				vk::ImageUsageFlagBits::eSampled,
+				false
+			};
+		case Access::TransferSource:
+			return {
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::AccessFlagBits::eTransferRead,
+				vk::ImageLayout::eTransferSrcOptimal,
+				vk::ImageUsageFlagBits::eTransferSrc,
+				false
+			};
+		case Access::TransferDestination:
+			return {
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::AccessFlagBits::eTransferWrite,
+				vk::ImageLayout::eTransferDstOptimal,
+				vk::ImageUsageFlagBits::eTransferDst,
+				true
+			};
+		}
+
+		throw std::logic_error("unknown render graph access!");
+	}
+
+	void RenderGraph::compile()
+	{
+		if (compiled)
+		{
+			throw std::logic_error("render graph is already compiled!");
+		}
+
+		cull();
+
+		// lifetimes, in pass order
+		for (uint32_t p = 0; p < passes.size(); p++)
+		{
+			if (passes[p].culled) continue;
+
+			for (const Use& use : passes[p].uses)
+			{
+				Resource& resource = resources[use.image];
+				resource.firstUse = std::min(resource.firstUse, p);
+				resource.lastUse = std::max(resource.lastUse, p);
+			}
+		}
+
+		// an attachment nothing reads afterwards doesn't have to be written back to memory
+		for (uint32_t p = 0; p < passes.size(); p++)
+		{
+			if (passes[p].culled) continue;
+
+			for (Use& use : passes[p].uses)
+			{
+				if (use.access != Access::ColorWrite && use.access != Access::DepthWrite) continue;
+
+				const Resource& resource = resources[use.image];
+				if (use.clear)
+				{
+					use.loadOp = vk::AttachmentLoadOp::eClear;
+				}
+				else
+				{
+					use.loadOp = resource.firstUse < p ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eDontCare;
+				}
+				use.storeOp = resource.imported || resource.lastUse > p ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+			}
+		}
+
+		const std::vector<Image> predecessors = allocateTransients();
+
+		// the first use of each image waits on the last use of whatever was in its memory before, which is only known once the frame has been walked;
+		// so walk it once from nothing, then again from where the previous frame leaves off
+		const std::vector<State> finalStates = placeBarriers();
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			resources[i].previous = finalStates[predecessors[i]];
+		}
+		placeBarriers();
+
+		compiled = true;
+
+		size_t alive = 0;
+		for (const Pass& pass : passes)
+		{
+			if (!pass.culled) alive++;
+		}
+		BENTO_LOG_TRACE("Compiled render graph; {} of {} passes, {} transient allocations", alive, passes.size(), allocations.size());
+	}
+
+	void RenderGraph::cull()
+	{
+		// walk back from the imported images, keeping only passes that write something a kept pass (or the outside) reads
+		std::vector<bool> needed(resources.size(), false);
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			needed[i] = resources[i].imported;
+		}
+
+		for (size_t p = passes.size(); p-- > 0;)
+		{
+			Pass& pass = passes[p];
+
+			bool contributes = pass.sideEffect;
+			for (const Use& use : pass.uses)
+			{
+				if (describe(use).write && needed[use.image])
+				{
+					contributes = true;
+				}
+			}
+
+			pass.culled = !contributes;
+			if (pass.culled)
+			{
+				BENTO_LOG_TRACE("Culled render graph pass '{}'", pass.name);
+				continue;
+			}
+
+			for (const Use& use : pass.uses)
+			{
+				// a resolve overwrites the whole image, like a clear
+				const bool reads = !describe(use).write || (!use.clear && use.access != Access::ColorResolve);
+				if (reads)
+				{
+					needed[use.image] = true;
+				}
+			}
+		}
+	}
+
+	std::vector<RenderGraph::State> RenderGraph::placeBarriers()
+	{
+		// every image starts the frame with its contents discarded
+		std::vector<State> states(resources.size());
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			states[i] = resources[i].previous;
+			states[i].layout = vk::ImageLayout::eUndefined;
+		}
+
+		for (Pass& pass : passes)
+		{
+			pass.barriers = BarrierBatch();
+			if (pass.culled) continue;
+
+			for (const Use& use : pass.uses)
+			{
+				const AccessInfo info = describe(use);
+				State& state = states[use.image];
+
+				bool needed = false;
+				vk::PipelineStageFlags srcStages;
+				if (state.layout != info.layout)
+				{
+					needed = true;
+					srcStages = state.writeStages | state.readStages;
+				}
+				else if (info.write)
+				{
+					// write after write, or write after read
+					needed = state.writeStages || state.readStages;
+					srcStages = state.writeStages | state.readStages;
+				}
+				else
+				{
+					// read after write, unless an earlier barrier already made the write visible to this stage
+					needed = state.writeStages && (state.readStages & info.stages) != info.stages;
+					srcStages = state.writeStages;
+				}
+
+				if (needed)
+				{
+					pass.barriers.srcStages |= srcStages ? srcStages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+					pass.barriers.dstStages |= info.stages;
+					pass.barriers.barriers.push_back({ use.image, state.layout, info.layout, state.writeAccess, info.access });
+				}
+
+				if (info.write)
+				{
+					state.writeStages = info.stages;
+					state.writeAccess = info.access & writeAccessMask;
+					state.readStages = vk::PipelineStageFlags();
+				}
+				else if (state.layout != info.layout)
+				{
+					// the transition is a write of its own, finished by the time this stage runs
+					state.writeStages = info.stages;
+					state.writeAccess = vk::AccessFlags();
+					state.readStages = info.stages;
+				}
+				else
+				{
+					state.readStages |= info.stages;
+				}
+				state.layout = info.layout;
+			}
+		}
+
+		finalBarriers = BarrierBatch();
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			const Resource& resource = resources[i];
+			State& state = states[i];
+			if (!resource.imported || state.layout == resource.finalLayout) continue;
+
+			const vk::PipelineStageFlags srcStages = state.writeStages | state.readStages;
+			finalBarriers.srcStages |= srcStages ? srcStages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+			finalBarriers.dstStages |= resource.finalStages;
+			finalBarriers.barriers.push_back({ static_cast<Image>(i), state.layout, resource.finalLayout, state.writeAccess, resource.finalAccess });
+
+			state.layout = resource.finalLayout;
+			state.writeStages = resource.finalStages;
+			state.writeAccess = resource.finalAccess;
+			state.readStages = vk::PipelineStageFlags();
+		}
+
+		return states;
+	}
+
+	std::vector<RenderGraph::Image> RenderGraph::allocateTransients()
+	{
+		std::vector<Image> predecessors(resources.size());
+		std::iota(predecessors.begin(), predecessors.end(), 0);
+
+		// attachments whose contents never leave the tile memory can live in lazily allocated memory
+		std::vector<bool> lazy(resources.size(), true);
+		for (const Pass& pass : passes)
+		{
+			if (pass.culled) continue;
+
+			for (const Use& use : pass.uses)
+			{
+				const bool attachment = use.access == Access::ColorWrite || use.access == Access::DepthWrite;
+				if (!attachment || use.loadOp == vk::AttachmentLoadOp::eLoad || use.storeOp == vk::AttachmentStoreOp::eStore)
+				{
+					lazy[use.image] = false;
+				}
+			}
+		}
+
+		std::vector<Image> transients;
+		std::vector<vk::MemoryRequirements> requirements(resources.size());
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			Resource& resource = resources[i];
+			if (resource.imported || resource.firstUse == UINT32_MAX) continue;
+
+			if (lazy[i])
+			{
+				resource.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+			}
+
+			vk::ImageCreateInfo imageInfo(
+				{},
+				vk::ImageType::e2D,
+				resource.format,
+				vk::Extent3D(resource.extent.width, resource.extent.height, 1),
+				1,
+				1,
+				resource.samples,
+				vk::ImageTiling::eOptimal,
+				resource.usage,
+				vk::SharingMode::eExclusive,
+				0,
+				nullptr,
+				vk::ImageLayout::eUndefined
+			);
+			resource.ownedImage = device.createImageUnique(imageInfo);
+			resource.image = resource.ownedImage.get();
+			requirements[i] = device.getImageMemoryRequirements(resource.image);
+
+			transients.push_back(static_cast<Image>(i));
+		}
+
+		// largest first, each into the first allocation where nothing else is alive at the same time
+		std::sort(transients.begin(), transients.end(), [&](Image a, Image b) { return requirements[a].size > requirements[b].size; });
+
+		struct Block
+		{
+			vk::MemoryRequirements requirements;
+			bool lazy;
+			std::vector<Image> occupants;
+		};
+		std::vector<Block> blocks;
+
+		for (Image image : transients)
+		{
+			const Resource& resource = resources[image];
+			const vk::MemoryRequirements& required = requirements[image];
+
+			Block* placed = nullptr;
+			for (Block& block : blocks)
+			{
+				if (block.lazy != lazy[image] || !(block.requirements.memoryTypeBits & required.memoryTypeBits)) continue;
+
+				const bool free = std::none_of(block.occupants.begin(), block.occupants.end(), [&](Image occupant)
+				{
+					return resources[occupant].firstUse <= resource.lastUse && resource.firstUse <= resources[occupant].lastUse;
+				});
+
+				if (free)
+				{
+					placed = &block;
+					break;
+				}
+			}
+
+			if (!placed)
+			{
+				blocks.push_back({ required, lazy[image], {} });
+				placed = &blocks.back();
+			}
+
+			placed->requirements.size = std::max(placed->requirements.size, required.size);
+			placed->requirements.alignment = std::max(placed->requirements.alignment, required.alignment);
+			placed->requirements.memoryTypeBits &= required.memoryTypeBits;
+			placed->occupants.push_back(image);
+		}
+
+		for (Block& block : blocks)
+		{
+			VmaAllocationCreateInfo allocationInfo = {};
+			allocationInfo.usage = block.lazy ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY;
+
+			const VkMemoryRequirements memoryRequirements = block.requirements;
+			VmaAllocation allocation;
+			VkResult result = vmaAllocateMemory(allocator, &memoryRequirements, &allocationInfo, &allocation, nullptr);
+			if (result != VK_SUCCESS && block.lazy)
+			{
+				// most desktop gpus have no lazily allocated memory; transient images still work in ordinary memory
+				allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+				result = vmaAllocateMemory(allocator, &memoryRequirements, &allocationInfo, &allocation, nullptr);
+			}
+			if (result != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate render graph memory!");
+			}
+			allocations.push_back(allocation);
+
+			// in the order they are used, each waiting for the one before; the first waits for the last of the previous frame
+			std::sort(block.occupants.begin(), block.occupants.end(), [&](Image a, Image b) { return resources[a].firstUse < resources[b].firstUse; });
+
+			for (size_t k = 0; k < block.occupants.size(); k++)
+			{
+				Resource& resource = resources[block.occupants[k]];
+				if (vmaBindImageMemory(allocator, allocation, static_cast<VkImage>(resource.image)) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to bind render graph memory!");
+				}
+
+				// views only see the depth of combined depth/stencil formats
+				const vk::ImageAspectFlags viewAspect = resource.aspect & vk::ImageAspectFlagBits::eColor ? resource.aspect : vk::ImageAspectFlags(vk::ImageAspectFlagBits::eDepth);
+				resource.ownedView = VulkanUtils::createImageView(device, resource.image, resource.format, viewAspect);
+				resource.view = resource.ownedView.get();
+
+				predecessors[block.occupants[k]] = block.occupants[(k + block.occupants.size() - 1) % block.occupants.size()];
+			}
+		}
+
+		return predecessors;
+	}
+
+	void RenderGraph::bindImage(Image image, vk::Image handle, vk::ImageView view)
+	{
+		Resource& resource = resources[image];
+		if (!resource.imported)
+		{
+			throw std::logic_error("only imported images can be bound!");
+		}
+
+		resource.image = handle;
+		resource.view = view;
+	}
+
+	void RenderGraph::record(vk::CommandBuffer commandBuffer, uint32_t index)
+	{
+		if (!compiled)
+		{
+			throw std::logic_error("render graph isn't compiled!");
+		}
+
+		for (const Pass& pass : passes)
+		{
+			if (pass.culled) continue;
+
+			recordBarriers(commandBuffer, pass.barriers);
+
+			const bool rendering = std::any_of(pass.uses.begin(), pass.uses.end(), [](const Use& use)
+			{
+				return use.access == Access::ColorWrite || use.access == Access::DepthWrite;
+			});
+
+			if (rendering)
+			{
+				beginPass(commandBuffer, pass);
+			}
+
+			pass.execute(commandBuffer, index);
+
+			if (rendering)
+			{
+				endRendering(commandBuffer);
+			}
+		}
+
+		recordBarriers(commandBuffer, finalBarriers);
+	}
+
+	void RenderGraph::recordBarriers(vk::CommandBuffer commandBuffer, const BarrierBatch& batch) const
+	{
+		if (batch.barriers.empty())
+		{
+			return;
+		}
+
+		std::vector<vk::ImageMemoryBarrier> imageBarriers;
+		imageBarriers.reserve(batch.barriers.size());
+		for (const Barrier& barrier : batch.barriers)
+		{
+			const Resource& resource = resources[barrier.image];
+			if (!resource.image)
+			{
+				throw std::runtime_error("render graph image '" + resource.name + "' isn't bound!");
+			}
+
+			imageBarriers.push_back(vk::ImageMemoryBarrier(
+				barrier.srcAccess,
+				barrier.dstAccess,
+				barrier.oldLayout,
+				barrier.newLayout,
+				VK_QUEUE_FAMILY_IGNORED,
+				VK_QUEUE_FAMILY_IGNORED,
+				resource.image,
+				vk::ImageSubresourceRange(resource.aspect, 0, 1, 0, 1)
+			));
+		}
+
+		commandBuffer.pipelineBarrier(batch.srcStages, batch.dstStages, vk::DependencyFlags(), nullptr, nullptr, imageBarriers);
+	}
+
+	void RenderGraph::beginPass(vk::CommandBuffer commandBuffer, const Pass& pass) const
+	{
+		std::vector<vk::RenderingAttachmentInfoKHR> colorAttachments;
+		std::optional<vk::RenderingAttachmentInfoKHR> depthAttachment;
+		vk::Extent2D extent;
+
+		for (const Use& use : pass.uses)
+		{
+			if (use.access != Access::ColorWrite && use.access != Access::DepthWrite) continue;
+
+			const Resource& resource = resources[use.image];
+
+			vk::RenderingAttachmentInfoKHR attachment;
+			attachment.imageView = resource.view;
+			attachment.imageLayout = describe(use).layout;
+			attachment.loadOp = use.loadOp;
+			attachment.storeOp = use.storeOp;
+			if (use.clear)
+			{
+				attachment.clearValue = *use.clear;
+			}
+			if (use.resolve)
+			{
+				attachment.resolveMode = vk::ResolveModeFlagBits::eAverage;
+				attachment.resolveImageView = resources[*use.resolve].view;
+				attachment.resolveImageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+			}
+
+			if (use.access == Access::ColorWrite)
+			{
+				colorAttachments.push_back(attachment);
+			}
+			else
+			{
+				depthAttachment = attachment;
+			}
+
+			extent = resource.extent;
+		}
+
+		vk::RenderingInfoKHR renderingInfo;
+		renderingInfo.renderArea = vk::Rect2D(vk::Offset2D(0, 0), extent);
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+		renderingInfo.pColorAttachments = colorAttachments.data();
+		renderingInfo.pDepthAttachment = depthAttachment ? &*depthAttachment : nullptr;
+
+		beginRendering(commandBuffer, reinterpret_cast<const VkRenderingInfoKHR*>(&renderingInfo));
+	}
+
+	void RenderGraph::reset(Timeline& timeline)
+	{
+		// views before images before memory; the deletion queue releases in order
+		for (Resource& resource : resources)
+		{
+			if (resource.ownedView)
+			{
+				timeline.retire(std::move(resource.ownedView));
+			}
+		}
+		for (Resource& resource : resources)
+		{
+			if (resource.ownedImage)
+			{
+				timeline.retire(std::move(resource.ownedImage));
+			}
+		}
+		for (VmaAllocation allocation : allocations)
+		{
+			timeline.defer([allocator = allocator, allocation]()
+			{
+				vmaFreeMemory(allocator, allocation);
+			});
+		}
+
+		resources.clear();
+		passes.clear();
+		finalBarriers = BarrierBatch();
+		allocations.clear();
+		compiled = false;
+	}
+}
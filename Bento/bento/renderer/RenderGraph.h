@@ -0,0 +1,199 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.h>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace bento
+{
+	class Timeline;
+
+	// a frame described as passes that declare the images they read and write; compiled once, then recorded into any number of command buffers
+	// - passes that contribute nothing to an imported image, and have no side effects, are culled
+	// - barriers are derived from the declared accesses: at most one pipeline barrier per pass, and only where a layout changes or there is a hazard
+	// - transient images whose lifetimes don't overlap share one vma allocation
+	// - transient attachments that are never loaded or stored get lazily allocated memory where there is some, so tilers never back them
+	// - passes with attachments are recorded with dynamic rendering, so there are no render pass or framebuffer objects
+	// - every recording is assumed to follow the previous one on the same queue, so the first use of an image in a frame waits for its last use in the one before
+	class RenderGraph
+	{
+	public:
+		using Image = uint32_t;
+		// called while recording; index is whatever was passed to record, e.g. the swap chain image the command buffer is for
+		using Execute = std::function<void(vk::CommandBuffer commandBuffer, uint32_t index)>;
+
+		class PassBuilder
+		{
+		public:
+			// cleared when a clear value is given, otherwise drawn on top of what is there
+			// a multisampled image can be resolved into a single sampled one at the end of the pass, which overwrites all of it
+			void writeColor(Image image, std::optional<vk::ClearColorValue> clear = std::nullopt, std::optional<Image> resolve = std::nullopt);
+			void writeDepth(Image image, std::optional<vk::ClearDepthStencilValue> clear = std::nullopt);
+			void sample(Image image);
+			void copyFrom(Image image);
+			void copyTo(Image image);
+			// the pass does something the graph can't see (e.g. fills a buffer the host reads), so it is never culled
+			void sideEffect();
+
+		private:
+			friend class RenderGraph;
+			PassBuilder(RenderGraph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+			RenderGraph& graph;
+			uint32_t pass;
+		};
+
+		RenderGraph() = default;
+		~RenderGraph() = default;
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		void initialize(vk::Device device, VmaAllocator allocator, PFN_vkCmdBeginRenderingKHR beginRendering, PFN_vkCmdEndRenderingKHR endRendering);
+
+		// an image owned elsewhere (a swap chain image); its contents are discarded at the start of each frame and it is left in finalLayout,
+		// ready for finalStages/finalAccess. the actual handles are bound before each record
+		Image importImage(const std::string& name, vk::Format format, vk::Extent2D extent,
+		                  vk::ImageLayout finalLayout, vk::PipelineStageFlags finalStages, vk::AccessFlags finalAccess);
+		// an image that only lives within the frame; created by compile
+		Image createImage(const std::string& name, vk::Format format, vk::Extent2D extent, vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1);
+
+		// passes run in the order they are added
+		void addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, Execute execute);
+
+		// culls, places barriers and allocates the transient images; the graph can't be changed afterwards
+		void compile();
+
+		void bindImage(Image image, vk::Image handle, vk::ImageView view);
+		void record(vk::CommandBuffer commandBuffer, uint32_t index);
+
+		// hands everything compile created to the timeline's deletion queue and forgets the passes, ready to be described again
+		void reset(Timeline& timeline);
+
+		bool isCompiled() const { return compiled; }
+
+	private:
+		enum class Access
+		{
+			ColorWrite,
+			ColorResolve,
+			DepthWrite,
+			Sampled,
+			TransferSource,
+			TransferDestination
+		};
+
+		struct Use
+		{
+			Image image;
+			Access access;
+			std::optional<vk::ClearValue> clear;
+			// color writes only; the image the samples are averaged into
+			std::optional<Image> resolve;
+
+			// filled in by compile for attachments
+			vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eDontCare;
+			vk::AttachmentStoreOp storeOp = vk::AttachmentStoreOp::eStore;
+		};
+
+		// how one use touches its image
+		struct AccessInfo
+		{
+			vk::PipelineStageFlags stages;
+			vk::AccessFlags access;
+			vk::ImageLayout layout;
+			vk::ImageUsageFlags usage;
+			bool write;
+		};
+
+		// everything one use needs to wait for before it may touch the image
+		struct Barrier
+		{
+			Image image;
+			vk::ImageLayout oldLayout;
+			vk::ImageLayout newLayout;
+			vk::AccessFlags srcAccess;
+			vk::AccessFlags dstAccess;
+		};
+
+		// the barriers recorded in front of a pass, folded into one call
+		struct BarrierBatch
+		{
+			vk::PipelineStageFlags srcStages;
+			vk::PipelineStageFlags dstStages;
+			std::vector<Barrier> barriers;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			std::vector<Use> uses;
+			Execute execute;
+			bool sideEffect = false;
+			bool culled = false;
+
+			BarrierBatch barriers;
+		};
+
+		// what has happened to an image since it was last made visible
+		struct State
+		{
+			vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+			vk::PipelineStageFlags writeStages;
+			vk::AccessFlags writeAccess;
+			vk::PipelineStageFlags readStages;
+		};
+
+		struct Resource
+		{
+			std::string name;
+			vk::Format format;
+			vk::Extent2D extent;
+			vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+			vk::ImageAspectFlags aspect;
+			vk::ImageUsageFlags usage;
+
+			bool imported = false;
+			vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+			vk::PipelineStageFlags finalStages;
+			vk::AccessFlags finalAccess;
+
+			vk::Image image;
+			vk::ImageView view;
+			vk::UniqueImage ownedImage;
+			vk::UniqueImageView ownedView;
+
+			// in alive passes; UINT32_MAX if no alive pass uses it
+			uint32_t firstUse = UINT32_MAX;
+			uint32_t lastUse = 0;
+			// whatever the gpu did to the image (or to the memory it shares) last, which the first use of a frame waits on
+			State previous;
+		};
+
+		vk::Device device;
+		VmaAllocator allocator = nullptr;
+		PFN_vkCmdBeginRenderingKHR beginRendering = nullptr;
+		PFN_vkCmdEndRenderingKHR endRendering = nullptr;
+
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+		// leaves the imported images in their final layouts
+		BarrierBatch finalBarriers;
+		std::vector<VmaAllocation> allocations;
+		bool compiled = false;
+
+		static AccessInfo describe(const Use& use);
+
+		void use(uint32_t pass, Image image, Access access, std::optional<vk::ClearValue> clear);
+		void cull();
+		std::vector<State> placeBarriers();
+		// returns, for each image, the one whose last use its first use has to wait for (itself, unless its memory is shared)
+		std::vector<Image> allocateTransients();
+
+		void recordBarriers(vk::CommandBuffer commandBuffer, const BarrierBatch& batch) const;
+		void beginPass(vk::CommandBuffer commandBuffer, const Pass& pass) const;
+	};
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "FrameStats.h"
+#include "Light.h"
+#include "bento/core/profiler.h"
+
+namespace bento
+{
+	// a mesh entity, drawn in the main pass and into the shadow maps
+	struct MeshDraw
+	{
+		// content hash of its mesh, as in MeshComponent
+		uint64_t mesh;
+		// index of its world matrix in the packet's instances
+		uint32_t instance;
+		// static draws are cast into cached shadow maps that are only re-rendered when they go stale
+		bool isStatic;
+	};
+
+	// everything the render thread needs to draw one frame, filled in on the main thread and read-only once submitted
+	struct RenderPacket
+	{
+		// simulation time in seconds
+		float time = 0.0f;
+		// when the input this frame reacts to was sampled (profiler::now()); 0 if unknown
+		int64_t inputTime = 0;
+
+		// the window's framebuffer size; zero while minimized
+		uint32_t framebufferWidth = 0;
+		uint32_t framebufferHeight = 0;
+
+		// ui input; glfw may only be queried on the main thread
+		float mouseX = 0.0f;
+		float mouseY = 0.0f;
+		bool mouseButtons[2] = {};
+
+		profiler::FrameTiming timing;
+
+		// world matrices; sized once to the renderer's instance capacity and reused
+		std::vector<glm::mat4> instances;
+		uint32_t instanceCount = 0;
+
+		// the frame's mesh entities; sized once to the renderer's instance capacity and reused
+		std::vector<MeshDraw> draws;
+		uint32_t drawCount = 0;
+		// changes whenever the static draws do; the cached static shadows are kept as long as it doesn't
+		uint64_t staticVersion = 0;
+
+		// the frame's lights; sized once to the renderer's light capacity and reused
+		std::vector<Light> lights;
+		uint32_t lightCount = 0;
+
+		// the sun, if there is one; lights everything and casts the cascaded shadows. only colorIntensity and the direction are used
+		std::optional<Light> directionalLight;
+
+		// written by the render thread when it is done with the packet
+		FrameStats stats;
+	};
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace bento
+{
+	// hands fixed slots from one producer thread to one consumer thread without locks
+	// - with three slots the producer can fill one while another is queued and the third is being consumed
+	// - slots are reused in order and never destroyed, so anything they own is only allocated the first time round
+	// - both sides yield while waiting; a closed queue stops the producer and lets the consumer drain what is left
+	template<typename T, size_t SLOT_COUNT = 3>
+	class RenderQueue
+	{
+	public:
+		// producer: the next free slot, or nullptr once the queue has been closed
+		T* beginWrite()
+		{
+			const uint64_t position = written.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				if (closed.load(std::memory_order_acquire)) return nullptr;
+				if (position - read.load(std::memory_order_acquire) < SLOT_COUNT) return &slots[position % SLOT_COUNT];
+				std::this_thread::yield();
+			}
+		}
+
+		void endWrite()
+		{
+			written.store(written.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// consumer: the oldest written slot, or nullptr once the queue has been closed and drained
+		T* beginRead()
+		{
+			const uint64_t position = read.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				const bool closing = closed.load(std::memory_order_acquire);
+				if (written.load(std::memory_order_acquire) != position) return &slots[position % SLOT_COUNT];
+				if (closing) return nullptr;
+				std::this_thread::yield();
+			}
+		}
+
+		void endRead()
+		{
+			read.store(read.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// everything written has been read and released
+		bool empty() const
+		{
+			return written.load(std::memory_order_acquire) == read.load(std::memory_order_acquire);
+		}
+
+		void close() { closed.store(true, std::memory_order_release); }
+		bool isClosed() const { return closed.load(std::memory_order_acquire); }
+		// only while neither side is using the queue
+		void open() { closed.store(false, std::memory_order_release); }
+
+	private:
+		std::array<T, SLOT_COUNT> slots;
+
+		// each side only writes its own counter; keep them on separate cache lines
+		alignas(64) std::atomic<uint64_t> written = 0;
+		alignas(64) std::atomic<uint64_t> read = 0;
+		std::atomic<bool> closed = false;
+	};
+}
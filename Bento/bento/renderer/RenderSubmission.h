@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+#include <glm/mat4x4.hpp>
+
+#include "Light.h"
+#include "RenderPacket.h"
+
+namespace bento
+{
+	// where a scene writes what it wants drawn this frame; the renderer fills its current packet with it, and anything
+	// without a gpu (tools, tests) can just collect the data
+	// each begin hands out room for capacity items, and the matching end says how many were written
+	class RenderSubmission
+	{
+	public:
+		virtual ~RenderSubmission() = default;
+
+		// world matrices, one per instance
+		virtual glm::mat4* beginInstances(uint32_t& capacity) = 0;
+		virtual void endInstances(uint32_t count) = 0;
+
+		// the meshes to draw, each placed by one of the instances; every draw casts a shadow too
+		// staticVersion has to change whenever the static draws do
+		virtual MeshDraw* beginDraws(uint32_t& capacity) = 0;
+		virtual void endDraws(uint32_t count, uint64_t staticVersion) = 0;
+
+		virtual Light* beginLights(uint32_t& capacity) = 0;
+		virtual void endLights(uint32_t count) = 0;
+
+		// the last call in a frame wins
+		virtual void setDirectionalLight(const Light& light) = 0;
+	};
+}
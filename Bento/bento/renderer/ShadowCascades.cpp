@@ -0,0 +1,69 @@
+#include "bpch.h"
+#include "ShadowCascades.h"
+
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace bento::ShadowCascades
+{
+	namespace
+	{
+		// the far end of slice i
+		float splitDepth(float nearPlane, float farPlane, float lambda, uint32_t i, uint32_t count)
+		{
+			const float p = static_cast<float>(i + 1) / static_cast<float>(count);
+			const float logarithmic = nearPlane * std::pow(farPlane / nearPlane, p);
+			const float uniform = nearPlane + (farPlane - nearPlane) * p;
+			return lambda * logarithmic + (1.0f - lambda) * uniform;
+		}
+	}
+
+	void split(float nearPlane, float farPlane, float lambda, uint32_t count, float* splits)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			splits[i] = splitDepth(nearPlane, farPlane, lambda, i, count);
+		}
+	}
+
+	void compute(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane, float lambda,
+	             const glm::vec3& lightDirection, uint32_t resolution, float casterReach, Cascade* cascades, uint32_t count)
+	{
+		const glm::mat4 inverseView = glm::inverse(view);
+
+		// squared slope of the frustum's corner edges; a corner at depth d is d * sqrt(k2) from the view axis
+		const float tanY = std::tan(fovY * 0.5f);
+		const float tanX = tanY * aspect;
+		const float k2 = tanX * tanX + tanY * tanY;
+
+		// a pure rotation, so snapping in light space doesn't depend on where the camera is
+		const glm::vec3 direction = glm::normalize(lightDirection);
+		const glm::vec3 up = std::abs(direction.z) > 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+		const glm::mat4 lightView = glm::lookAtRH(glm::vec3(0.0f), direction, up);
+
+		float sliceNear = nearPlane;
+		for (uint32_t c = 0; c < count; c++)
+		{
+			const float sliceFar = splitDepth(nearPlane, farPlane, lambda, c, count);
+			cascades[c].splitDepth = sliceFar;
+
+			// the smallest sphere around the slice is centered on the view axis where the near and far corners are equally far away,
+			// unless that is past the far plane
+			const float centerDepth = std::min(0.5f * (sliceNear + sliceFar) * (1.0f + k2), sliceFar);
+			const float radius = std::sqrt((sliceFar - centerDepth) * (sliceFar - centerDepth) + sliceFar * sliceFar * k2);
+
+			const glm::vec3 worldCenter = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+			glm::vec3 center = glm::vec3(lightView * glm::vec4(worldCenter, 1.0f));
+
+			const float texel = 2.0f * radius / static_cast<float>(resolution);
+			center = glm::floor(center / texel) * texel;
+
+			// light space looks down -z
+			const glm::mat4 projection = glm::orthoRH_ZO(center.x - radius, center.x + radius, center.y - radius, center.y + radius,
+			                                             -center.z - radius - casterReach, -center.z + radius);
+			cascades[c].viewProj = projection * lightView;
+
+			sliceNear = sliceFar;
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+namespace bento::ShadowCascades
+{
+	struct Cascade
+	{
+		// world to shadow map clip space (vulkan depth range)
+		glm::mat4 viewProj;
+		// view space distance at which the cascade ends
+		float splitDepth;
+	};
+
+	// splits [nearPlane, farPlane] with the practical split scheme; lambda blends logarithmic (1) and uniform (0) spacing
+	// writes the far end of each of the count slices
+	void split(float nearPlane, float farPlane, float lambda, uint32_t count, float* splits);
+
+	// fits an orthographic projection along lightDirection around each slice of the camera frustum
+	// - each slice is enclosed in a sphere, so a cascade's size doesn't change as the camera turns
+	// - the center is snapped to whole shadow map texels, so a cascade only ever moves in texel steps and a still camera gives bitwise identical matrices
+	// - the depth range reaches casterReach towards the light past each sphere, for casters outside the view
+	void compute(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane, float lambda,
+	             const glm::vec3& lightDirection, uint32_t resolution, float casterReach, Cascade* cascades, uint32_t count);
+}
@@ -0,0 +1,170 @@
+#include "bpch.h"
+#include "Timeline.h"
+
+#include "bento/core/log.h"
+#include "bento/core/profiler.h"
+
+namespace bento
+{
+	void Timeline::initialize(vk::Device device, vk::Queue queue)
+	{
+		this->device = device;
+		this->queue = queue;
+
+		vk::SemaphoreTypeCreateInfo typeInfo(vk::SemaphoreType::eTimeline, 0);
+		vk::SemaphoreCreateInfo semaphoreInfo;
+		semaphoreInfo.pNext = &typeInfo;
+
+		semaphore = device.createSemaphoreUnique(semaphoreInfo);
+
+		BENTO_LOG_TRACE("Created timeline semaphore");
+	}
+
+	void Timeline::clean()
+	{
+		wait(getSubmittedValue());
+		collect();
+
+		semaphore.reset();
+	}
+
+	uint64_t Timeline::submit(vk::ArrayProxy<const vk::CommandBuffer> commandBuffers,
+	                          vk::ArrayProxy<const vk::Semaphore> waitSemaphores,
+	                          vk::ArrayProxy<const vk::PipelineStageFlags> waitStages,
+	                          vk::ArrayProxy<const vk::Semaphore> signalSemaphores)
+	{
+		if (waitSemaphores.size() != waitStages.size())
+		{
+			throw std::invalid_argument("every wait semaphore needs a wait stage!");
+		}
+		if (waitSemaphores.size() >= MAX_SUBMIT_SEMAPHORES || signalSemaphores.size() >= MAX_SUBMIT_SEMAPHORES)
+		{
+			throw std::invalid_argument("too many semaphores for one submit!");
+		}
+
+		// binary semaphores take a value slot too, which is ignored
+		std::array<vk::Semaphore, MAX_SUBMIT_SEMAPHORES> waits;
+		std::array<vk::PipelineStageFlags, MAX_SUBMIT_SEMAPHORES> stages;
+		std::array<uint64_t, MAX_SUBMIT_SEMAPHORES> waitValues{};
+		uint32_t waitCount = 0;
+
+		for (uint32_t i = 0; i < waitSemaphores.size(); i++)
+		{
+			waits[waitCount] = waitSemaphores.data()[i];
+			stages[waitCount] = waitStages.data()[i];
+			waitCount++;
+		}
+
+		// make uploads visible to this submit without the cpu ever waiting for them
+		if (uploadValue > waitedUploadValue)
+		{
+			waits[waitCount] = semaphore.get();
+			stages[waitCount] = vk::PipelineStageFlagBits::eAllCommands;
+			waitValues[waitCount] = uploadValue;
+			waitCount++;
+
+			waitedUploadValue = uploadValue;
+		}
+
+		std::array<vk::Semaphore, MAX_SUBMIT_SEMAPHORES> signals;
+		std::array<uint64_t, MAX_SUBMIT_SEMAPHORES> signalValues{};
+		uint32_t signalCount = 0;
+
+		for (uint32_t i = 0; i < signalSemaphores.size(); i++)
+		{
+			signals[signalCount++] = signalSemaphores.data()[i];
+		}
+
+		const uint64_t value = submittedValue.load(std::memory_order_relaxed) + 1;
+		signals[signalCount] = semaphore.get();
+		signalValues[signalCount] = value;
+		signalCount++;
+
+		vk::TimelineSemaphoreSubmitInfo timelineInfo(waitCount, waitValues.data(), signalCount, signalValues.data());
+
+		vk::SubmitInfo submitInfo(
+			waitCount, waits.data(), stages.data(),
+			commandBuffers.size(), commandBuffers.data(),
+			signalCount, signals.data()
+		);
+		submitInfo.pNext = &timelineInfo;
+
+		queue.submit(submitInfo, nullptr);
+
+		submittedValue.store(value, std::memory_order_release);
+		return value;
+	}
+
+	uint64_t Timeline::submitUpload(vk::CommandBuffer commandBuffer)
+	{
+		uploadValue = submit(commandBuffer);
+		return uploadValue;
+	}
+
+	uint64_t Timeline::getCompletedValue()
+	{
+		const uint64_t value = device.getSemaphoreCounterValue(semaphore.get());
+		advanceCompleted(value);
+		return value;
+	}
+
+	bool Timeline::isComplete(uint64_t value)
+	{
+		return value <= completedValue.load(std::memory_order_acquire) || value <= getCompletedValue();
+	}
+
+	void Timeline::wait(uint64_t value)
+	{
+		if (value <= completedValue.load(std::memory_order_acquire))
+		{
+			return;
+		}
+
+		BENTO_PROFILE_FUNCTION();
+
+		const vk::Semaphore semaphores[] = { semaphore.get() };
+		vk::SemaphoreWaitInfo waitInfo({}, 1, semaphores, &value);
+		if (device.waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess)
+		{
+			throw std::runtime_error("failed to wait for timeline semaphore!");
+		}
+
+		advanceCompleted(value);
+	}
+
+	void Timeline::advanceCompleted(uint64_t value)
+	{
+		uint64_t completed = completedValue.load(std::memory_order_relaxed);
+		while (completed < value && !completedValue.compare_exchange_weak(completed, value, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void Timeline::retire(ImageData&& image, VmaAllocator allocator)
+	{
+		const VkImage handle = static_cast<VkImage>(image.image.release());
+		const VmaAllocation allocation = image.allocation;
+		image.allocation = nullptr;
+
+		defer([allocator, handle, allocation]()
+		{
+			vmaDestroyImage(allocator, handle, allocation);
+		});
+	}
+
+	void Timeline::collect()
+	{
+		if (retired.empty())
+		{
+			return;
+		}
+
+		const uint64_t completed = getCompletedValue();
+
+		while (!retired.empty() && retired.front().first <= completed)
+		{
+			retired.front().second();
+			retired.pop_front();
+		}
+	}
+}
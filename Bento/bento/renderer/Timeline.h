@@ -0,0 +1,90 @@
+#pragma once
+#include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <vk_mem_alloc.h>
+
+#include "ImageData.h"
+
+namespace bento
+{
+	// orders everything submitted to one queue by a single timeline semaphore (vulkan 1.2)
+	// - every submit signals the next value, so "is this work done" is one integer comparison
+	// - uploads are submitted without waiting; the next regular submit waits on them on the gpu instead of the cpu
+	// - resources that the gpu may still be reading are retired against a value and released once it has been reached,
+	//   so removing things at runtime never needs a device wide idle
+	// - submit, retire and collect from one thread at a time; the values can be read and waited on from any thread
+	class Timeline
+	{
+	public:
+		Timeline() = default;
+		~Timeline() = default;
+
+		Timeline(const Timeline&) = delete;
+		Timeline& operator=(const Timeline&) = delete;
+
+		void initialize(vk::Device device, vk::Queue queue);
+		// waits for all submitted work and releases everything retired
+		void clean();
+
+		// binary semaphores (swap chain acquire/present) can still be waited on and signaled alongside the timeline
+		// returns the value that is reached once the command buffers have finished
+		uint64_t submit(vk::ArrayProxy<const vk::CommandBuffer> commandBuffers,
+		                vk::ArrayProxy<const vk::Semaphore> waitSemaphores = nullptr,
+		                vk::ArrayProxy<const vk::PipelineStageFlags> waitStages = nullptr,
+		                vk::ArrayProxy<const vk::Semaphore> signalSemaphores = nullptr);
+		// transfers that later submits depend on (staging copies, layout transitions)
+		uint64_t submitUpload(vk::CommandBuffer commandBuffer);
+
+		// the value signaled by the most recent submit
+		uint64_t getSubmittedValue() const { return submittedValue.load(std::memory_order_acquire); }
+		uint64_t getCompletedValue();
+		bool isComplete(uint64_t value);
+		// blocks until the gpu reaches value; returns immediately for values already known to be complete
+		void wait(uint64_t value);
+
+		// deletion queue; everything below is released once all work submitted so far has finished
+		// any object that frees itself on destruction: BufferData, vk::Unique* handles (pipelines, descriptor sets, framebuffers...), meshes
+		template<typename Resource>
+		void retire(Resource&& resource)
+		{
+			static_assert(!std::is_lvalue_reference_v<Resource>, "move the resource into the timeline");
+			static_assert(!std::is_same_v<Resource, ImageData>, "images need the allocator they came from");
+			auto owned = std::make_shared<Resource>(std::move(resource));
+			defer([owned]() mutable { owned.reset(); });
+		}
+		// vma images don't free their allocation on their own
+		void retire(ImageData&& image, VmaAllocator allocator);
+		void defer(std::function<void()> release) { retired.emplace_back(submittedValue.load(std::memory_order_relaxed), std::move(release)); }
+
+		// releases whatever the gpu has finished with; cheap when nothing has, call once per frame
+		void collect();
+
+	private:
+		vk::Device device;
+		vk::Queue queue;
+		vk::UniqueSemaphore semaphore;
+
+		// atomic so another thread can wait on the timeline while the submitting thread carries on
+		std::atomic<uint64_t> submittedValue = 0;
+		std::atomic<uint64_t> completedValue = 0;
+
+		// completedValue only ever moves forward, whichever thread saw the gpu get further
+		void advanceCompleted(uint64_t value);
+		// the last upload, and the last upload a submit has already waited on
+		uint64_t uploadValue = 0;
+		uint64_t waitedUploadValue = 0;
+
+		// in submission order, so everything finished is at the front
+		std::deque<std::pair<uint64_t, std::function<void()>>> retired;
+
+		// one submit never waits on or signals more than this many semaphores
+		static constexpr uint32_t MAX_SUBMIT_SEMAPHORES = 4;
+	};
+}
@@ -4,6 +4,8 @@
 
 namespace bento
 {
+	class Timeline;
+
 	struct VulkanContext
 	{
 		vk::Instance instance;
@@ -13,14 +15,11 @@ namespace bento
 		VmaAllocator allocator;
 
 		vk::CommandPool commandPool;
-		vk::DescriptorPool descriptorPool;
-		vk::DescriptorSetLayout descriptorSetLayout;
 		vk::Queue queue;
+		// every submit to queue goes through this
+		Timeline* timeline = nullptr;
 
 		vk::Extent2D swapChainExtent;
 		int swapChainImageCount;
-
-		vk::Sampler sampler;
-		vk::ImageView imageView;
 	};
 }
\ No newline at end of file
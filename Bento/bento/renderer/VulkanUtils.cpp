@@ -2,9 +2,17 @@
 #include "VulkanUtils.h"
 #include "bento/core/log.h"
 
+#include <atomic>
 
 namespace bento::VulkanUtils
 {
+	static std::atomic<uint64_t> allocationCount = 0;
+
+	uint64_t getAllocationCount()
+	{
+		return allocationCount.load();
+	}
+
 	VkDebugUtilsMessengerEXT createDebugUtilsMessenger(vk::UniqueInstance& instance)
 	{
 		VkDebugUtilsMessengerCreateInfoEXT vkCreateInfo;
@@ -70,6 +78,7 @@ namespace bento::VulkanUtils
 
 		// this bad! use VMA!
 		data.memory = device.allocateMemoryUnique(memoryAllocateInfo);
+		allocationCount++;
 
 		// bind memory to the buffer
 		// - offset: if nonzero, must be divisible by memRequirements.alignment
@@ -79,7 +88,8 @@ namespace bento::VulkanUtils
 	}
 
 	ImageData createImage(VmaAllocator allocator, vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t width, uint32_t height,
-		vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties)
+		vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::SampleCountFlagBits samples,
+		uint32_t arrayLayers)
 	{
 		//ImageData data;
 
@@ -124,8 +134,8 @@ namespace bento::VulkanUtils
 			format,
 			vk::Extent3D(width, height, 1),
 			1,
-			1,
-			vk::SampleCountFlagBits::e1,
+			arrayLayers,
+			samples,
 			tiling,
 			usage,
 			vk::SharingMode::eExclusive
@@ -143,51 +153,52 @@ namespace bento::VulkanUtils
 		// the fact that i dont specify anything about the memory like i did above might also be the problem(s)
 
 		VmaAllocationCreateInfo allocInfo = {};
-		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		allocInfo.usage = properties & vk::MemoryPropertyFlagBits::eLazilyAllocated ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY;
 		allocInfo.memoryTypeBits = memoryRequirements.memoryTypeBits;
 		allocInfo.requiredFlags = static_cast<VkMemoryPropertyFlags>(properties);
 
 		if (!allocator)
 		{
-			log::error("allocator null");
+			BENTO_LOG_ERROR("allocator null");
 		}
 		if (!reinterpret_cast<VkImageCreateInfo*>(&imageInfo))
 		{
-			log::error("imageInfo null");
+			BENTO_LOG_ERROR("imageInfo null");
 		}
 		if (!&allocInfo)
 		{
-			log::error("allocInfo null");
+			BENTO_LOG_ERROR("allocInfo null");
 		}
 		if (!reinterpret_cast<VkImageCreateInfo*>(&imageInfo))
 		{
-			log::error("image null");
+			BENTO_LOG_ERROR("image null");
 		}
 		if (!&data.allocation)
 		{
-			log::error("pAllocation null");
+			BENTO_LOG_ERROR("pAllocation null");
 		}
 
 		// might be the problem
 		vmaCreateImage(allocator, reinterpret_cast<VkImageCreateInfo*>(&imageInfo), &allocInfo, reinterpret_cast<VkImage*>(&data.image.get()), &data.allocation, nullptr);
+		allocationCount++;
 
 		return data;
 	}
 
 	vk::UniqueImageView createImageView(vk::Device device, vk::Image image, vk::Format format,
-		vk::ImageAspectFlags aspectFlags)
+		vk::ImageAspectFlags aspectFlags, vk::ImageViewType viewType, uint32_t baseArrayLayer, uint32_t layerCount)
 	{
 		// apply a standard component mapping (for swizzling)
 		const vk::ComponentMapping componentMapping(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG, vk::ComponentSwizzle::eB, vk::ComponentSwizzle::eA);
 		// subresource range describes the image's purpose and which parts to access
-		// our image is a color target without mipmapping or multiple layers (for now)
-		const vk::ImageSubresourceRange subResourceRange(aspectFlags, 0, 1, 0, 1);
+		// no mipmapping (for now); the layers are only there for layered images such as the shadow cascades
+		const vk::ImageSubresourceRange subResourceRange(aspectFlags, 0, 1, baseArrayLayer, layerCount);
 
 		// create a new image view
 		const vk::ImageViewCreateInfo imageViewCreateInfo(
 			vk::ImageViewCreateFlags(),
 			image,
-			vk::ImageViewType::e2D,
+			viewType,
 			format,
 			componentMapping,
 			subResourceRange
@@ -221,7 +232,7 @@ namespace bento::VulkanUtils
 		VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
 		void* pUserData)
 	{
-		log::error("validation layer: {}", pCallbackData->pMessage);
+		BENTO_LOG_ERROR("validation layer: {}", pCallbackData->pMessage);
 
 		return VK_FALSE;
 	}
@@ -266,6 +277,19 @@ namespace bento::VulkanUtils
 		);
 	}
 
+	bool hasLazilyAllocatedMemory(vk::PhysicalDevice physicalDevice)
+	{
+		const vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			if (memoryProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eLazilyAllocated)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	vk::Format findSupportedFormat(vk::PhysicalDevice physicalDevice, const std::vector<vk::Format>& candidates,
 		vk::ImageTiling tiling, vk::FormatFeatureFlags features)
 	{
@@ -291,7 +315,7 @@ namespace bento::VulkanUtils
 		return format == vk::Format::eD32Sfloat || format == vk::Format::eD24UnormS8Uint;
 	}
 
-	void copyBuffer(vk::Device device, vk::CommandPool pool, vk::Queue queue, vk::Buffer srcBuffer,
+	void copyBuffer(vk::Device device, vk::CommandPool pool, Timeline& timeline, vk::Buffer srcBuffer,
 		vk::Buffer dstBuffer, vk::DeviceSize size)
 	{
 		// could be optimized for multiple transfers at once
@@ -304,10 +328,10 @@ namespace bento::VulkanUtils
 		commandBuffer.copyBuffer(srcBuffer, dstBuffer, vk::BufferCopy(0, 0, size));
 
 		// stop recording commands
-		endSingleTimeCommands(commandBuffer, device, pool, queue);
+		endSingleTimeCommands(commandBuffer, device, pool, timeline);
 	}
 
-	void copyBufferToImage(vk::Device device, vk::CommandPool pool, vk::Queue queue, vk::Buffer srcBuffer,
+	void copyBufferToImage(vk::Device device, vk::CommandPool pool, Timeline& timeline, vk::Buffer srcBuffer,
 		vk::Image dstImage, uint32_t width, uint32_t height)
 	{
 		// begin recording commands
@@ -329,7 +353,7 @@ namespace bento::VulkanUtils
 		commandBuffer.copyBufferToImage(srcBuffer, dstImage, vk::ImageLayout::eTransferDstOptimal, 1, &region);
 
 		// stop recording commands
-		endSingleTimeCommands(commandBuffer, device, pool, queue);
+		endSingleTimeCommands(commandBuffer, device, pool, timeline);
 	}
 
 	bool checkLayers(std::vector<const char*> const& layers, std::vector<vk::LayerProperties> const& properties)
@@ -355,31 +379,31 @@ namespace bento::VulkanUtils
 		device.allocateCommandBuffers(&allocateInfo, &commandBuffer);
 
 		// begin recording command buffer
-		// we're only going to use the buffer once and wait with returning from the function or until the copy has finished
-		// we'll inform the driver about our intent with OneTimeSubmit
+		// we're only going to submit the buffer once, so we'll inform the driver about our intent with OneTimeSubmit
 		commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
 
 		return commandBuffer;
 	}
 
-	void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Device device, vk::CommandPool pool,
-		vk::Queue queue)
+	uint64_t endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Device device, vk::CommandPool pool,
+		Timeline& timeline)
 	{
 		// end command recording
 		commandBuffer.end();
 
-		// submit the commands for execution and wait
-		vk::SubmitInfo submitInfo;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffer;
-		queue.submit(1, &submitInfo, nullptr);
-		queue.waitIdle();
+		// submit the commands for execution; nothing waits for them here
+		const uint64_t value = timeline.submitUpload(commandBuffer);
+
+		// free the temporary command buffer once the gpu is done with it
+		timeline.defer([device, pool, commandBuffer]()
+		{
+			device.freeCommandBuffers(pool, 1, &commandBuffer);
+		});
 
-		// free the temporary command buffer
-		device.freeCommandBuffers(pool, 1, &commandBuffer);
+		return value;
 	}
 
-	void transitionImageLayout(vk::Device device, vk::CommandPool pool, vk::Queue queue, vk::Image image,
+	void transitionImageLayout(vk::Device device, vk::CommandPool pool, Timeline& timeline, vk::Image image,
 		vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
 	{
 		// begin recording commands
@@ -443,7 +467,7 @@ namespace bento::VulkanUtils
 		);
 
 		// end command recording
-		endSingleTimeCommands(commandBuffer, device, pool, queue);
+		endSingleTimeCommands(commandBuffer, device, pool, timeline);
 	}
 
 	const char* getDeviceName(vk::PhysicalDevice physicalDevice)
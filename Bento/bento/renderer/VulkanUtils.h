@@ -4,6 +4,7 @@
 #include "SwapChainSupportDetails.h"
 #include "BufferData.h"
 #include "ImageData.h"
+#include "Timeline.h"
 #include <vk_mem_alloc.h>
 
 namespace bento::VulkanUtils
@@ -16,10 +17,13 @@ namespace bento::VulkanUtils
 	                        vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperties);
 	//BufferData createBuffer(VmaAllocator* allocator, vk::Device device, vk::DeviceSize size, vk::PhysicalDevice physicalDevice, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryProperties);
 
+	// lazily allocated properties place the image in memory that tilers only back if it is ever stored; see hasLazilyAllocatedMemory
 	ImageData createImage(VmaAllocator allocator, vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling,
-		vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties);
+		vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1, uint32_t arrayLayers = 1);
 
-	vk::UniqueImageView createImageView(vk::Device device, vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags);
+	// layered images can be viewed as a whole (e2DArray) or one layer at a time
+	vk::UniqueImageView createImageView(vk::Device device, vk::Image image, vk::Format format, vk::ImageAspectFlags aspectFlags,
+		vk::ImageViewType viewType = vk::ImageViewType::e2D, uint32_t baseArrayLayer = 0, uint32_t layerCount = 1);
 
 	VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo,
 	                                      const VkAllocationCallbacks* pAllocator,
@@ -40,26 +44,34 @@ namespace bento::VulkanUtils
 		void* pUserData
 	);
 
+	// number of device memory allocations made through createBuffer/createImage so far
+	uint64_t getAllocationCount();
+
 	// info functions
 	SwapChainSupportDetails querySwapChainSupport(vk::PhysicalDevice device, vk::SurfaceKHR surface);
 
 	uint32_t findMemoryType(vk::PhysicalDeviceMemoryProperties const & memoryProperties, uint32_t typeFilter, vk::MemoryPropertyFlags requirementsMask);
 	vk::Format findDepthFormat(vk::PhysicalDevice physicalDevice);
+	// whether transient attachments can be given memory that is only committed on demand (typically on tile based gpus)
+	bool hasLazilyAllocatedMemory(vk::PhysicalDevice physicalDevice);
 	vk::Format findSupportedFormat(vk::PhysicalDevice physicalDevice, const std::vector<vk::Format>& candidates,
 	                               vk::ImageTiling tiling, vk::FormatFeatureFlags features);
 
 	// misc.
 	bool hasStencilComponent(vk::Format format);
 
-	void copyBuffer(vk::Device device, vk::CommandPool pool, vk::Queue queue, vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
-	void copyBufferToImage(vk::Device device, vk::CommandPool pool, vk::Queue queue, vk::Buffer srcBuffer,
+	// one-off transfers are submitted as timeline uploads and return without waiting; later submits on the timeline wait for them on the gpu
+	// retire any staging buffer to the timeline afterwards rather than destroying it
+	void copyBuffer(vk::Device device, vk::CommandPool pool, Timeline& timeline, vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
+	void copyBufferToImage(vk::Device device, vk::CommandPool pool, Timeline& timeline, vk::Buffer srcBuffer,
 	                       vk::Image dstImage, uint32_t width, uint32_t height);
 	bool checkLayers(std::vector<char const *> const & layers, std::vector<vk::LayerProperties> const & properties);
 
 	vk::CommandBuffer beginSingleTimeCommands(vk::Device device, vk::CommandPool pool);
-	void endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Device device, vk::CommandPool pool, vk::Queue queue);
+	// returns the timeline value the commands will have finished at
+	uint64_t endSingleTimeCommands(vk::CommandBuffer commandBuffer, vk::Device device, vk::CommandPool pool, Timeline& timeline);
 
-	void transitionImageLayout(vk::Device device, vk::CommandPool pool, vk::Queue queue, vk::Image image,
+	void transitionImageLayout(vk::Device device, vk::CommandPool pool, Timeline& timeline, vk::Image image,
 	                           vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
 
 	const char* getDeviceName(vk::PhysicalDevice physicalDevice);
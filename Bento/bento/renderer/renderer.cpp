@@ -4,20 +4,47 @@
 #include "VulkanContext.h"
 #include "Shader.h"
 #include "GlobalUBO.h"
-#include "ObjectUBO.h"
+#include "DrawConstants.h"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <stb_image.h>
 #include "bento/core/log.h"
+#include "bento/core/profiler.h"
 
 #include "imgui.h"
 
 namespace bento
 {
+	static double millisecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// without a render pass nothing transitions the attachments, so the command buffers do it themselves
+	static void attachmentBarrier(vk::CommandBuffer commandBuffer, vk::Image image, vk::ImageAspectFlags aspect,
+	                              vk::ImageLayout oldLayout, vk::ImageLayout newLayout,
+	                              vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess,
+	                              vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess,
+	                              uint32_t layerCount = 1)
+	{
+		vk::ImageMemoryBarrier barrier(
+			srcAccess,
+			dstAccess,
+			oldLayout,
+			newLayout,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED,
+			image,
+			vk::ImageSubresourceRange(aspect, 0, 1, 0, layerCount)
+		);
+		commandBuffer.pipelineBarrier(srcStage, dstStage, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
 	Renderer::Renderer()
 	{
 		IMGUI_CHECKVERSION();
@@ -34,6 +61,10 @@ namespace bento
 	{
 		this->window = window;
 
+		int width = 0, height = 0;
+		glfwGetFramebufferSize(window->getHandle(), &width, &height);
+		framebufferExtent = vk::Extent2D(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+
 		//context.queue = graphicsQueue;
 
 		initalizeVulkan();
@@ -58,19 +89,194 @@ namespace bento
 			textureImageView.get()
 		};*/
 
-		// move out
-		context.sampler = textureSampler.get();
-		context.imageView = textureImageView.get();
-
 		// this cant go here :(
 		// also the rebuild frame thing being two seperate things will make lots of problems; fix it
 		//..
 	}
 
-	void Renderer::drawFrame()
+	void Renderer::initializeHeadless(uint32_t width, uint32_t height)
+	{
+		headless = true;
+		headlessExtent = vk::Extent2D(width, height);
+
+		initalizeVulkan();
+	}
+
+	void Renderer::startRenderThread()
+	{
+		packets.open();
+		renderThread = std::thread(&Renderer::renderLoop, this);
+
+		BENTO_LOG_TRACE("Started render thread");
+	}
+
+	void Renderer::stopRenderThread()
+	{
+		if (!renderThread.joinable())
+		{
+			return;
+		}
+
+		packets.close();
+		renderThread.join();
+
+		BENTO_LOG_TRACE("Stopped render thread");
+
+		if (renderError)
+		{
+			std::rethrow_exception(std::exchange(renderError, nullptr));
+		}
+	}
+
+	void Renderer::waitIdle()
+	{
+		// a failed render thread stops consuming; its error surfaces from the next beginFrame
+		while (!packets.empty() && !packets.isClosed())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void Renderer::waitForPreviousFrame()
+	{
+		BENTO_PROFILE_FUNCTION();
+
+		waitIdle();
+
+		// waiting on the timeline is safe alongside the render thread; only submitting has to stay on one thread
+		// the latest frame is left running, so the gpu has work queued while the next one is simulated and recorded
+		if (!packets.isClosed())
+		{
+			timeline.wait(previousFrameValue.load(std::memory_order_acquire));
+		}
+	}
+
+	void Renderer::setPresentMode(PresentMode mode)
+	{
+		if (presentMode.exchange(mode) != mode)
+		{
+			// picked up after the next present, like a resize
+			framebufferResized = true;
+		}
+	}
+
+	RenderPacket& Renderer::beginFrame(float time, int64_t inputTime)
+	{
+		BENTO_PROFILE_FUNCTION();
+
+		RenderPacket* packet = packets.beginWrite();
+		if (!packet)
+		{
+			// the render thread closes the queue when it fails
+			if (renderError)
+			{
+				std::rethrow_exception(std::exchange(renderError, nullptr));
+			}
+			throw std::runtime_error("render thread is not running!");
+		}
+
+		// the render thread left its numbers for the last frame it drew from this slot
+		completedStats = packet->stats;
+
+		packet->time = time;
+		packet->inputTime = inputTime;
+		packet->timing = profiler::lastFrame();
+		packet->instanceCount = 0;
+		packet->drawCount = 0;
+		packet->lightCount = 0;
+		packet->directionalLight.reset();
+
+		// only allocates the first time each slot is used
+		if (packet->instances.size() < MAX_INSTANCES)
+		{
+			packet->instances.resize(MAX_INSTANCES);
+		}
+		if (packet->draws.size() < MAX_INSTANCES)
+		{
+			packet->draws.resize(MAX_INSTANCES);
+		}
+		if (packet->lights.size() < MAX_LIGHTS)
+		{
+			packet->lights.resize(MAX_LIGHTS);
+		}
+
+		if (!headless)
+		{
+			int width = 0, height = 0;
+			glfwGetFramebufferSize(window->getHandle(), &width, &height);
+			packet->framebufferWidth = static_cast<uint32_t>(width);
+			packet->framebufferHeight = static_cast<uint32_t>(height);
+
+			double mouseX, mouseY;
+			glfwGetCursorPos(window->getHandle(), &mouseX, &mouseY);
+			packet->mouseX = static_cast<float>(mouseX);
+			packet->mouseY = static_cast<float>(mouseY);
+			packet->mouseButtons[0] = glfwGetMouseButton(window->getHandle(), GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+			packet->mouseButtons[1] = glfwGetMouseButton(window->getHandle(), GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+		}
+
+		packing = packet;
+		return *packet;
+	}
+
+	void Renderer::submitFrame()
+	{
+		packing = nullptr;
+		packets.endWrite();
+	}
+
+	void Renderer::renderLoop()
+	{
+		profiler::setThreadName("render");
+
+		try
+		{
+			while (RenderPacket* packet = packets.beginRead())
+			{
+				drawFrame(*packet);
+				packet->stats = frameStats;
+				packets.endRead();
+			}
+		}
+		catch (...)
+		{
+			// handed to the main thread by the next beginFrame (or stopRenderThread)
+			renderError = std::current_exception();
+			packets.close();
+		}
+	}
+
+	void Renderer::drawFrame(const RenderPacket& packet)
 	{
+		BENTO_PROFILE_FUNCTION();
+
+		if (headless)
+		{
+			drawFrameHeadless(packet);
+			return;
+		}
+
+		// nothing to present to while minimized; the swap chain is rebuilt once there is
+		if (packet.framebufferWidth == 0 || packet.framebufferHeight == 0)
+		{
+			framebufferResized = true;
+			return;
+		}
+		framebufferExtent = vk::Extent2D(packet.framebufferWidth, packet.framebufferHeight);
+
+		const auto frameStart = std::chrono::high_resolution_clock::now();
+		const uint64_t heapAllocationsAtStart = memory::threadHeapAllocations();
+		frameArena.reset();
+
 		// wait for the frame to be finished
-		device->waitForFences(inFlightFences[currentFrame].get(), true, UINT64_MAX);
+		{
+			BENTO_PROFILE_SCOPE("wait for frame");
+			timeline.wait(frameValues[currentFrame]);
+		}
+		frameStats.waitTime = millisecondsSince(frameStart);
+		readGpuTime(currentFrame);
+		uploadInstances(packet);
+		timeline.collect();
 
 		// get the index of the next available swap chain image
 		uint32_t imageIndex;
@@ -88,38 +294,39 @@ namespace bento
 			throw std::runtime_error("failed to acquire swap chain image!");
 		}
 
-		// Check if a previous frame is using this image (i.e. there is its fence to wait on)
-		if (imagesInFlight[imageIndex] != nullptr)
-		{
-			device->waitForFences(imagesInFlight[imageIndex], true, UINT64_MAX);
-		}
-		// Mark the image as now being in use by this frame
-		imagesInFlight[imageIndex] = inFlightFences[currentFrame].get();
+		// a previous frame may still be using this image's uniform buffers and command buffer
+		timeline.wait(imageValues[imageIndex]);
+
+		recordCommandBuffer(imageIndex, packet);
 
-		updateUniformBuffer(imageIndex);
+		// fits the cascades the uniform buffer passes on
+		const bool shadows = recordShadowCommandBuffer(packet);
 
-		for (size_t j = 0; j < meshFactory.count(); j++)
 		{
-			meshFactory.getMesh(j)->updateUniformBuffer(&context, imageIndex);
+			BENTO_PROFILE_SCOPE("update uniform buffers");
+			uploadLights(imageIndex, packet);
+			updateUniformBuffer(imageIndex, packet);
 		}
 
+		recordImGuiCommandBuffer(imageIndex, packet);
+
 		// gather requirements for submit info
 		std::array<vk::Semaphore, 1> waitSemaphores = { imageAvailableSemaphores[currentFrame].get() };
 		std::array<vk::PipelineStageFlags, 1> waitStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
 		std::array<vk::Semaphore, 1> signalSemaphores = { renderFinishedSemaphores[currentFrame].get() };
 
-		vk::SubmitInfo submitInfo(
-			waitSemaphores,
-			waitStages,
-			commandBuffers[imageIndex].get(),
-			signalSemaphores
-		);
-
-		std::array<vk::SubmitInfo, 1> submits = { submitInfo };
-
-		device->resetFences(inFlightFences[currentFrame].get());
+		// the shadow maps if they changed, then the scene, then the ui on top of it
+		std::array<vk::CommandBuffer, 3> submitCommandBuffers = {
+			shadowCommandBuffers[currentFrame].get(), commandBuffers[imageIndex].get(), imGuiCommandBuffers[currentFrame].get()
+		};
+		const uint32_t firstCommandBuffer = shadows ? 0 : 1;
+		const vk::ArrayProxy<const vk::CommandBuffer> frameCommandBuffers(static_cast<uint32_t>(submitCommandBuffers.size()) - firstCommandBuffer, submitCommandBuffers.data() + firstCommandBuffer);
 
-		graphicsQueue.submit(submits, inFlightFences[currentFrame].get());
+		// both the frame slot and the image are free again once the gpu passes this value
+		const uint64_t value = timeline.submit(frameCommandBuffers, waitSemaphores, waitStages, signalSemaphores);
+		frameValues[currentFrame] = value;
+		imageValues[imageIndex] = value;
+		recordSubmission(imageIndex);
 
 		// the last step of drawing a frame is submitting the result back to the swapchain to have it eventually show up on the screen
 		// presentation is configured through a PresentInfoKHR
@@ -139,6 +346,12 @@ namespace bento
 		else if (presentResult != VK_SUCCESS) {
 			throw std::runtime_error("failed to present swap chain image!");
 		}
+
+		// the frame has been queued for display; scanout itself can't be observed without extensions
+		if (presentResult != VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			frameStats.inputLatency = packet.inputTime > 0 ? static_cast<double>(profiler::now() - packet.inputTime) / 1000000.0 : 0.0;
+		}
 		/*if (presentResult == vk::Result::eErrorOutOfDateKHR || presentResult == vk::Result::eSuboptimalKHR || framebufferResized)
 		{
 			framebufferResized = false;
@@ -149,15 +362,174 @@ namespace bento
 			throw std::runtime_error("failed to present swap chain image!");
 		}*/
 
-		presentQueue.waitIdle();
+		frameStats.cpuTime = millisecondsSince(frameStart);
+		frameStats.heapAllocations = static_cast<uint32_t>(memory::threadHeapAllocations() - heapAllocationsAtStart);
+		frameStats.arenaBytes = static_cast<uint32_t>(frameArena.getUsed());
+		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	}
+
+	void Renderer::drawFrameHeadless(const RenderPacket& packet)
+	{
+		const auto frameStart = std::chrono::high_resolution_clock::now();
+		const uint64_t heapAllocationsAtStart = memory::threadHeapAllocations();
+		frameArena.reset();
+
+		// there is nothing to acquire or present; each frame in flight renders into its own offscreen image
+		{
+			BENTO_PROFILE_SCOPE("wait for frame");
+			timeline.wait(frameValues[currentFrame]);
+		}
+		frameStats.waitTime = millisecondsSince(frameStart);
+		readGpuTime(currentFrame);
+		uploadInstances(packet);
+		timeline.collect();
+
+		// the previous frame in this slot is finished, so hand its pixels out before they get overwritten
+		deliverReadback(currentFrame);
+
+		const uint32_t imageIndex = static_cast<uint32_t>(currentFrame);
+		recordCommandBuffer(imageIndex, packet);
+
+		const bool shadows = recordShadowCommandBuffer(packet);
+
+		{
+			BENTO_PROFILE_SCOPE("update uniform buffers");
+			uploadLights(imageIndex, packet);
+			updateUniformBuffer(imageIndex, packet);
+		}
+
+		// the copy into the readback buffer is recorded in the same command buffer, so a single submit is enough (after the shadow maps, if they changed)
+		if (shadows)
+		{
+			const std::array<vk::CommandBuffer, 2> submitCommandBuffers = { shadowCommandBuffers[currentFrame].get(), commandBuffers[imageIndex].get() };
+			frameValues[currentFrame] = timeline.submit(submitCommandBuffers);
+		}
+		else
+		{
+			frameValues[currentFrame] = timeline.submit(commandBuffers[imageIndex].get());
+		}
+		recordSubmission(imageIndex);
+
+		readbackFrames[currentFrame] = frameNumber++;
 
+		frameStats.cpuTime = millisecondsSince(frameStart);
+		frameStats.heapAllocations = static_cast<uint32_t>(memory::threadHeapAllocations() - heapAllocationsAtStart);
+		frameStats.arenaBytes = static_cast<uint32_t>(frameArena.getUsed());
 		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 	}
 
+	void Renderer::recordSubmission(uint32_t imageIndex)
+	{
+		// the counts were taken when the command buffer was recorded
+		const FrameStats& recorded = recordedStats[imageIndex];
+		frameStats.drawCalls = recorded.drawCalls + shadowStats.drawCalls;
+		frameStats.pipelineBinds = recorded.pipelineBinds + shadowStats.pipelineBinds;
+		frameStats.descriptorSetBinds = recorded.descriptorSetBinds + shadowStats.descriptorSetBinds;
+		frameStats.vertexBufferBinds = recorded.vertexBufferBinds + shadowStats.vertexBufferBinds;
+		frameStats.pushConstantUpdates = recorded.pushConstantUpdates + shadowStats.pushConstantUpdates;
+
+		// uploads signal timeline values too, so the frames' own values are kept for waitForPreviousFrame
+		previousFrameValue.store(std::exchange(latestFrameValue, frameValues[currentFrame]), std::memory_order_release);
+
+		if (timestampsSupported)
+		{
+			submittedImages[currentFrame] = imageIndex;
+			submittedAt[currentFrame] = profiler::now();
+		}
+	}
+
+	void Renderer::deliverReadback(size_t frame)
+	{
+		BENTO_PROFILE_FUNCTION();
+
+		if (!readbackFrames[frame])
+		{
+			return;
+		}
+
+		if (readbackCallback)
+		{
+			readbackCallback(static_cast<const uint8_t*>(readbackBufferData[frame].mapped), headlessExtent.width, headlessExtent.height, *readbackFrames[frame]);
+		}
+
+		readbackFrames[frame].reset();
+	}
+
+	void Renderer::flushReadbacks()
+	{
+		if (!headless) return;
+
+		// oldest first, so frames are delivered in the order they were drawn
+		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			const size_t frame = (currentFrame + i) % MAX_FRAMES_IN_FLIGHT;
+			timeline.wait(frameValues[frame]);
+			deliverReadback(frame);
+		}
+	}
+
 	void Renderer::clean()
 	{
+		device->waitIdle();
+		frameGraph.reset(timeline);
+		// the texture is retired through the timeline, so it goes before the timeline is cleaned; the meshes and their
+		// geometry go with it, as the gpu is idle
+		texture.reset();
+		meshFactory.clean();
+		timeline.clean();
+
+		for (auto& offscreenImage : offscreenImages)
+		{
+			vmaDestroyImage(allocator, static_cast<VkImage>(offscreenImage.image.release()), offscreenImage.allocation);
+		}
+		offscreenImages.clear();
+
+		for (auto& readbackBuffer : readbackBufferData)
+		{
+			readbackBuffer.unmap();
+			readbackBuffer.destroy();
+		}
+		readbackBufferData.clear();
+
+		for (auto* lightBuffers : { &lightBufferData, &lightGridBufferData, &lightIndexBufferData })
+		{
+			for (auto& lightBuffer : *lightBuffers)
+			{
+				lightBuffer.unmap();
+				lightBuffer.destroy();
+			}
+			lightBuffers->clear();
+		}
+
+		for (auto& drawIndexBuffer : drawIndexBufferData)
+		{
+			drawIndexBuffer.unmap();
+			drawIndexBuffer.destroy();
+		}
+		drawIndexBufferData.clear();
+
+		for (auto& instanceBuffer : instanceBufferData)
+		{
+			instanceBuffer.unmap();
+			instanceBuffer.destroy();
+		}
+		instanceBufferData.clear();
+
+		// the framebuffers and views go before the images they reference
+		staticShadowFramebuffers.clear();
+		shadowFramebuffers.clear();
+		staticShadowLayerViews.clear();
+		shadowLayerViews.clear();
+		shadowArrayView.reset();
+		vmaDestroyImage(allocator, static_cast<VkImage>(staticShadowImage.image.release()), staticShadowImage.allocation);
+		vmaDestroyImage(allocator, static_cast<VkImage>(shadowImage.image.release()), shadowImage.allocation);
+
+		colorImageView.reset();
+		vmaDestroyImage(allocator, static_cast<VkImage>(colorImage.image.release()), colorImage.allocation);
 		vmaDestroyImage(allocator, static_cast<VkImage>(depthImage.image.release()), depthImage.allocation);
-		vmaDestroyImage(allocator, static_cast<VkImage>(textureImage.image.release()), textureImage.allocation);
+
+		imGuiLayer.clean();
+		pipelineCache.clean();
 
 		//device->destroyImage(depthImage.image.release());
 		//device->destroyImage(textureImage.image.release());
@@ -165,143 +537,202 @@ namespace bento
 		//vmaFreeMemory(allocator, depthImage.allocation);
 		//vmaFreeMemory(allocator, textureImage.allocation);
 
+		// last, once everything allocated from it is gone
 		vmaDestroyAllocator(allocator);
 
-		device->waitIdle();
-
 		// Unique references will automatically be deallocated
 
-		meshFactory.clean();
-
 		VulkanUtils::DestroyDebugUtilsMessengerEXT(instance->operator VkInstance_T*(), debugMessenger, nullptr);
 
-		log::info("cleaned renderer");
+		BENTO_LOG_INFO("cleaned renderer");
 	}
 
 	void Renderer::initalizeVulkan()
 	{
-		log::info("Initializing Vulkan...");
+		BENTO_LOG_INFO("Initializing Vulkan...");
 
 		createInstance();
 		setupDebugMessenger();
-		createSurface();
+		if (!headless)
+		{
+			createSurface();
+		}
 		pickPhysicalDevice();
 		createLogicalDevice();
+		createTimeline();
 		createAllocator();
-		createSwapChain();
+		if (headless)
+		{
+			createOffscreenTargets();
+		}
+		else
+		{
+			createSwapChain();
+		}
 		createImageViews();
-		createRenderPass();
+		if (!dynamicRendering)
+		{
+			createRenderPass();
+		}
+		createShadowRenderPasses();
 		createDescriptorSetLayout();
-		createObjectDescriptorSetLayout();
 		createGraphicsPipeline();
+		createShadowPipeline();
+		createLightCullingPipeline();
 		createCommandPool();
-		createDepthResources();
-		createFramebuffers();
+		createTimestampQueryPool();
+		if (dynamicRendering)
+		{
+			createFrameGraph();
+		}
+		else
+		{
+			createColorResources();
+			createDepthResources();
+			createFramebuffers();
+		}
 		createTextureImage();
-		createTextureImageView();
 		createTextureSampler();
 		createVertexBuffer();
 		createIndexBuffer();
 		createUniformBuffers();
+		createInstanceBuffers();
+		createLightBuffers();
+		createShadowResources();
+		if (headless)
+		{
+			createReadbackBuffers();
+		}
 		createDescriptorPool();
-		createObjectDescriptorPool();
 		createDescriptorSets();
-		//createObjectDescriptorSets();
+		createInstanceDescriptorSets();
 
-		//imGuiLayer.initialize(renderPass.get(), swapChainExtent.width, swapChainExtent.height);
+		// there is nobody to look at a ui when headless
+		if (!headless)
+		{
+			if (!dynamicRendering)
+			{
+				createImGuiRenderPass();
+				createImGuiFramebuffers();
+			}
+			imGuiLayer.initialize(imGuiRenderPass.get(), swapChainImageFormat, static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), MAX_FRAMES_IN_FLIGHT);
+		}
 
 		allocateCommandBuffers();
-		createCommandBuffers();
+		allocateShadowCommandBuffers();
+		if (!headless)
+		{
+			allocateImGuiCommandBuffers();
+		}
 		createSyncObjects();
 
-		log::info("Vulkan initialized");
+		BENTO_LOG_INFO("Vulkan initialized");
 	}
 
-	void Renderer::cleanupSwapChain()
+	void Renderer::recreateSwapChain()
 	{
-		// release unique pointers so each element can be recreated afterwards
-		device->destroyImageView(depthImageView.release());
-
-		//device->destroyImage(depthImage.image.release());
-		//device->freeMemory(depthImage.memory.release());
-		vmaDestroyImage(allocator, static_cast<VkImage>(depthImage.image.get()), depthImage.allocation);
-		vmaFreeMemory(allocator, depthImage.allocation);
-
-		for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
-			device->destroyFramebuffer(swapChainFramebuffers[i].release());
+		// minimized; drawFrame skips frames and comes back here once the window has a size again
+		if (framebufferExtent.width == 0 || framebufferExtent.height == 0)
+		{
+			return;
 		}
-		swapChainFramebuffers.clear();
 
-		for (size_t i = 0; i < commandBuffers.size(); i++) {
-			device->freeCommandBuffers(commandPool.get(), commandBuffers[i].release());
-		}
-		commandBuffers.clear();
+		BENTO_LOG_INFO("Recreating the swap chain");
 
-		device->destroyPipeline(graphicsPipeline.release());
-		device->destroyPipelineLayout(pipelineLayout.release());
-		device->destroyRenderPass(renderPass.release());
+		// frames still in flight keep using the old images, so nothing is waited on; everything sized to the old extent
+		// is retired and released once the last frame using it has finished. the render pass and pipelines (whose viewport
+		// and scissor are dynamic) don't depend on the extent and are kept, and so are the per-image uniform buffers and
+		// descriptor sets unless the image count changes
+		const size_t imageCount = swapChainImages.size();
 
-		for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-			device->destroyImageView(swapChainImageViews[i].release(), nullptr); \
+		timeline.retire(std::exchange(commandBuffers, {}));
+		timeline.retire(std::exchange(swapChainFramebuffers, {}));
+		timeline.retire(std::exchange(imGuiFramebuffers, {}));
+		timeline.retire(std::exchange(swapChainImageViews, {}));
+		if (colorImageView)
+		{
+			timeline.retire(std::move(colorImageView));
+			timeline.retire(std::move(colorImage), allocator);
 		}
-		swapChainImageViews.clear();
+		timeline.retire(std::move(depthImageView));
+		timeline.retire(std::move(depthImage), allocator);
 
-		device->destroySwapchainKHR(swapChain.release());
+		// hands the old swap chain over and retires it
+		createSwapChain();
 
-		for (size_t i = 0; i < swapChainImages.size(); i++) {
-			device->destroyBuffer(uniformBufferData[i].buffer.release());
-			device->freeMemory(uniformBufferData[i].memory.release());
-		}
-		uniformBufferData.clear();
+		// the driver is free to hand back a different number of images, e.g. after a present mode change
+		if (swapChainImages.size() != imageCount)
+		{
+			BENTO_LOG_INFO("Swap chain image count changed from {} to {}", imageCount, swapChainImages.size());
+			recreatePerImageResources();
 
-		device->destroyDescriptorPool(descriptorPool.release());
-	}
+			// nothing submitted has used the new buffers and sets yet
+			imageValues.assign(swapChainImages.size(), 0);
+		}
+		else
+		{
+			// the per-image buffers are kept, but which old image last used which of them no longer says anything about
+			// the new images, so each waits for everything submitted before it is written again
+			imageValues.assign(swapChainImages.size(), timeline.getSubmittedValue());
+		}
 
-	void Renderer::recreateSwapChain()
-	{
-		int width = 0, height = 0;
-		glfwGetFramebufferSize(window->getHandle(), &width, &height);
-		while (width == 0 || height == 0) {
-			glfwGetFramebufferSize(window->getHandle(), &width, &height);
-			glfwWaitEvents();
+		createImageViews();
+		if (dynamicRendering)
+		{
+			// the graph's transient images are sized to the old extent; they are retired like everything else
+			frameGraph.reset(timeline);
+			createFrameGraph();
+		}
+		else
+		{
+			createColorResources();
+			createDepthResources();
+			createFramebuffers();
+			createImGuiFramebuffers();
 		}
 
-		device->waitIdle();
+		// the old command buffers may still be pending, so record into fresh ones
+		allocateCommandBuffers();
 
-		log::info("Recreating the swap chain");
+		imGuiLayer.resize(static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height));
+	}
 
-		cleanupSwapChain();
+	void Renderer::recreatePerImageResources()
+	{
+		// frames still in flight keep reading the old buffers and sets; the sets go before the pool they came from
+		timeline.retire(std::exchange(descriptorSets, {}));
+		timeline.retire(std::move(descriptorPool));
+		timeline.retire(std::exchange(uniformBufferData, {}));
+		timeline.retire(std::exchange(lightBufferData, {}));
+		timeline.retire(std::exchange(lightGridBufferData, {}));
+		timeline.retire(std::exchange(lightIndexBufferData, {}));
 
-		createSwapChain();
-		createImageViews();
-		createRenderPass();
-		createGraphicsPipeline();
-		createDepthResources();
-		createFramebuffers();
 		createUniformBuffers();
+		createLightBuffers();
 		createDescriptorPool();
 		createDescriptorSets();
-		createCommandBuffers();
 	}
 
 	void Renderer::createInstance()
 	{
 		if (enableValidationLayers && !checkValidationLayerSupport())
 		{
-			std::cout << "Set the environment variable VK_LAYER_PATH to point to the location of your layers" << std::endl;
+			BENTO_LOG_ERROR("Set the environment variable VK_LAYER_PATH to point to the location of your layers");
 
 			throw std::runtime_error("validation layers requested, but not available!");
 		}
 
-		vk::ApplicationInfo applicationInfo("bento test", 1, "bento", 1, VK_API_VERSION_1_1);
+		// 1.2 for timeline semaphores
+		vk::ApplicationInfo applicationInfo("bento test", 1, "bento", 1, VK_API_VERSION_1_2);
 
 		auto extensions = getRequiredExtensions();
 
+		// only request the validation layers when they're in use; build machines usually don't have them installed
 		vk::InstanceCreateInfo instanceCreateInfo(
 			vk::InstanceCreateFlags(),
 			&applicationInfo,
-			static_cast<uint32_t>(instanceLayerNames.size()),
-			instanceLayerNames.data(),
+			enableValidationLayers ? static_cast<uint32_t>(instanceLayerNames.size()) : 0,
+			enableValidationLayers ? instanceLayerNames.data() : nullptr,
 			static_cast<uint32_t>(extensions.size()),
 			extensions.data()
 		);
@@ -321,7 +752,7 @@ namespace bento
 		instance = vk::createInstanceUnique(instanceCreateInfo);
 
 		context.instance = instance.get();
-		log::trace("Created Vulkan instance");
+		BENTO_LOG_TRACE("Created Vulkan instance");
 	}
 
 	void Renderer::setupDebugMessenger()
@@ -330,7 +761,7 @@ namespace bento
 
 		debugMessenger = VulkanUtils::createDebugUtilsMessenger(instance);
 
-		log::trace("Created debug messenger");
+		BENTO_LOG_TRACE("Created debug messenger");
 	}
 
 	void Renderer::createSurface()
@@ -344,7 +775,7 @@ namespace bento
 		}
 
 		context.surface = surface.get();
-		log::trace("Created surface");
+		BENTO_LOG_TRACE("Created surface");
 	}
 
 	void Renderer::pickPhysicalDevice()
@@ -371,8 +802,32 @@ namespace bento
 		vk::PhysicalDeviceProperties properties;
 		physicalDevice.getProperties(&properties);
 
+		deviceName = properties.deviceName;
+
 		context.physicalDevice = physicalDevice;
-		log::trace("Selected physical device {}", properties.deviceName);
+		BENTO_LOG_TRACE("Selected physical device {}", properties.deviceName);
+
+		// the highest sample count no greater than the one asked for that both the color and depth attachments support
+		const vk::SampleCountFlags supportedSamples = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+		msaaSamples = vk::SampleCountFlagBits::e1;
+		for (vk::SampleCountFlagBits samples : { vk::SampleCountFlagBits::e64, vk::SampleCountFlagBits::e32, vk::SampleCountFlagBits::e16,
+		                                         vk::SampleCountFlagBits::e8, vk::SampleCountFlagBits::e4, vk::SampleCountFlagBits::e2 })
+		{
+			if (samples <= requestedSamples && (supportedSamples & samples))
+			{
+				msaaSamples = samples;
+				break;
+			}
+		}
+		if (msaaSamples != requestedSamples)
+		{
+			BENTO_LOG_WARN("{} samples requested but only {} are supported", static_cast<uint32_t>(requestedSamples), static_cast<uint32_t>(msaaSamples));
+		}
+
+		if (VulkanUtils::hasLazilyAllocatedMemory(physicalDevice))
+		{
+			transientMemory |= vk::MemoryPropertyFlagBits::eLazilyAllocated;
+		}
 	}
 
 	void Renderer::createLogicalDevice()
@@ -400,17 +855,40 @@ namespace bento
 		}
 
 		// Request specific device features
+		// anisotropy is optional so software implementations without it can still be used
+		vk::PhysicalDeviceFeatures supportedFeatures;
+		physicalDevice.getFeatures(&supportedFeatures);
+		anisotropySupported = supportedFeatures.samplerAnisotropy;
+
 		vk::PhysicalDeviceFeatures deviceFeatures;
-		deviceFeatures.samplerAnisotropy = true;
+		deviceFeatures.samplerAnisotropy = anisotropySupported;
 
 		// get a list of extensions to enable for the device
+		const std::vector<std::string> requiredExtensions = getRequiredDeviceExtensions();
 		std::vector<char const *> enabledExtensions;
-		enabledExtensions.reserve(deviceExtensions.size());
-		for (auto const & ext : deviceExtensions)
+		enabledExtensions.reserve(requiredExtensions.size());
+		for (auto const & ext : requiredExtensions)
 		{
 			enabledExtensions.push_back(ext.data());
 		}
 
+		// render passes and framebuffers are skipped when the driver can render straight into image views
+		vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures;
+		if (dynamicRenderingAllowed && checkDynamicRenderingSupport(physicalDevice))
+		{
+			dynamicRendering = true;
+			enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+			dynamicRenderingFeatures.dynamicRendering = true;
+		}
+
+		// all gpu/cpu synchronization goes through a timeline semaphore
+		vk::PhysicalDeviceVulkan12Features vulkan12Features;
+		vulkan12Features.timelineSemaphore = true;
+		if (dynamicRendering)
+		{
+			vulkan12Features.pNext = &dynamicRenderingFeatures;
+		}
+
 		// put together our create info
 		vk::DeviceCreateInfo deviceCreateInfo(
 			vk::DeviceCreateFlags(),
@@ -419,6 +897,7 @@ namespace bento
 			enabledExtensions,
 			&deviceFeatures
 		);
+		deviceCreateInfo.pNext = &vulkan12Features;
 
 		// create UniqueDevice
 		device = physicalDevice.createDeviceUnique(deviceCreateInfo);
@@ -427,12 +906,33 @@ namespace bento
 		device->getQueue(indices.graphicsFamily.value(), 0, &graphicsQueue);
 		device->getQueue(indices.presentFamily.value(), 0, &presentQueue);
 
+		if (dynamicRendering)
+		{
+			// extension commands aren't in the loader's static exports
+			cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(device->getProcAddr("vkCmdBeginRenderingKHR"));
+			cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(device->getProcAddr("vkCmdEndRenderingKHR"));
+			if (!cmdBeginRendering || !cmdEndRendering)
+			{
+				throw std::runtime_error("failed to load the dynamic rendering commands!");
+			}
+
+			BENTO_LOG_INFO("Using dynamic rendering");
+		}
+
 		context.device = device.get();
 		context.queue = graphicsQueue;
-		log::trace("Created logical device");
+		BENTO_LOG_TRACE("Created logical device");
 	}
 
-	void Renderer::createAllocator()
+	void Renderer::createTimeline()
+	{
+		timeline.initialize(device.get(), graphicsQueue);
+		context.timeline = &timeline;
+
+		frameValues.assign(MAX_FRAMES_IN_FLIGHT, 0);
+	}
+
+	void Renderer::createAllocator()
 	{
 		VmaAllocatorCreateInfo allocatorInfo = {};
 		allocatorInfo.physicalDevice = static_cast<VkPhysicalDevice>(physicalDevice);
@@ -442,7 +942,7 @@ namespace bento
 		vmaCreateAllocator(&allocatorInfo, &allocator);
 
 		context.allocator = allocator;
-		log::trace("Created memory allocator");
+		BENTO_LOG_TRACE("Created memory allocator");
 	}
 
 	void Renderer::createSwapChain()
@@ -457,6 +957,12 @@ namespace bento
 		// how many images (minimum) do we want in the swap chain? we'll add 1 to that so there's no waiting on the driver to retrieve a new image
 		uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
 
+		// when recreating, ask for as many as before so everything allocated per image can usually be kept
+		// (the driver may still return a different count, which recreateSwapChain handles)
+		if (!swapChainImages.empty()) {
+			imageCount = std::max(static_cast<uint32_t>(swapChainImages.size()), swapChainSupport.capabilities.minImageCount);
+		}
+
 		// make sure we don't exceed the maximum number of images while doing this
 		if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
 			imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -497,11 +1003,16 @@ namespace bento
 		createInfo.presentMode = presentMode;
 		// don't care if pixels are obscured by another Window or something
 		createInfo.clipped = VK_TRUE;
-		// old swap chain for if the the swap chain has to be rebuilt
-		createInfo.oldSwapchain = nullptr;
+		// when rebuilding, the old swap chain is handed over so the driver can reuse its resources and frames still in flight can present from it
+		createInfo.oldSwapchain = swapChain.get();
 
 		// create swap chain
-		swapChain = device->createSwapchainKHRUnique(createInfo);
+		vk::UniqueSwapchainKHR newSwapChain = device->createSwapchainKHRUnique(createInfo);
+		if (swapChain)
+		{
+			timeline.retire(std::move(swapChain));
+		}
+		swapChain = std::move(newSwapChain);
 
 		// get images from swap chain
 		swapChainImages = device->getSwapchainImagesKHR(swapChain.get());
@@ -512,7 +1023,39 @@ namespace bento
 
 		context.swapChainExtent = extent;
 		context.swapChainImageCount = swapChainImages.size();
-		log::trace("Created swap chain");
+		BENTO_LOG_TRACE("Created swap chain");
+	}
+
+	void Renderer::createOffscreenTargets()
+	{
+		// headless frames are drawn into plain images and copied out instead of being presented
+		swapChainImageFormat = vk::Format::eR8G8B8A8Srgb;
+		swapChainExtent = headlessExtent;
+
+		offscreenImages.resize(MAX_FRAMES_IN_FLIGHT);
+		swapChainImages.clear();
+
+		for (auto& offscreenImage : offscreenImages)
+		{
+			offscreenImage = VulkanUtils::createImage(
+				allocator,
+				device.get(),
+				physicalDevice,
+				swapChainExtent.width,
+				swapChainExtent.height,
+				swapChainImageFormat,
+				vk::ImageTiling::eOptimal,
+				vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+				vk::MemoryPropertyFlagBits::eDeviceLocal
+			);
+
+			// the rest of the renderer treats these exactly like swap chain images
+			swapChainImages.push_back(offscreenImage.image.get());
+		}
+
+		context.swapChainExtent = swapChainExtent;
+		context.swapChainImageCount = swapChainImages.size();
+		BENTO_LOG_TRACE("Created offscreen render targets");
 	}
 
 	// create a new image view for each swap chain image
@@ -529,7 +1072,7 @@ namespace bento
 			swapChainImageViews.push_back(VulkanUtils::createImageView(device.get(), swapChainImage, swapChainImageFormat, vk::ImageAspectFlagBits::eColor));
 		}
 
-		log::trace("Created swap chain image views");
+		BENTO_LOG_TRACE("Created swap chain image views");
 	}
 
 	void Renderer::createRenderPass()
@@ -537,24 +1080,28 @@ namespace bento
 		// the render pass details how many color and depth buffers there are,
 		// how many samples to use for each of them, and how their contents should be handled throughout the rendering process
 
+		const bool multisampled = msaaSamples != vk::SampleCountFlagBits::e1;
+		const vk::ImageLayout finalLayout = headless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+
 		// we'll have a single color buffer attachment represented by one of the images from the swap chain
+		// when multisampling it is a transient image instead, which is never stored; only its resolve into the swap chain image is
 		vk::AttachmentDescription colorAttachment(
 			{},
 			swapChainImageFormat,
-			vk::SampleCountFlagBits::e1,
+			msaaSamples,
 			vk::AttachmentLoadOp::eClear,
-			vk::AttachmentStoreOp::eStore,
+			multisampled ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore,
 			vk::AttachmentLoadOp::eDontCare,
 			vk::AttachmentStoreOp::eDontCare,
 			vk::ImageLayout::eUndefined,
-			vk::ImageLayout::ePresentSrcKHR
+			multisampled ? vk::ImageLayout::eColorAttachmentOptimal : finalLayout
 		);
 
 		// depth attachment for the image
 		vk::AttachmentDescription depthAttachment(
 			{},
 			VulkanUtils::findDepthFormat(physicalDevice),
-			vk::SampleCountFlagBits::e1,
+			msaaSamples,
 			vk::AttachmentLoadOp::eClear,
 			vk::AttachmentStoreOp::eDontCare,
 			vk::AttachmentLoadOp::eDontCare,
@@ -573,6 +1120,20 @@ namespace bento
 		// a reference to the depth attachment
 		vk::AttachmentReference depthAttachmentReference(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
 
+		// the swap chain image the samples are averaged into at the end of the subpass
+		vk::AttachmentDescription resolveAttachment(
+			{},
+			swapChainImageFormat,
+			vk::SampleCountFlagBits::e1,
+			vk::AttachmentLoadOp::eDontCare,
+			vk::AttachmentStoreOp::eStore,
+			vk::AttachmentLoadOp::eDontCare,
+			vk::AttachmentStoreOp::eDontCare,
+			vk::ImageLayout::eUndefined,
+			finalLayout
+		);
+		vk::AttachmentReference resolveAttachmentReference(2, vk::ImageLayout::eColorAttachmentOptimal);
+
 		// describe the subpass; where does it exist in the pipeline; what are its attachments
 		vk::SubpassDescription subpass(
 			{},
@@ -583,6 +1144,10 @@ namespace bento
 			&colorAttachmentReference
 		);
 		subpass.pDepthStencilAttachment = &depthAttachmentReference;
+		if (multisampled)
+		{
+			subpass.pResolveAttachments = &resolveAttachmentReference;
+		}
 
 		// iffy about this one
 		// we need a subpass dependency to automatically take care of image layout transitions
@@ -595,20 +1160,41 @@ namespace bento
 			vk::AccessFlagBits::eColorAttachmentWrite
 		);
 
+		std::vector<vk::SubpassDependency> dependencies = { dependency };
+
+		// headless images are read by a copy after the pass, and that copy must finish before the image is cleared again
+		if (headless)
+		{
+			dependencies[0].srcStageMask |= vk::PipelineStageFlagBits::eTransfer;
+
+			dependencies.push_back(vk::SubpassDependency(
+				0,
+				VK_SUBPASS_EXTERNAL,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::AccessFlagBits::eColorAttachmentWrite,
+				vk::AccessFlagBits::eTransferRead
+			));
+		}
+
 		// create render pass
-		std::array<vk::AttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+		std::vector<vk::AttachmentDescription> attachments = { colorAttachment, depthAttachment };
+		if (multisampled)
+		{
+			attachments.push_back(resolveAttachment);
+		}
 		vk::RenderPassCreateInfo renderPassInfo(
 			{},
 			attachments.size(),
 			attachments.data(),
 			1,
 			&subpass,
-			1,
-			&dependency
+			dependencies.size(),
+			dependencies.data()
 		);
 		renderPass = device->createRenderPassUnique(renderPassInfo);
 
-		log::trace("Created render pass");
+		BENTO_LOG_TRACE("Created render pass");
 	}
 
 	void Renderer::createDescriptorSetLayout()
@@ -616,16 +1202,11 @@ namespace bento
 		// transferring frame-updated information to the gpu can be slow if not done correctly
 		// we'll be using a resource descriptor; its how we will access our uniform buffer object
 
-		// describe layout binding for uniform buffer
+		// describe layout binding for uniform buffer; the light culling pass and the fragment shader read the cluster grid's parameters from it
 		vk::DescriptorSetLayoutBinding uboLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1);
-		uboLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
+		uboLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
 		uboLayoutBinding.pImmutableSamplers = nullptr;
 
-		// describe layout for model matrix uniform variable
-		vk::DescriptorSetLayoutBinding modelMatBinding(1, vk::DescriptorType::eUniformBuffer, 1);
-		modelMatBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
-		modelMatBinding.pImmutableSamplers = nullptr;
-
 		// describe layout binding for sampler
 		vk::DescriptorSetLayoutBinding samplerLayoutBinding(
 			2,
@@ -635,70 +1216,161 @@ namespace bento
 			nullptr
 		);
 
-		std::array<vk::DescriptorSetLayoutBinding, 3> bindings = { uboLayoutBinding, modelMatBinding, samplerLayoutBinding };
+		// the lights, and the grid and index list the light culling pass bins them into
+		const vk::ShaderStageFlags lightStages = vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
+		vk::DescriptorSetLayoutBinding lightsBinding(3, vk::DescriptorType::eStorageBuffer, 1, lightStages, nullptr);
+		vk::DescriptorSetLayoutBinding lightGridBinding(4, vk::DescriptorType::eStorageBuffer, 1, lightStages, nullptr);
+		vk::DescriptorSetLayoutBinding lightIndicesBinding(5, vk::DescriptorType::eStorageBuffer, 1, lightStages, nullptr);
+
+		// the directional light's cascaded shadow maps, sampled with depth comparison
+		vk::DescriptorSetLayoutBinding shadowMapBinding(6, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr);
+
+		std::array<vk::DescriptorSetLayoutBinding, 6> bindings = {
+			uboLayoutBinding, samplerLayoutBinding, lightsBinding, lightGridBinding, lightIndicesBinding, shadowMapBinding
+		};
 
 		// create descriptor set for ubo
 		vk::DescriptorSetLayoutCreateInfo layoutInfo({}, bindings.size(), bindings.data());
 		descriptorSetLayout = device->createDescriptorSetLayoutUnique(layoutInfo);
 
+		// the frame's world matrices and the draw index buffer, which picks each instanced draw's matrices out of them
+		std::array<vk::DescriptorSetLayoutBinding, 2> instanceBindings = {
+			vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr),
+			vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr)
+		};
+		vk::DescriptorSetLayoutCreateInfo instanceLayoutInfo({}, instanceBindings.size(), instanceBindings.data());
+		instanceDescriptorSetLayout = device->createDescriptorSetLayoutUnique(instanceLayoutInfo);
+
 		//context.descriptorSetLayout = descriptorSetLayout.get();
-		log::trace("Created descriptor set layout");
+		BENTO_LOG_TRACE("Created descriptor set layout");
 	}
 
-	void Renderer::createObjectDescriptorSetLayout()
+	void Renderer::createGraphicsPipeline()
 	{
-		// transferring frame-updated information to the gpu can be slow if not done correctly
-		// we'll be using a resource descriptor; its how we will access our uniform buffer object
-
-		// describe layout binding for uniform buffer
-		vk::DescriptorSetLayoutBinding uboLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1);
-		uboLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
-		uboLayoutBinding.pImmutableSamplers = nullptr;
+		// draws are placed through the instance set and the material is pushed, so there is no per mesh set to bind
+		vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eFragment, 0, sizeof(DrawConstants));
 
-		// describe layout binding for sampler
-		vk::DescriptorSetLayoutBinding samplerLayoutBinding(
-			1,
-			vk::DescriptorType::eCombinedImageSampler,
+		// create the graphics pipeline layout; shared by every material, so both sets stay bound across pipeline switches
+		std::array<vk::DescriptorSetLayout, 2> setLayouts = { descriptorSetLayout.get(), instanceDescriptorSetLayout.get() };
+		vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+			{},
+			setLayouts.size(),
+			setLayouts.data(),
 			1,
-			vk::ShaderStageFlagBits::eFragment,
-			nullptr
+			&pushConstantRange
 		);
+		pipelineLayout = device->createPipelineLayoutUnique(pipelineLayoutInfo);
 
-		std::array<vk::DescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
-
-		// create descriptor set for ubo
-		vk::DescriptorSetLayoutCreateInfo layoutInfo({}, bindings.size(), bindings.data());
-		objectDescriptorSetLayout = device->createDescriptorSetLayoutUnique(layoutInfo);
-
-		context.descriptorSetLayout = objectDescriptorSetLayout.get();
-		log::trace("Created object descriptor set layout");
+		PipelineTargets targets;
+		targets.renderPass = renderPass.get();
+		targets.colorFormat = swapChainImageFormat;
+		targets.depthFormat = VulkanUtils::findDepthFormat(physicalDevice);
+		targets.samples = msaaSamples;
+		pipelineCache.initialize(device.get(), pipelineLayout.get(), targets, PIPELINE_COMPILE_THREADS);
+
+		// the defaults are what everything else falls back to while compiling, so they can't be left to the workers
+		// the depth prepass variants are among them, so switching the prepass on never needs a pipeline built at runtime
+		const Material material;
+		graphicsPipeline = pipelineCache.require(material);
+		depthEqualPipeline = pipelineCache.require(material.depthEqual());
+		depthPrepassPipeline = pipelineCache.require(material.depthOnly());
+
+		BENTO_LOG_TRACE("Created graphics pipeline");
 	}
 
-	void Renderer::createGraphicsPipeline()
+	void Renderer::createLightCullingPipeline()
 	{
-		// we now need to set up and configure a graphics pipeline for drawing an image
-		// this is effectively the process for getting stuff to the shaders
-		Shader vertexShader(device.get(), "shaders/vert.spv");
-		Shader fragmentShader(device.get(), "shaders/frag.spv");
+		// one invocation per cluster, testing every light against the cluster's bounds; only needs the global descriptor set
+		Shader computeShader(device.get(), "shaders/cluster.spv");
 
-		// assign the shaders to a specific pipeline stage
-		vk::PipelineShaderStageCreateInfo vertShaderStageInfo(
+		vk::PipelineShaderStageCreateInfo computeShaderStageInfo(
 			{},
-			vk::ShaderStageFlagBits::eVertex,
-			vertexShader.shaderModule.get(),
+			vk::ShaderStageFlagBits::eCompute,
+			computeShader.shaderModule.get(),
 			"main"
 		);
 
-		vk::PipelineShaderStageCreateInfo fragShaderStageInfo(
+		vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
 			{},
-			vk::ShaderStageFlagBits::eFragment,
-			fragmentShader.shaderModule.get(),
-			"main"
+			1,
+			&descriptorSetLayout.get(),
+			0,
+			nullptr
+		);
+		lightCullingPipelineLayout = device->createPipelineLayoutUnique(pipelineLayoutInfo);
+
+		vk::ComputePipelineCreateInfo computePipelineCreateInfo(
+			{},
+			computeShaderStageInfo,
+			lightCullingPipelineLayout.get()
+		);
+		lightCullingPipeline = device->createComputePipelineUnique(nullptr, computePipelineCreateInfo);
+
+		BENTO_LOG_TRACE("Created light culling pipeline");
+	}
+
+	void Renderer::createShadowRenderPasses()
+	{
+		// copied and sampled as well as rendered to
+		shadowFormat = VulkanUtils::findSupportedFormat(
+			physicalDevice,
+			{ vk::Format::eD32Sfloat, vk::Format::eD16Unorm },
+			vk::ImageTiling::eOptimal,
+			vk::FormatFeatureFlagBits::eDepthStencilAttachment | vk::FormatFeatureFlagBits::eSampledImage |
+			vk::FormatFeatureFlagBits::eTransferSrc | vk::FormatFeatureFlagBits::eTransferDst
 		);
 
-		std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages = { vertShaderStageInfo, fragShaderStageInfo };
+		// with dynamic rendering the format is all that's needed
+		if (dynamicRendering)
+		{
+			return;
+		}
+
+		// the shadow command buffer moves the layers in and out of the attachment layout itself, since they are also copied and sampled
+		for (const bool clear : { true, false })
+		{
+			vk::AttachmentDescription depthAttachment(
+				{},
+				shadowFormat,
+				vk::SampleCountFlagBits::e1,
+				clear ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eLoad,
+				vk::AttachmentStoreOp::eStore,
+				vk::AttachmentLoadOp::eDontCare,
+				vk::AttachmentStoreOp::eDontCare,
+				vk::ImageLayout::eDepthStencilAttachmentOptimal,
+				vk::ImageLayout::eDepthStencilAttachmentOptimal
+			);
+
+			vk::AttachmentReference depthAttachmentRef(0, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+			vk::SubpassDescription subpass(
+				{},
+				vk::PipelineBindPoint::eGraphics,
+				0,
+				nullptr,
+				0,
+				nullptr,
+				nullptr,
+				&depthAttachmentRef
+			);
+
+			vk::RenderPassCreateInfo renderPassInfo({}, 1, &depthAttachment, 1, &subpass);
+			(clear ? shadowClearRenderPass : shadowLoadRenderPass) = device->createRenderPassUnique(renderPassInfo);
+		}
+
+		BENTO_LOG_TRACE("Created shadow render passes");
+	}
+
+	void Renderer::createShadowPipeline()
+	{
+		// the graphics pipeline without a fragment stage or color attachments, single sampled and with depth bias against acne
+		Shader vertexShader(device.get(), "shaders/shadow_vert.spv");
+
+		std::array<vk::PipelineShaderStageCreateInfo, 1> shaderStages = {
+			vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertexShader.shaderModule.get(), "main")
+		};
 
-		// describe the format of the vertex data
+		// only the position is read
 		auto bindingDescription = Vertex::getBindingDescription();
 		auto attributeDescriptions = Vertex::getAttributeDescriptions();
 
@@ -706,44 +1378,31 @@ namespace bento
 			{},
 			1,
 			&bindingDescription,
-			attributeDescriptions.size(),
+			1,
 			attributeDescriptions.data()
 		);
 
-		// describe the kind of geometry being drawn and if primitive restart should be enabled
-		// primitive restart allows us to use an element buffer
 		vk::PipelineInputAssemblyStateCreateInfo inputAssembly(
 			{},
 			vk::PrimitiveTopology::eTriangleList,
 			false
 		);
 
-		// describe the region of the framebuffer that the output will be rendered to (in our case, the whole Window)
-		vk::Viewport viewport(
-			0.0f,
-			0.0f,
-			static_cast<float>(swapChainExtent.width),
-			static_cast<float>(swapChainExtent.height),
-			0.0f,
-			1.0f
-		);
-
-		// scissor allows us to cut out parts of the viewport area, we want all of it though
-		vk::Rect2D scissor(
-			{ 0, 0 },
-			swapChainExtent
-		);
-
-		// combine the viewport and scissor into viewport state
 		vk::PipelineViewportStateCreateInfo viewportState(
 			{},
 			1,
-			&viewport,
+			nullptr,
 			1,
-			&scissor
+			nullptr
 		);
 
-		// describe rasterization process; depth testing, face culling, polygon types, etc.
+		std::array<vk::DynamicState, 2> dynamicStates = {
+			vk::DynamicState::eViewport,
+			vk::DynamicState::eScissor
+		};
+		vk::PipelineDynamicStateCreateInfo dynamicState({}, dynamicStates.size(), dynamicStates.data());
+
+		// no culling, like the main pass; the slope scaled bias keeps surfaces at grazing angles from shadowing themselves
 		vk::PipelineRasterizationStateCreateInfo rasterizer(
 			{},
 			false,
@@ -751,15 +1410,13 @@ namespace bento
 			vk::PolygonMode::eFill,
 			vk::CullModeFlagBits::eNone,
 			vk::FrontFace::eCounterClockwise,
-			false,
-			0.0f,
-			0.0f,
+			true,
+			1.25f,
 			0.0f,
+			1.75f,
 			1.0f
 		);
 
-		// configure multisampling (requires a gpu feature)
-		// we'll keep it disabled for now
 		vk::PipelineMultisampleStateCreateInfo multisampling(
 			{},
 			vk::SampleCountFlagBits::e1,
@@ -770,15 +1427,11 @@ namespace bento
 			false
 		);
 
-		// depth and stencil testing
-		// - depth comare op: specifies the comparison that is performed to keep or discard fragments
-		//		we're sticking to lower depth = closer
-		// - not using stencil for now
 		vk::PipelineDepthStencilStateCreateInfo depthStencil(
 			{},
 			true,
 			true,
-			vk::CompareOp::eLess,
+			vk::CompareOp::eLessOrEqual,
 			false,
 			false,
 			{},
@@ -787,66 +1440,56 @@ namespace bento
 			1.0f
 		);
 
-		// describe color blend configuration per attached framebuffer
-		vk::PipelineColorBlendAttachmentState colorBlendAttachment(
-			false,
-			vk::BlendFactor::eOne,
-			vk::BlendFactor::eZero,
-			vk::BlendOp::eAdd,
-			vk::BlendFactor::eOne,
-			vk::BlendFactor::eZero,
-			vk::BlendOp::eAdd,
-			vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
-		);
-
-		// describe global color blending settings
 		vk::PipelineColorBlendStateCreateInfo colorBlending(
 			{},
 			false,
 			vk::LogicOp::eCopy,
-			1,
-			&colorBlendAttachment
-			// blend constants
+			0,
+			nullptr
 		);
 
-		// dynamic state stuff goes here
-		// using a dynamic state means data needs to be specified at draw time
-		// https://vulkan-tutorial.com/en/Drawing_a_triangle/Graphics_pipeline_basics/Fixed_functions
+		// the casters are read through the instance set like the main pass's draws; each cascade's matrix is pushed
+		vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4));
 
-		std::array<vk::DescriptorSetLayout, 2> desriptorSetLayouts = {
-			descriptorSetLayout.get(),
-			objectDescriptorSetLayout.get()
-		};
+		vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+			{},
+			1,
+			&instanceDescriptorSetLayout.get(),
+			1,
+			&pushConstantRange
+		);
+		shadowPipelineLayout = device->createPipelineLayoutUnique(pipelineLayoutInfo);
 
-		// create the graphics pipeline layout
-		vk::PipelineLayoutCreateInfo pipelineLayoutInfo(	// check here later
+		vk::GraphicsPipelineCreateInfo shadowPipelineCreateInfo(
 			{},
-			2,
-			desriptorSetLayouts.data(),
-			0,
-			nullptr
+			shaderStages,
+			&vertexInputInfo,
+			&inputAssembly,
+			nullptr,
+			&viewportState,
+			&rasterizer,
+			&multisampling,
+			&depthStencil,
+			&colorBlending,
+			&dynamicState,
+			shadowPipelineLayout.get(),
+			shadowClearRenderPass.get()		// compatible with the load pass too; null with dynamic rendering
 		);
-		pipelineLayout = device->createPipelineLayoutUnique(pipelineLayoutInfo);
 
-		// create the graphics pipeline
-		vk::GraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
-			{},									// flags
-			shaderStages,								// stages
-			&vertexInputInfo,							// pVertexInputState
-			&inputAssembly,								// pInputAssemblyState
-			nullptr,                   // pTessellationState
-			&viewportState,								// pViewportState
-			&rasterizer,								// pRasterizationState
-			&multisampling,								// pMultisampleState
-			&depthStencil,								// pDepthStencilState
-			&colorBlending,								// pColorBlendState
-			nullptr,						// pDynamicState
-			pipelineLayout.get(),					// layout
-			renderPass.get()					// renderPass
+		vk::PipelineRenderingCreateInfoKHR renderingInfo(
+			0,
+			0,
+			nullptr,
+			shadowFormat
 		);
-		graphicsPipeline = device->createGraphicsPipelineUnique(nullptr, graphicsPipelineCreateInfo);
+		if (dynamicRendering)
+		{
+			shadowPipelineCreateInfo.pNext = &renderingInfo;
+		}
 
-		log::trace("Created graphics pipeline");
+		shadowPipeline = device->createGraphicsPipelineUnique(nullptr, shadowPipelineCreateInfo);
+
+		BENTO_LOG_TRACE("Created shadow pipeline");
 	}
 
 	void Renderer::createFramebuffers()
@@ -857,7 +1500,10 @@ namespace bento
 		for (auto const & view : swapChainImageViews)
 		{
 			// bundle image views for the framebuffer
-			std::array<vk::ImageView, 2> attachments = { view.get(), depthImageView.get() };
+			// when multisampling the swap chain image is only the resolve target
+			std::vector<vk::ImageView> attachments = colorImageView
+				? std::vector<vk::ImageView>{ colorImageView.get(), depthImageView.get(), view.get() }
+				: std::vector<vk::ImageView>{ view.get(), depthImageView.get() };
 
 			vk::FramebufferCreateInfo framebufferInfo(
 				vk::FramebufferCreateFlags(),
@@ -872,7 +1518,7 @@ namespace bento
 			swapChainFramebuffers.push_back(device->createFramebufferUnique(framebufferInfo));
 		}
 
-		log::trace("Created frame buffers");
+		BENTO_LOG_TRACE("Created frame buffers");
 	}
 
 	void Renderer::createCommandPool()
@@ -885,111 +1531,132 @@ namespace bento
 			vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queueFamilyIndices.graphicsFamily.value()));
 
 		context.commandPool = commandPool.get();
-		log::trace("Created command pool");
+		BENTO_LOG_TRACE("Created command pool");
 	}
 
-	void Renderer::createDepthResources()
+	void Renderer::createTimestampQueryPool()
 	{
-		// get the depth image format
-		vk::Format depthFormat = VulkanUtils::findDepthFormat(physicalDevice);
+		// gpu frame times come from a pair of timestamps around each command buffer
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+		const auto queueFamilyProperties = physicalDevice.getQueueFamilyProperties();
 
-		// create the depth image
-		depthImage = VulkanUtils::createImage(
-			allocator,
-			device.get(),
-			physicalDevice,
-			swapChainExtent.width,
-			swapChainExtent.height,
-			depthFormat,
-			vk::ImageTiling::eOptimal,
-			vk::ImageUsageFlagBits::eDepthStencilAttachment,
-			vk::MemoryPropertyFlagBits::eDeviceLocal
-		);
+		timestampsSupported = queueFamilyProperties[queueFamilyIndices.graphicsFamily.value()].timestampValidBits > 0;
+		if (!timestampsSupported)
+		{
+			BENTO_LOG_WARN("Graphics queue has no timestamp support; gpu times will be unavailable");
+			return;
+		}
 
-		// create the depth image view
-		depthImageView = VulkanUtils::createImageView(device.get(), depthImage.image.get(), depthFormat, vk::ImageAspectFlagBits::eDepth);
+		vk::PhysicalDeviceProperties properties;
+		physicalDevice.getProperties(&properties);
+		timestampPeriod = properties.limits.timestampPeriod;
 
-		log::trace("Created depth resources");
+		timestampQueryPool = device->createQueryPoolUnique(vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp, MAX_TIMESTAMP_QUERIES));
+		submittedImages.assign(MAX_FRAMES_IN_FLIGHT, std::nullopt);
+		submittedAt.assign(MAX_FRAMES_IN_FLIGHT, 0);
+
+		BENTO_LOG_TRACE("Created timestamp query pool");
 	}
 
-	void Renderer::createTextureImage()
+	void Renderer::readGpuTime(size_t frame)
 	{
-		// retrieve image pixels with stbi
-		int texWidth, texHeight, texChannels;
-		stbi_uc* pixels = stbi_load("textures/texture.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		if (!timestampsSupported || !submittedImages[frame])
+		{
+			return;
+		}
+
+		// the frame's fence has signalled, but another frame may have resubmitted the same command buffer since;
+		// don't wait, just skip this sample if the queries aren't available
+		const uint32_t firstQuery = *submittedImages[frame] * TIMESTAMPS_PER_FRAME;
+		std::array<uint64_t, TIMESTAMPS_PER_FRAME> timestamps;
+		vk::Result result = device->getQueryPoolResults(
+			timestampQueryPool.get(),
+			firstQuery,
+			TIMESTAMPS_PER_FRAME,
+			sizeof(timestamps),
+			timestamps.data(),
+			sizeof(uint64_t),
+			vk::QueryResultFlagBits::e64
+		);
+
+		if (result == vk::Result::eSuccess)
+		{
+			auto toNanoseconds = [&](uint32_t timestamp)
+			{
+				return static_cast<int64_t>(static_cast<double>(timestamps[timestamp] - timestamps[FRAME_BEGIN_TIMESTAMP]) * timestampPeriod);
+			};
+
+			frameStats.gpuTime = static_cast<double>(toNanoseconds(FRAME_END_TIMESTAMP)) / 1000000.0;
+
+			// gpu and cpu clocks aren't related, so gpu zones are placed on the cpu timeline as if the frame started executing when it was submitted
+			const int64_t submitted = submittedAt[frame];
+			profiler::recordGpu("gpu frame", submitted, submitted + toNanoseconds(FRAME_END_TIMESTAMP));
+			profiler::recordGpu("main pass", submitted + toNanoseconds(MAIN_PASS_BEGIN_TIMESTAMP), submitted + toNanoseconds(MAIN_PASS_END_TIMESTAMP));
+			if (headless)
+			{
+				profiler::recordGpu("readback copy", submitted + toNanoseconds(MAIN_PASS_END_TIMESTAMP), submitted + toNanoseconds(FRAME_END_TIMESTAMP));
+			}
+		}
 
-		// calculate image size (x4 for the rgba)
-		vk::DeviceSize imageSize = texWidth * texHeight * 4;
+		submittedImages[frame].reset();
+	}
 
-		if (!pixels) {
-			throw std::runtime_error("failed to load texture image!");
+	void Renderer::createColorResources()
+	{
+		// without multisampling the scene is drawn straight into the swap chain image
+		if (msaaSamples == vk::SampleCountFlagBits::e1)
+		{
+			return;
 		}
 
-		// create a staging buffer for the image pixels so we can then transfer
-		stagingBuffer = VulkanUtils::createBuffer(
+		colorImage = VulkanUtils::createImage(
+			allocator,
 			device.get(),
-			imageSize,
 			physicalDevice,
-			vk::BufferUsageFlagBits::eTransferSrc,
-			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+			swapChainExtent.width,
+			swapChainExtent.height,
+			swapChainImageFormat,
+			vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransientAttachment,
+			transientMemory,
+			msaaSamples
 		);
 
-		// copy the pixel data to the staging buffer
-		void* data = device->mapMemory(stagingBuffer.memory.get(), 0, imageSize, {});
-		memcpy(data, pixels, static_cast<size_t>(imageSize));
-		device->unmapMemory(stagingBuffer.memory.get());
+		colorImageView = VulkanUtils::createImageView(device.get(), colorImage.image.get(), swapChainImageFormat, vk::ImageAspectFlagBits::eColor);
+
+		BENTO_LOG_TRACE("Created color resources");
+	}
 
-		// free image pixel memory
-		stbi_image_free(pixels);
+	void Renderer::createDepthResources()
+	{
+		// get the depth image format
+		depthFormat = VulkanUtils::findDepthFormat(physicalDevice);
 
-		// create the image
-		textureImage = VulkanUtils::createImage(
+		// create the depth image
+		depthImage = VulkanUtils::createImage(
 			allocator,
 			device.get(),
 			physicalDevice,
-			texWidth,
-			texHeight,
-			vk::Format::eR8G8B8A8Srgb,
+			swapChainExtent.width,
+			swapChainExtent.height,
+			depthFormat,
 			vk::ImageTiling::eOptimal,
-			vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-			vk::MemoryPropertyFlagBits::eDeviceLocal
-		);
-
-		// prepare the image to be copied (using transfer destination optimal)
-		VulkanUtils::transitionImageLayout(
-			device.get(), commandPool.get(), graphicsQueue,
-			textureImage.image.get(),
-			vk::Format::eR8G8B8A8Srgb,
-			vk::ImageLayout::eUndefined,
-			vk::ImageLayout::eTransferDstOptimal
-		);
-
-		// copy staging buffer contents to image
-		VulkanUtils::copyBufferToImage(
-			device.get(), commandPool.get(), graphicsQueue,
-			stagingBuffer.buffer.get(),
-			textureImage.image.get(),
-			texWidth,
-			texHeight
+			vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransientAttachment,
+			transientMemory,
+			msaaSamples
 		);
 
-		// transition layout to prepare for shader access
-		VulkanUtils::transitionImageLayout(
-			device.get(), commandPool.get(), graphicsQueue,
-			textureImage.image.get(),
-			vk::Format::eR8G8B8A8Srgb,
-			vk::ImageLayout::eTransferDstOptimal,
-			vk::ImageLayout::eShaderReadOnlyOptimal
-		);
+		// create the depth image view
+		depthImageView = VulkanUtils::createImageView(device.get(), depthImage.image.get(), depthFormat, vk::ImageAspectFlagBits::eDepth);
 
-		log::trace("Created texture image");
+		BENTO_LOG_TRACE("Created depth resources");
 	}
 
-	void Renderer::createTextureImageView()
+	void Renderer::createTextureImage()
 	{
-		textureImageView = VulkanUtils::createImageView(device.get(), textureImage.image.get(), vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor);
+		texture = assets.loadTexture("textures/texture.jpg");
 
-		log::trace("Created texture image view");
+		BENTO_LOG_TRACE("Created texture image");
 	}
 
 	void Renderer::createTextureSampler()
@@ -1014,7 +1681,7 @@ namespace bento
 			vk::SamplerAddressMode::eRepeat,
 			vk::SamplerAddressMode::eRepeat,
 			0.0f,
-			true, 16.0f,
+			anisotropySupported, 16.0f,
 			false, vk::CompareOp::eAlways,
 			0.0f, 0.0f,
 			vk::BorderColor::eIntOpaqueBlack,
@@ -1023,7 +1690,7 @@ namespace bento
 
 		textureSampler = device->createSamplerUnique(samplerInfo);
 
-		log::trace("Created texture sampler");
+		BENTO_LOG_TRACE("Created texture sampler");
 	}
 
 	void Renderer::createVertexBuffer()
@@ -1057,12 +1724,13 @@ namespace bento
 		VulkanUtils::copyBuffer(
 			device.get(),
 			commandPool.get(),
-			graphicsQueue,
+			timeline,
 			stagingBufferData.buffer.get(),
 			vertexBufferData.buffer.get(), bufferSize
 		);
+		timeline.retire(std::move(stagingBufferData));
 
-		log::trace("Created vertex buffer");
+		BENTO_LOG_TRACE("Created vertex buffer");
 	}
 
 	void Renderer::createIndexBuffer()
@@ -1096,12 +1764,13 @@ namespace bento
 		VulkanUtils::copyBuffer(
 			device.get(),
 			commandPool.get(),
-			graphicsQueue,
+			timeline,
 			stagingBufferData.buffer.get(),
 			indexBufferData.buffer.get(), bufferSize
 		);
+		timeline.retire(std::move(stagingBufferData));
 
-		log::trace("Created index buffer");
+		BENTO_LOG_TRACE("Created index buffer");
 	}
 
 	void Renderer::createUniformBuffers()
@@ -1119,59 +1788,269 @@ namespace bento
 			);
 		}
 
-		vk::DeviceSize transformBufferSize = sizeof(ObjectUBO);
-		transformationBufferData.resize(swapChainImages.size());
+		BENTO_LOG_TRACE("Created uniform buffers");
+	}
 
-		for (size_t i = 0; i < swapChainImages.size(); i++) {
-			transformationBufferData[i] = VulkanUtils::createBuffer(
+	void Renderer::createInstanceBuffers()
+	{
+		// instance data is rewritten every frame, so keep it host visible and mapped instead of staging it
+		// the main and shadow passes read it as a storage buffer, indexed through the draw index buffer
+		vk::DeviceSize instanceBufferSize = sizeof(glm::mat4) * MAX_INSTANCES;
+		instanceBufferData.resize(MAX_FRAMES_IN_FLIGHT);
+
+		for (auto& instanceBuffer : instanceBufferData)
+		{
+			instanceBuffer = VulkanUtils::createBuffer(
 				device.get(),
-				transformBufferSize,
+				instanceBufferSize,
 				physicalDevice,
-				vk::BufferUsageFlagBits::eUniformBuffer,
+				vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
 				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
 			);
+			instanceBuffer.map();
 		}
 
-		log::trace("Created uniform buffers");
+		// rewritten every frame like the instances
+		drawIndexBufferData.resize(MAX_FRAMES_IN_FLIGHT);
+		for (auto& drawIndexBuffer : drawIndexBufferData)
+		{
+			drawIndexBuffer = VulkanUtils::createBuffer(
+				device.get(),
+				sizeof(uint32_t) * (SHADOW_DRAW_INDICES + MAX_INSTANCES),
+				physicalDevice,
+				vk::BufferUsageFlagBits::eStorageBuffer,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+			);
+			drawIndexBuffer.map();
+		}
+
+		BENTO_LOG_TRACE("Created instance buffers");
 	}
 
-	void Renderer::createDescriptorPool()
+	void Renderer::createLightBuffers()
 	{
-		// set pool sizes for each descriptor
-		std::array<vk::DescriptorPoolSize, 2> poolSizes = {
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, swapChainImages.size()),
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, swapChainImages.size()),
-			//vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, swapChainImages.size())
-		};
-		log::warn("Arbitrarily changing set count for descriptor pool");
-		vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, swapChainImages.size() * 10, 1, poolSizes.data());
+		const uint32_t clusterCount = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
 
-		descriptorPool = device->createDescriptorPoolUnique(poolInfo);
+		lightBufferData.resize(swapChainImages.size());
+		lightGridBufferData.resize(swapChainImages.size());
+		lightIndexBufferData.resize(swapChainImages.size());
 
-		//context.descriptorPool = descriptorPool.get();
-		log::trace("Created descriptor pool");
+		for (size_t i = 0; i < swapChainImages.size(); i++)
+		{
+			// rewritten every frame like the instances
+			lightBufferData[i] = VulkanUtils::createBuffer(
+				device.get(),
+				sizeof(Light) * MAX_LIGHTS,
+				physicalDevice,
+				vk::BufferUsageFlagBits::eStorageBuffer,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+			);
+			lightBufferData[i].map();
+
+			// only ever touched by the gpu
+			lightGridBufferData[i] = VulkanUtils::createBuffer(
+				device.get(),
+				sizeof(uint32_t) * clusterCount,
+				physicalDevice,
+				vk::BufferUsageFlagBits::eStorageBuffer,
+				vk::MemoryPropertyFlagBits::eDeviceLocal
+			);
+			lightIndexBufferData[i] = VulkanUtils::createBuffer(
+				device.get(),
+				sizeof(uint32_t) * clusterCount * MAX_LIGHTS_PER_CLUSTER,
+				physicalDevice,
+				vk::BufferUsageFlagBits::eStorageBuffer,
+				vk::MemoryPropertyFlagBits::eDeviceLocal
+			);
+		}
+
+		BENTO_LOG_TRACE("Created light buffers");
 	}
 
-	void Renderer::createObjectDescriptorPool()
+	void Renderer::createShadowResources()
 	{
-		// set pool sizes for each descriptor
-		std::array<vk::DescriptorPoolSize, 2> poolSizes = {
-			//vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, swapChainImages.size()),
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, swapChainImages.size()),
-			vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, swapChainImages.size())
-		};
-		log::warn("Arbitrarily changing set count for descriptor pool");
-		vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, swapChainImages.size() * 10, 1, poolSizes.data());
+		// the static layers are only drawn and copied from; the sampled map is copied into, drawn over and sampled
+		staticShadowImage = VulkanUtils::createImage(
+			allocator,
+			device.get(),
+			physicalDevice,
+			SHADOW_MAP_SIZE,
+			SHADOW_MAP_SIZE,
+			shadowFormat,
+			vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			vk::SampleCountFlagBits::e1,
+			SHADOW_CASCADES
+		);
+		shadowImage = VulkanUtils::createImage(
+			allocator,
+			device.get(),
+			physicalDevice,
+			SHADOW_MAP_SIZE,
+			SHADOW_MAP_SIZE,
+			shadowFormat,
+			vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			vk::SampleCountFlagBits::e1,
+			SHADOW_CASCADES
+		);
+
+		// cascades are drawn one layer at a time and sampled as an array
+		for (uint32_t layer = 0; layer < SHADOW_CASCADES; layer++)
+		{
+			staticShadowLayerViews.push_back(VulkanUtils::createImageView(device.get(), staticShadowImage.image.get(), shadowFormat, vk::ImageAspectFlagBits::eDepth, vk::ImageViewType::e2D, layer, 1));
+			shadowLayerViews.push_back(VulkanUtils::createImageView(device.get(), shadowImage.image.get(), shadowFormat, vk::ImageAspectFlagBits::eDepth, vk::ImageViewType::e2D, layer, 1));
+		}
+		shadowArrayView = VulkanUtils::createImageView(device.get(), shadowImage.image.get(), shadowFormat, vk::ImageAspectFlagBits::eDepth, vk::ImageViewType::e2DArray, 0, SHADOW_CASCADES);
+
+		// compares instead of returning depth; with linear filtering the hardware blends the results of neighbouring texels
+		// anything outside a cascade is lit
+		vk::SamplerCreateInfo samplerInfo(
+			{},
+			vk::Filter::eLinear,
+			vk::Filter::eLinear,
+			vk::SamplerMipmapMode::eNearest,
+			vk::SamplerAddressMode::eClampToBorder,
+			vk::SamplerAddressMode::eClampToBorder,
+			vk::SamplerAddressMode::eClampToBorder,
+			0.0f,
+			false,
+			1.0f,
+			true,
+			vk::CompareOp::eLessOrEqual,
+			0.0f,
+			0.0f,
+			vk::BorderColor::eFloatOpaqueWhite,
+			false
+		);
+		shadowSampler = device->createSamplerUnique(samplerInfo);
+
+		if (!dynamicRendering)
+		{
+			const vk::Extent2D extent(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+			for (uint32_t layer = 0; layer < SHADOW_CASCADES; layer++)
+			{
+				vk::FramebufferCreateInfo staticFramebufferInfo({}, shadowClearRenderPass.get(), 1, &staticShadowLayerViews[layer].get(), extent.width, extent.height, 1);
+				staticShadowFramebuffers.push_back(device->createFramebufferUnique(staticFramebufferInfo));
+
+				vk::FramebufferCreateInfo framebufferInfo({}, shadowLoadRenderPass.get(), 1, &shadowLayerViews[layer].get(), extent.width, extent.height, 1);
+				shadowFramebuffers.push_back(device->createFramebufferUnique(framebufferInfo));
+			}
+		}
+
+		// the images start out in the layouts every frame leaves them in. what they hold doesn't matter: the static layers start out stale,
+		// and the map is only sampled once there is a directional light, which rebuilds it first
+		vk::CommandBuffer commandBuffer = VulkanUtils::beginSingleTimeCommands(device.get(), commandPool.get());
+		attachmentBarrier(
+			commandBuffer,
+			staticShadowImage.image.get(),
+			vk::ImageAspectFlagBits::eDepth,
+			vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eTransferSrcOptimal,
+			vk::PipelineStageFlagBits::eTopOfPipe,
+			vk::AccessFlags(),
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::AccessFlags(),
+			SHADOW_CASCADES
+		);
+		attachmentBarrier(
+			commandBuffer,
+			shadowImage.image.get(),
+			vk::ImageAspectFlagBits::eDepth,
+			vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eShaderReadOnlyOptimal,
+			vk::PipelineStageFlagBits::eTopOfPipe,
+			vk::AccessFlags(),
+			vk::PipelineStageFlagBits::eFragmentShader,
+			vk::AccessFlags(),
+			SHADOW_CASCADES
+		);
+		VulkanUtils::endSingleTimeCommands(commandBuffer, device.get(), commandPool.get(), timeline);
 
-		objectDescriptorPool = device->createDescriptorPoolUnique(poolInfo);
+		BENTO_LOG_TRACE("Created shadow resources");
+	}
+
+	void Renderer::createReadbackBuffers()
+	{
+		// allocated once and reused every frame so reading frames back never allocates
+		vk::DeviceSize readbackBufferSize = static_cast<vk::DeviceSize>(headlessExtent.width) * headlessExtent.height * 4;
+		readbackBufferData.resize(MAX_FRAMES_IN_FLIGHT);
+		readbackFrames.assign(MAX_FRAMES_IN_FLIGHT, std::nullopt);
 
-		context.descriptorPool = objectDescriptorPool.get();
-		log::trace("Created object descriptor pool");
+		for (auto& readbackBuffer : readbackBufferData)
+		{
+			readbackBuffer = VulkanUtils::createBuffer(
+				device.get(),
+				readbackBufferSize,
+				physicalDevice,
+				vk::BufferUsageFlagBits::eTransferDst,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+			);
+			readbackBuffer.map();
+		}
+
+		BENTO_LOG_TRACE("Created readback buffers");
+	}
+
+	glm::mat4* Renderer::beginInstances(uint32_t& capacity)
+	{
+		capacity = MAX_INSTANCES;
+		return packing->instances.data();
+	}
+
+	MeshDraw* Renderer::beginDraws(uint32_t& capacity)
+	{
+		capacity = MAX_INSTANCES;
+		return packing->draws.data();
+	}
+
+	Light* Renderer::beginLights(uint32_t& capacity)
+	{
+		capacity = MAX_LIGHTS;
+		return packing->lights.data();
+	}
+
+	void Renderer::uploadInstances(const RenderPacket& packet)
+	{
+		// the frame's fence has been waited on, so its buffer is no longer being read
+		instanceCount = std::min(packet.instanceCount, MAX_INSTANCES);
+		memcpy(instanceBufferData[currentFrame].mapped, packet.instances.data(), sizeof(glm::mat4) * instanceCount);
+	}
+
+	void Renderer::uploadLights(uint32_t currentImage, const RenderPacket& packet)
+	{
+		// the image's last frame has finished, so neither the culling pass nor the fragment shader is still reading its lights
+		const uint32_t lightCount = std::min(packet.lightCount, MAX_LIGHTS);
+		memcpy(lightBufferData[currentImage].mapped, packet.lights.data(), sizeof(Light) * lightCount);
+	}
+
+	void Renderer::createDescriptorPool()
+	{
+		// set pool sizes for each descriptor
+		std::array<vk::DescriptorPoolSize, 3> poolSizes = {
+			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, swapChainImages.size()),
+			//vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, swapChainImages.size())
+			// lights, light grid and light indices
+			vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, swapChainImages.size() * 3),
+			// texture and shadow map
+			vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, swapChainImages.size() * 2)
+		};
+		BENTO_LOG_WARN("Arbitrarily changing set count for descriptor pool");
+		vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, swapChainImages.size() * 10, poolSizes.size(), poolSizes.data());
+
+		descriptorPool = device->createDescriptorPoolUnique(poolInfo);
+
+		//context.descriptorPool = descriptorPool.get();
+		BENTO_LOG_TRACE("Created descriptor pool");
 	}
 
 	void Renderer::createDescriptorSets()
 	{
-		std::vector<vk::DescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout.get());
+		// only needed for the allocate call
+		arenaScope scratch(memory::threadArena());
+		const arenaVector<vk::DescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout.get(), memory::threadArena());
 
 		vk::DescriptorSetAllocateInfo allocateInfo(descriptorPool.get(), swapChainImages.size(), layouts.data());
 
@@ -1181,10 +2060,13 @@ namespace bento
 		// populate descriptors
 		for (size_t i = 0; i < swapChainImages.size(); i++) {
 			vk::DescriptorBufferInfo uniformBufferInfo(uniformBufferData[i].buffer.get(), 0, sizeof(GlobalUBO));
-			//vk::DescriptorBufferInfo modelMatInfo(transformationBufferData[i].buffer.get(), 0, sizeof(ObjectUBO));
-			//vk::DescriptorImageInfo imageInfo(textureSampler.get(), textureImageView.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
+			vk::DescriptorBufferInfo lightsInfo(lightBufferData[i].buffer.get(), 0, VK_WHOLE_SIZE);
+			vk::DescriptorBufferInfo lightGridInfo(lightGridBufferData[i].buffer.get(), 0, VK_WHOLE_SIZE);
+			vk::DescriptorBufferInfo lightIndicesInfo(lightIndexBufferData[i].buffer.get(), 0, VK_WHOLE_SIZE);
+			vk::DescriptorImageInfo shadowMapInfo(shadowSampler.get(), shadowArrayView.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
+			vk::DescriptorImageInfo imageInfo(textureSampler.get(), texture->view.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
 
-			std::array<vk::WriteDescriptorSet, 1> descriptorWrites = {
+			std::array<vk::WriteDescriptorSet, 6> descriptorWrites = {
 				vk::WriteDescriptorSet(
 					descriptorSets[i].get(),
 					0,
@@ -1194,17 +2076,11 @@ namespace bento
 					nullptr,
 					&uniformBufferInfo,
 					nullptr
-				)/*,
-				vk::WriteDescriptorSet(
-					descriptorSets[i].get(),
-					1,
-					0,
-					1,
-					vk::DescriptorType::eUniformBuffer,
-					nullptr,
-					&modelMatInfo,
-					nullptr
 				),
+				vk::WriteDescriptorSet(descriptorSets[i].get(), 3, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &lightsInfo, nullptr),
+				vk::WriteDescriptorSet(descriptorSets[i].get(), 4, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &lightGridInfo, nullptr),
+				vk::WriteDescriptorSet(descriptorSets[i].get(), 5, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &lightIndicesInfo, nullptr),
+				vk::WriteDescriptorSet(descriptorSets[i].get(), 6, 0, 1, vk::DescriptorType::eCombinedImageSampler, &shadowMapInfo, nullptr, nullptr),
 				vk::WriteDescriptorSet(
 					descriptorSets[i].get(),
 					2,
@@ -1214,83 +2090,48 @@ namespace bento
 					&imageInfo,
 					nullptr,
 					nullptr
-				)*/
+				)
 			};
 
 			device->updateDescriptorSets(descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
 		}
 
-		log::trace("Created descriptor set");
-	}
-
-	//void Renderer::createObjectDescriptorSets()
-	//{
-	//	/*{
-	//		std::vector<vk::DescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout.get());
-
-	//		vk::DescriptorSetAllocateInfo allocateInfo(descriptorPool.get(), swapChainImages.size(), layouts.data());
-
-	//		descriptorSets.resize(swapChainImages.size());
-	//		descriptorSets = device->allocateDescriptorSetsUnique(allocateInfo);
-	//	}*/
-
-	//	{
-	//		std::vector<vk::DescriptorSetLayout> layouts(swapChainImages.size(), objectDescriptorSetLayout.get());
-
-	//		vk::DescriptorSetAllocateInfo allocateInfo(objectDescriptorPool.get(), swapChainImages.size(), layouts.data());
-
-	//		objectDescriptorSets.resize(swapChainImages.size());
-	//		objectDescriptorSets = device->allocateDescriptorSetsUnique(allocateInfo);
-	//	}
-
-	//	// populate descriptors
-	//	for (size_t i = 0; i < swapChainImages.size(); i++) {
-	//		//vk::DescriptorBufferInfo uniformBufferInfo(uniformBufferData[i].buffer.get(), 0, sizeof(GlobalUBO));
-	//		vk::DescriptorBufferInfo modelMatInfo(transformationBufferData[i].buffer.get(), 0, sizeof(ObjectUBO));
-	//		vk::DescriptorImageInfo imageInfo(textureSampler.get(), textureImageView.get(), vk::ImageLayout::eShaderReadOnlyOptimal);
-
-	//		std::array<vk::WriteDescriptorSet, 2> descriptorWrites = {
-	//			/*vk::WriteDescriptorSet(
-	//				descriptorSets[i].get(),
-	//				0,
-	//				0,
-	//				1,
-	//				vk::DescriptorType::eUniformBuffer,
-	//				nullptr,
-	//				&uniformBufferInfo,
-	//				nullptr
-	//			),*/
-	//			vk::WriteDescriptorSet(
-	//				objectDescriptorSets[i].get(),
-	//				0,
-	//				0,
-	//				1,
-	//				vk::DescriptorType::eUniformBuffer,
-	//				nullptr,
-	//				&modelMatInfo,
-	//				nullptr
-	//			),
-	//			vk::WriteDescriptorSet(
-	//				objectDescriptorSets[i].get(),
-	//				1,
-	//				0,
-	//				1,
-	//				vk::DescriptorType::eCombinedImageSampler,
-	//				&imageInfo,
-	//				nullptr,
-	//				nullptr
-	//			)
-	//		};
-
-	//		device->updateDescriptorSets(descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
-	//	}
-
-	//	log::trace("Created object descriptor set");
-	//}
+		BENTO_LOG_TRACE("Created descriptor set");
+	}
+
+	void Renderer::createInstanceDescriptorSets()
+	{
+		std::array<vk::DescriptorPoolSize, 1> poolSizes = {
+			// instances and draw indices
+			vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, MAX_FRAMES_IN_FLIGHT * 2)
+		};
+		vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, MAX_FRAMES_IN_FLIGHT, poolSizes.size(), poolSizes.data());
+		instanceDescriptorPool = device->createDescriptorPoolUnique(poolInfo);
+
+		std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, instanceDescriptorSetLayout.get());
+		vk::DescriptorSetAllocateInfo allocateInfo(instanceDescriptorPool.get(), layouts.size(), layouts.data());
+		instanceDescriptorSets = device->allocateDescriptorSetsUnique(allocateInfo);
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			vk::DescriptorBufferInfo instancesInfo(instanceBufferData[i].buffer.get(), 0, VK_WHOLE_SIZE);
+			vk::DescriptorBufferInfo drawIndicesInfo(drawIndexBufferData[i].buffer.get(), 0, VK_WHOLE_SIZE);
+
+			std::array<vk::WriteDescriptorSet, 2> descriptorWrites = {
+				vk::WriteDescriptorSet(instanceDescriptorSets[i].get(), 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &instancesInfo, nullptr),
+				vk::WriteDescriptorSet(instanceDescriptorSets[i].get(), 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &drawIndicesInfo, nullptr)
+			};
+
+			device->updateDescriptorSets(descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+		}
+
+		BENTO_LOG_TRACE("Created instance descriptor sets");
+	}
 
 	void Renderer::allocateCommandBuffers()
 	{
-		commandBuffers.resize(swapChainFramebuffers.size());
+		// one per image; there are no framebuffers to count with dynamic rendering
+		commandBuffers.resize(swapChainImages.size());
 
 		// create command buffers
 		vk::CommandBufferAllocateInfo allocateInfo(
@@ -1299,175 +2140,878 @@ namespace bento
 			commandBuffers.size()
 		);
 		commandBuffers = device->allocateCommandBuffersUnique(allocateInfo);
+		recordedStats.assign(commandBuffers.size(), FrameStats());
 	}
 
-	void Renderer::createCommandBuffers()
+	void Renderer::recordCommandBuffer(uint32_t image, const RenderPacket& packet)
 	{
-		//commandBuffers.resize(swapChainFramebuffers.size());
+		BENTO_PROFILE_FUNCTION();
 
-		//// create command buffers
-		//vk::CommandBufferAllocateInfo allocateInfo(
-		//	commandPool.get(),
-		//	vk::CommandBufferLevel::ePrimary,
-		//	commandBuffers.size()
-		//);
-		//commandBuffers = device->allocateCommandBuffersUnique(allocateInfo);
+		// the scene moves every frame, so the main pass is recorded every frame; the draws are sorted first
+		recordedStats[image] = FrameStats();
+		recordingPacket = &packet;
+		recordedDrawIndices = 0;
+		sortDraws(packet);
 
-		// start recording commands for each command buffer
-		for (size_t i = 0; i < commandBuffers.size(); i++) {
-			// none of the begin info flags are applicable for us right now
-			vk::CommandBufferBeginInfo beginInfo(
-				{},
-				nullptr
-			);
+		const vk::CommandBuffer commandBuffer = commandBuffers[image].get();
+		commandBuffer.reset(vk::CommandBufferResetFlags());
+		commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+		if (timestampsSupported && (image + 1) * TIMESTAMPS_PER_FRAME <= MAX_TIMESTAMP_QUERIES)
+		{
+			commandBuffer.resetQueryPool(timestampQueryPool.get(), image * TIMESTAMPS_PER_FRAME, TIMESTAMPS_PER_FRAME);
+		}
+		writeTimestamp(commandBuffer, image, FRAME_BEGIN_TIMESTAMP, vk::PipelineStageFlagBits::eTopOfPipe);
 
-			commandBuffers[i]->begin(beginInfo);
+		if (dynamicRendering)
+		{
+			// the graph places the barriers and begins rendering itself
+			frameGraph.bindImage(frameGraphTarget, swapChainImages[image], swapChainImageViews[image].get());
+			frameGraph.record(commandBuffer, image);
+		}
+		else
+		{
+			recordLightCulling(commandBuffer, image);
 
-			// configure render pass; include the pass itself and the attachments to bind
-			//renderPassInfo.renderArea.offset = vk::Offset2D(0, 0);
-			//renderPassInfo.renderArea.extent = swapChainExtent;
+			writeTimestamp(commandBuffer, image, MAIN_PASS_BEGIN_TIMESTAMP, vk::PipelineStageFlagBits::eTopOfPipe);
 
-			// include clear values for the color and depth image
-			std::array<vk::ClearValue, 2> clearValues = {
-				vk::ClearValue(vk::ClearColorValue(std::array<uint32_t, 4>{0, 0, 0, 1})),
-				vk::ClearValue(vk::ClearDepthStencilValue(1.0f, 0))
-			};
+			beginMainPass(commandBuffer, image);
+			recordScene(commandBuffer, image);
+			commandBuffer.endRenderPass();
 
-			//renderPassInfo.clearValueCount = clearValues.size();
-			//renderPassInfo.pClearValues = clearValues.data();
+			writeTimestamp(commandBuffer, image, MAIN_PASS_END_TIMESTAMP, vk::PipelineStageFlagBits::eBottomOfPipe);
 
-			if (swapChainFramebuffers[i].get() == nullptr)
+			// headless frames are copied into their readback buffer as part of the same submission
+			if (headless)
 			{
-				std::cerr << "framebuffer is null!" << std::endl;
+				recordReadback(commandBuffer, image);
 			}
+		}
 
-			vk::RenderPassBeginInfo renderPassInfo(
-				renderPass.get(),
-				swapChainFramebuffers[i].get(),
-				vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent),
-				clearValues.size(),
-				clearValues.data()
-			);
+		writeTimestamp(commandBuffer, image, FRAME_END_TIMESTAMP, vk::PipelineStageFlagBits::eBottomOfPipe);
+
+		// finish recording
+		commandBuffer.end();
+		recordingPacket = nullptr;
+	}
+
+	void Renderer::createFrameGraph()
+	{
+		frameGraph.initialize(device.get(), allocator, cmdBeginRendering, cmdEndRendering);
+
+		// headless images are only copied out; on screen the ui is drawn on top afterwards, which also hands the image over for presenting
+		frameGraphTarget = headless
+			? frameGraph.importImage("offscreen", swapChainImageFormat, swapChainExtent, vk::ImageLayout::eTransferSrcOptimal,
+			                         vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead)
+			: frameGraph.importImage("swap chain", swapChainImageFormat, swapChainExtent, vk::ImageLayout::eColorAttachmentOptimal,
+			                         vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite);
+
+		depthFormat = VulkanUtils::findDepthFormat(physicalDevice);
+		const RenderGraph::Image depth = frameGraph.createImage("depth", depthFormat, swapChainExtent, msaaSamples);
+
+		// when multisampling the scene is drawn into a transient image and resolved into the target at the end of the pass
+		const bool multisampled = msaaSamples != vk::SampleCountFlagBits::e1;
+		const RenderGraph::Image target = frameGraphTarget;
+		const RenderGraph::Image color = multisampled ? frameGraph.createImage("color", swapChainImageFormat, swapChainExtent, msaaSamples) : target;
+
+		frameGraph.addPass("light culling", [&](RenderGraph::PassBuilder& pass)
+		{
+			// the light grid is a buffer, which the graph doesn't track
+			pass.sideEffect();
+		},
+		[this](vk::CommandBuffer commandBuffer, uint32_t image)
+		{
+			recordLightCulling(commandBuffer, image);
+		});
+
+		frameGraph.addPass("main", [&](RenderGraph::PassBuilder& pass)
+		{
+			const vk::ClearColorValue clear(std::array<uint32_t, 4>{0, 0, 0, 1});
+			if (multisampled)
+			{
+				pass.writeColor(color, clear, target);
+			}
+			else
+			{
+				pass.writeColor(target, clear);
+			}
+			pass.writeDepth(depth, vk::ClearDepthStencilValue(1.0f, 0));
+		},
+		[this](vk::CommandBuffer commandBuffer, uint32_t image)
+		{
+			writeTimestamp(commandBuffer, image, MAIN_PASS_BEGIN_TIMESTAMP, vk::PipelineStageFlagBits::eTopOfPipe);
+			recordScene(commandBuffer, image);
+			writeTimestamp(commandBuffer, image, MAIN_PASS_END_TIMESTAMP, vk::PipelineStageFlagBits::eBottomOfPipe);
+		});
 
-			// begin the render pass
-			commandBuffers[i]->beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+		if (headless)
+		{
+			frameGraph.addPass("readback", [&](RenderGraph::PassBuilder& pass)
+			{
+				pass.copyFrom(target);
+				// the readback buffer is outside the graph
+				pass.sideEffect();
+			},
+			[this](vk::CommandBuffer commandBuffer, uint32_t image)
+			{
+				recordReadback(commandBuffer, image);
+			});
+		}
+
+		frameGraph.compile();
+
+		BENTO_LOG_TRACE("Created frame graph");
+	}
+
+	void Renderer::beginMainPass(vk::CommandBuffer commandBuffer, size_t image)
+	{
+		// include clear values for the color and depth image
+		std::array<vk::ClearValue, 2> clearValues = {
+			vk::ClearValue(vk::ClearColorValue(std::array<uint32_t, 4>{0, 0, 0, 1})),
+			vk::ClearValue(vk::ClearDepthStencilValue(1.0f, 0))
+		};
+
+		if (swapChainFramebuffers[image].get() == nullptr)
+		{
+			BENTO_LOG_ERROR("Framebuffer {} is null", image);
+		}
 
-			// bind the graphics pipeline
-			commandBuffers[i]->bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline.get());
+		vk::RenderPassBeginInfo renderPassInfo(
+			renderPass.get(),
+			swapChainFramebuffers[image].get(),
+			vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent),
+			clearValues.size(),
+			clearValues.data()
+		);
+
+		commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+	}
 
-			// update imgui layer
-			//imGuiLayer.newFrame((currentFrame == 0));
-			//imGuiLayer.updateBuffers();
+	void Renderer::recordLightCulling(vk::CommandBuffer commandBuffer, size_t image)
+	{
+		const uint32_t clusterCount = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, lightCullingPipeline.get());
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, lightCullingPipelineLayout.get(), 0, descriptorSets[image].get(), nullptr);
+		commandBuffer.dispatch((clusterCount + LIGHT_CULLING_GROUP_SIZE - 1) / LIGHT_CULLING_GROUP_SIZE, 1, 1);
+
+		// the fragment shader reads the grid the dispatch wrote. the image's previous frame was waited on before its lights were uploaded,
+		// so there is nothing earlier to wait for
+		vk::MemoryBarrier barrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader, vk::DependencyFlags(), barrier, nullptr, nullptr);
+	}
 
-			for (size_t j = 0; j < meshFactory.count(); j++)
+	void Renderer::sortDraws(const RenderPacket& packet)
+	{
+		BENTO_PROFILE_FUNCTION();
+
+		// the vectors only grow, so once they have seen the largest frame sorting doesn't allocate
+		const glm::mat4 view = cameraView();
+		const uint32_t drawCount = std::min(packet.drawCount, MAX_INSTANCES);
+
+		opaqueDraws.clear();
+		depthDraws.clear();
+		blendedDraws.clear();
+		drawScratch.resize(drawCount);
+		drawMeshes.resize(drawCount);
+
+		for (uint32_t j = 0; j < drawCount; j++)
+		{
+			// draws of meshes that aren't loaded (or past the uploaded instances) are dropped
+			const MeshDraw& draw = packet.draws[j];
+			Mesh* mesh = draw.instance < instanceCount ? meshFactory.find(draw.mesh) : nullptr;
+			drawMeshes[j] = mesh;
+			if (!mesh)
 			{
-				std::cout << "adding mesh" << std::endl;
+				continue;
+			}
 
+			// the instance's translation is the last column of its world matrix
+			const float viewDepth = -(view * packet.instances[draw.instance][3]).z;
+			const uint32_t depth = DrawSort::quantizeDepth(viewDepth, cameraNear, cameraFar);
+
+			if (!mesh->getMaterial().isOpaque())
+			{
+				// back to front, so whatever is behind has been blended in before
+				blendedDraws.push_back({ DrawSort::depthKey((1u << DrawSort::DEPTH_BITS) - 1 - depth, j), j });
+				continue;
+			}
+
+			// the top byte of the material key stands in for a pipeline id; a collision only costs a redundant bind
+			// a single texture for now; the key already has room for more
+			// meshes sharing geometry sort next to each other (by its content hash) so its buffers are bound once for all of them
+			const uint32_t pipeline = static_cast<uint32_t>(mesh->getMaterial().key() >> (64 - DrawSort::PIPELINE_BITS));
+			const uint32_t geometry = static_cast<uint32_t>(mesh->getContentHash());
+			opaqueDraws.push_back({ DrawSort::opaqueKey(pipeline, 0, geometry, depth), j });
+			depthDraws.push_back({ DrawSort::depthKey(depth, j), j });
+		}
+
+		DrawSort::radixSort(opaqueDraws.data(), drawScratch.data(), opaqueDraws.size());
+		DrawSort::radixSort(depthDraws.data(), drawScratch.data(), depthDraws.size());
+		DrawSort::radixSort(blendedDraws.data(), drawScratch.data(), blendedDraws.size());
+	}
+
+	void Renderer::recordScene(vk::CommandBuffer commandBuffer, size_t image)
+	{
+		FrameStats& stats = recordedStats[image];
+
+		// describe the region of the framebuffer that the output will be rendered to (in our case, the whole window)
+		vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), 0.0f, 1.0f);
+		commandBuffer.setViewport(0, 1, &viewport);
+		vk::Rect2D scissor({ 0, 0 }, swapChainExtent);
+		commandBuffer.setScissor(0, 1, &scissor);
+
+		// every material shares the layout, so the global set and the frame's instances stay bound across pipeline switches
+		const std::array<vk::DescriptorSet, 2> sets = { descriptorSets[image].get(), instanceDescriptorSets[currentFrame].get() };
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 0, sets, nullptr);
+		stats.descriptorSetBinds += static_cast<uint32_t>(sets.size());
+
+		// there is only the one texture so far, so every draw samples material 0
+		DrawConstants constants{};
+		constants.material = 0;
+		commandBuffer.pushConstants(pipelineLayout.get(), vk::ShaderStageFlagBits::eFragment, 0, sizeof(DrawConstants), &constants);
+		stats.pushConstantUpdates++;
+
+		if (depthPrepass)
+		{
+			recordDraws(commandBuffer, image, depthDraws, true);
+		}
+
+		recordDraws(commandBuffer, image, opaqueDraws, false);
+		recordDraws(commandBuffer, image, blendedDraws, false);
+	}
+
+	vk::Pipeline Renderer::pipelineFor(const Material& material, bool prepass)
+	{
+		if (prepass)
+		{
+			return pipelineCache.get(material.depthOnly(), depthPrepassPipeline);
+		}
+
+		// surfaces the prepass laid down are shaded at exactly that depth; blended ones test against it as they are
+		if (depthPrepass && material.isOpaque())
+		{
+			return pipelineCache.get(material.depthEqual(), depthEqualPipeline);
+		}
+		return pipelineCache.get(material, graphicsPipeline);
+	}
+
+	void Renderer::recordDraws(vk::CommandBuffer commandBuffer, size_t image, const std::vector<DrawSort::Item>& draws, bool prepass)
+	{
+		FrameStats& stats = recordedStats[image];
+
+		// this frame's fence has been waited on, so its draw index buffer is free
+		uint32_t* drawIndices = static_cast<uint32_t*>(drawIndexBufferData[currentFrame].mapped);
+
+		vk::Pipeline boundPipeline;
+		const MeshGeometry* boundGeometry = nullptr;
+		for (size_t first = 0; first < draws.size();)
+		{
+			Mesh* mesh = drawMeshes[draws[first].index];
+			const vk::Pipeline pipeline = pipelineFor(mesh->getMaterial(), prepass);
+
+			// the run of draws sharing the geometry and pipeline is a single instanced draw; its entries in the draw index buffer say which instances
+			const uint32_t firstInstance = recordedDrawIndices;
+			size_t last = first;
+			for (; last < draws.size(); last++)
+			{
+				const Mesh* next = drawMeshes[draws[last].index];
+				if (next->getGeometry() != mesh->getGeometry() || pipelineFor(next->getMaterial(), prepass) != pipeline)
+				{
+					break;
+				}
+
+				drawIndices[recordedDrawIndices++] = recordingPacket->draws[draws[last].index].instance;
+			}
+
+			if (pipeline != boundPipeline)
+			{
+				commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+				stats.pipelineBinds++;
+				boundPipeline = pipeline;
+			}
+
+			if (mesh->getGeometry().get() != boundGeometry)
+			{
 				// bind vertex buffers
-				commandBuffers[i]->bindVertexBuffers(0, meshFactory.getMesh(j)->getVertexBufferData(), { 0 });
-				commandBuffers[i]->bindIndexBuffer(meshFactory.getMesh(j)->getIndexBufferData(), 0, vk::IndexType::eUint32);
+				commandBuffer.bindVertexBuffers(0, mesh->getVertexBufferData(), { 0 });
+				commandBuffer.bindIndexBuffer(mesh->getIndexBufferData(), 0, vk::IndexType::eUint32);
+				stats.vertexBufferBinds++;
+
+				boundGeometry = mesh->getGeometry().get();
+			}
 
-				// bind descriptor sets
-				std::array<vk::DescriptorSet, 2> bindDescriptorSets;
-				bindDescriptorSets[0] = descriptorSets[i].get();
-				bindDescriptorSets[1] = meshFactory.getMesh(j)->getDescriptorSet(i);
+			// the first instance offsets gl_InstanceIndex to the run's entries
+			commandBuffer.drawIndexed(mesh->getIndexCount(), static_cast<uint32_t>(last - first), 0, 0, firstInstance);
+			stats.drawCalls++;
 
-				commandBuffers[i]->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 0, bindDescriptorSets, nullptr);
+			first = last;
+		}
+	}
+
+	void Renderer::recordReadback(vk::CommandBuffer commandBuffer, size_t image)
+	{
+		vk::BufferImageCopy region(
+			0,
+			0,
+			0,
+			vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+			vk::Offset3D(0, 0, 0),
+			vk::Extent3D(swapChainExtent.width, swapChainExtent.height, 1)
+		);
+		commandBuffer.copyImageToBuffer(swapChainImages[image], vk::ImageLayout::eTransferSrcOptimal, readbackBufferData[image].buffer.get(), 1, &region);
+
+		// make the copy visible to the host once the frame's fence has signalled
+		vk::BufferMemoryBarrier readbackBarrier(
+			vk::AccessFlagBits::eTransferWrite,
+			vk::AccessFlagBits::eHostRead,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED,
+			readbackBufferData[image].buffer.get(),
+			0,
+			VK_WHOLE_SIZE
+		);
+		commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eHost,
+			vk::DependencyFlags(),
+			0, nullptr,
+			1, &readbackBarrier,
+			0, nullptr
+		);
+	}
+
+	void Renderer::recordShadowCasters(vk::CommandBuffer commandBuffer, const arenaVector<ShadowBatch>& batches, uint32_t cascade, bool isStatic)
+	{
+		const vk::Rect2D renderArea(vk::Offset2D(0, 0), vk::Extent2D(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE));
 
-				// draw
-				commandBuffers[i]->drawIndexed(static_cast<uint32_t>(meshFactory.getMesh(j)->indices.size()), 1, 0, 0, 0);
+		// the static layers are drawn from scratch; the sampled map already holds the static depth copied into it
+		if (dynamicRendering)
+		{
+			vk::RenderingAttachmentInfoKHR depthAttachment;
+			depthAttachment.imageView = (isStatic ? staticShadowLayerViews : shadowLayerViews)[cascade].get();
+			depthAttachment.imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+			depthAttachment.loadOp = isStatic ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eLoad;
+			depthAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+			depthAttachment.clearValue = vk::ClearValue(vk::ClearDepthStencilValue(1.0f, 0));
+
+			vk::RenderingInfoKHR renderingInfo;
+			renderingInfo.renderArea = renderArea;
+			renderingInfo.layerCount = 1;
+			renderingInfo.pDepthAttachment = &depthAttachment;
+
+			cmdBeginRendering(commandBuffer, reinterpret_cast<const VkRenderingInfoKHR*>(&renderingInfo));
+		}
+		else
+		{
+			const vk::ClearValue clearValue(vk::ClearDepthStencilValue(1.0f, 0));
+			vk::RenderPassBeginInfo renderPassInfo(
+				isStatic ? shadowClearRenderPass.get() : shadowLoadRenderPass.get(),
+				(isStatic ? staticShadowFramebuffers : shadowFramebuffers)[cascade].get(),
+				renderArea,
+				1,
+				&clearValue
+			);
+
+			commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+		}
+
+		commandBuffer.pushConstants(shadowPipelineLayout.get(), vk::ShaderStageFlagBits::eVertex, 0, sizeof(glm::mat4), &shadowCascades[cascade].viewProj);
+		shadowStats.pushConstantUpdates++;
+
+		for (const ShadowBatch& batch : batches)
+		{
+			if (batch.isStatic != isStatic)
+			{
+				continue;
 			}
 
-			//imGuiLayer.drawFrame(commandBuffers[i].get());
+			commandBuffer.bindVertexBuffers(0, batch.mesh->getVertexBufferData(), { 0 });
+			commandBuffer.bindIndexBuffer(batch.mesh->getIndexBufferData(), 0, vk::IndexType::eUint32);
+			shadowStats.vertexBufferBinds++;
 
-			//// bind vertex buffers
-			//std::array<vk::Buffer, 1> vertexBuffers = { vertexBufferData.buffer.get() };
-			//std::array<vk::DeviceSize, 1> offsets = { 0 };
-			//commandBuffers[i]->bindVertexBuffers(0, vertexBuffers, offsets);
-			//commandBuffers[i]->bindIndexBuffer(indexBufferData.buffer.get(), 0, vk::IndexType::eUint32);
+			// the first instance offsets gl_InstanceIndex to the batch's casters
+			commandBuffer.drawIndexed(batch.mesh->getIndexCount(), batch.casterCount, 0, 0, batch.firstCaster);
+			shadowStats.drawCalls++;
+		}
+
+		if (dynamicRendering)
+		{
+			cmdEndRendering(commandBuffer);
+		}
+		else
+		{
+			commandBuffer.endRenderPass();
+		}
+	}
+
+	void Renderer::writeTimestamp(vk::CommandBuffer commandBuffer, size_t image, uint32_t timestamp, vk::PipelineStageFlagBits stage)
+	{
+		const uint32_t firstQuery = static_cast<uint32_t>(image) * TIMESTAMPS_PER_FRAME;
+		if (timestampsSupported && firstQuery + TIMESTAMPS_PER_FRAME <= MAX_TIMESTAMP_QUERIES)
+		{
+			commandBuffer.writeTimestamp(stage, timestampQueryPool.get(), firstQuery + timestamp);
+		}
+	}
 
-			//// bind descriptor sets
-			//std::array<vk::DescriptorSet, 2> bindDescriptorSets;
-			//bindDescriptorSets[0] = descriptorSets[i].get();
-			//bindDescriptorSets[1] = objectDescriptorSets[i].get();
+	void Renderer::createImGuiRenderPass()
+	{
+		// draws over whatever the main pass left in the swap chain image, so the image is loaded rather than cleared
+		vk::AttachmentDescription colorAttachment(
+			{},
+			swapChainImageFormat,
+			vk::SampleCountFlagBits::e1,
+			vk::AttachmentLoadOp::eLoad,
+			vk::AttachmentStoreOp::eStore,
+			vk::AttachmentLoadOp::eDontCare,
+			vk::AttachmentStoreOp::eDontCare,
+			vk::ImageLayout::ePresentSrcKHR,
+			vk::ImageLayout::ePresentSrcKHR
+		);
 
-			//commandBuffers[i]->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout.get(), 0, bindDescriptorSets, nullptr);
+		vk::AttachmentReference colorAttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal);
 
-			//// draw
-			//commandBuffers[i]->drawIndexed(static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+		vk::SubpassDescription subpass(
+			{},
+			vk::PipelineBindPoint::eGraphics,
+			{},
+			{},
+			1,
+			&colorAttachmentReference
+		);
 
-			// end the render pass
-			commandBuffers[i]->endRenderPass();
+		// wait for the main pass to finish writing the image
+		vk::SubpassDependency dependency(
+			VK_SUBPASS_EXTERNAL,
+			0,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput,
+			vk::AccessFlagBits::eColorAttachmentWrite,
+			vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite
+		);
 
-			// finish recording
-			commandBuffers[i]->end();
+		vk::RenderPassCreateInfo renderPassInfo(
+			{},
+			1,
+			&colorAttachment,
+			1,
+			&subpass,
+			1,
+			&dependency
+		);
+		imGuiRenderPass = device->createRenderPassUnique(renderPassInfo);
+
+		BENTO_LOG_TRACE("Created imgui render pass");
+	}
+
+	void Renderer::createImGuiFramebuffers()
+	{
+		imGuiFramebuffers.reserve(swapChainImageViews.size());
+		for (auto const& view : swapChainImageViews)
+		{
+			vk::FramebufferCreateInfo framebufferInfo(
+				vk::FramebufferCreateFlags(),
+				imGuiRenderPass.get(),
+				1,
+				&view.get(),
+				swapChainExtent.width,
+				swapChainExtent.height,
+				1
+			);
+
+			imGuiFramebuffers.push_back(device->createFramebufferUnique(framebufferInfo));
 		}
 
-		log::trace("Created command buffers");
+		BENTO_LOG_TRACE("Created imgui frame buffers");
+	}
+
+	void Renderer::allocateImGuiCommandBuffers()
+	{
+		vk::CommandBufferAllocateInfo allocateInfo(
+			commandPool.get(),
+			vk::CommandBufferLevel::ePrimary,
+			MAX_FRAMES_IN_FLIGHT
+		);
+		imGuiCommandBuffers = device->allocateCommandBuffersUnique(allocateInfo);
+
+		BENTO_LOG_TRACE("Allocated imgui command buffers");
+	}
+
+	void Renderer::recordImGuiCommandBuffer(uint32_t imageIndex, const RenderPacket& packet)
+	{
+		BENTO_PROFILE_FUNCTION();
+
+		// mouse input for the ui, sampled on the main thread
+		ImGuiIO& io = ImGui::GetIO();
+		io.MousePos = ImVec2(packet.mouseX, packet.mouseY);
+		io.MouseDown[0] = packet.mouseButtons[0];
+		io.MouseDown[1] = packet.mouseButtons[1];
+
+		imGuiLayer.newFrame(packet.timing, true);
+
+		// this frame's fence has been waited on, so its buffers and command buffer are free to reuse
+		imGuiLayer.updateBuffers(static_cast<uint32_t>(currentFrame));
+
+		const vk::CommandBuffer commandBuffer = imGuiCommandBuffers[currentFrame].get();
+		commandBuffer.reset(vk::CommandBufferResetFlags());
+		commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+		if (!dynamicRendering)
+		{
+			vk::RenderPassBeginInfo renderPassInfo(
+				imGuiRenderPass.get(),
+				imGuiFramebuffers[imageIndex].get(),
+				vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent)
+			);
+
+			commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+			imGuiLayer.drawFrame(commandBuffer, static_cast<uint32_t>(currentFrame));
+			commandBuffer.endRenderPass();
+		}
+		else
+		{
+			const vk::Image image = swapChainImages[imageIndex];
+
+			// wait for the main pass to finish writing the image; it is loaded rather than cleared
+			attachmentBarrier(
+				commandBuffer,
+				image,
+				vk::ImageAspectFlagBits::eColor,
+				vk::ImageLayout::eColorAttachmentOptimal,
+				vk::ImageLayout::eColorAttachmentOptimal,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::AccessFlagBits::eColorAttachmentWrite,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite
+			);
+
+			vk::RenderingAttachmentInfoKHR colorAttachment;
+			colorAttachment.imageView = swapChainImageViews[imageIndex].get();
+			colorAttachment.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+			colorAttachment.loadOp = vk::AttachmentLoadOp::eLoad;
+			colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+
+			vk::RenderingInfoKHR renderingInfo;
+			renderingInfo.renderArea = vk::Rect2D(vk::Offset2D(0, 0), swapChainExtent);
+			renderingInfo.layerCount = 1;
+			renderingInfo.colorAttachmentCount = 1;
+			renderingInfo.pColorAttachments = &colorAttachment;
+
+			cmdBeginRendering(commandBuffer, reinterpret_cast<const VkRenderingInfoKHR*>(&renderingInfo));
+			imGuiLayer.drawFrame(commandBuffer, static_cast<uint32_t>(currentFrame));
+			cmdEndRendering(commandBuffer);
+
+			attachmentBarrier(
+				commandBuffer,
+				image,
+				vk::ImageAspectFlagBits::eColor,
+				vk::ImageLayout::eColorAttachmentOptimal,
+				vk::ImageLayout::ePresentSrcKHR,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::AccessFlagBits::eColorAttachmentWrite,
+				vk::PipelineStageFlagBits::eBottomOfPipe,
+				vk::AccessFlags()
+			);
+		}
+
+		commandBuffer.end();
+	}
+
+	void Renderer::allocateShadowCommandBuffers()
+	{
+		vk::CommandBufferAllocateInfo allocateInfo(
+			commandPool.get(),
+			vk::CommandBufferLevel::ePrimary,
+			MAX_FRAMES_IN_FLIGHT
+		);
+		shadowCommandBuffers = device->allocateCommandBuffersUnique(allocateInfo);
+
+		BENTO_LOG_TRACE("Allocated shadow command buffers");
+	}
+
+	bool Renderer::recordShadowCommandBuffer(const RenderPacket& packet)
+	{
+		BENTO_PROFILE_FUNCTION();
+
+		shadowStats = FrameStats();
+
+		// nothing samples the map without a directional light; the static layers are drawn again once there is one
+		if (!packet.directionalLight)
+		{
+			staticShadowValid.fill(false);
+			return false;
+		}
+
+		const float aspect = swapChainExtent.width / static_cast<float>(swapChainExtent.height);
+		ShadowCascades::compute(
+			cameraView(),
+			glm::radians(cameraFieldOfView),
+			aspect,
+			cameraNear,
+			cameraFar,
+			SHADOW_SPLIT_LAMBDA,
+			glm::vec3(packet.directionalLight->directionCone),
+			SHADOW_MAP_SIZE,
+			SHADOW_CASTER_REACH,
+			shadowCascades.data(),
+			SHADOW_CASCADES
+		);
+
+		// a static layer goes stale when the static casters change or its cascade moves; the light turning moves every cascade
+		// the cascades are snapped to texels, so they come out bitwise identical while the camera and light hold still
+		std::array<bool, SHADOW_CASCADES> staleLayers;
+		bool anyStale = false;
+		for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+		{
+			staleLayers[c] = !staticShadowValid[c] || packet.staticVersion != staticShadowVersion || shadowCascades[c].viewProj != staticShadowViewProj[c];
+			anyStale |= staleLayers[c];
+		}
+
+		// the casters are the draws sortDraws resolved for the main pass; every one of them is in either the opaque or the blended list
+		arenaVector<uint32_t> casters(frameArena);
+		casters.reserve(opaqueDraws.size() + blendedDraws.size());
+		for (const DrawSort::Item& draw : opaqueDraws)
+		{
+			casters.push_back(draw.index);
+		}
+		for (const DrawSort::Item& draw : blendedDraws)
+		{
+			casters.push_back(draw.index);
+		}
+
+		const bool hasDynamicCasters = std::any_of(casters.begin(), casters.end(), [&](uint32_t caster) { return !packet.draws[caster].isStatic; });
+
+		// the sampled map is still right
+		if (!anyStale && !hasDynamicCasters && !shadowHasDynamicCasters)
+		{
+			return false;
+		}
+
+		// group the casters by geometry, static ones first, so each geometry is a single instanced draw per cascade
+		// both only live until the command buffer is recorded, so they come from the frame arena
+		std::sort(casters.begin(), casters.end(), [&](uint32_t a, uint32_t b)
+		{
+			const bool aStatic = packet.draws[a].isStatic;
+			const bool bStatic = packet.draws[b].isStatic;
+			return aStatic != bStatic ? aStatic : drawMeshes[a]->getGeometry().get() < drawMeshes[b]->getGeometry().get();
+		});
+
+		// this frame's fence has been waited on, so its draw index buffer is free; the casters go after the main pass's entries
+		uint32_t* casterInstances = static_cast<uint32_t*>(drawIndexBufferData[currentFrame].mapped) + SHADOW_DRAW_INDICES;
+		arenaVector<ShadowBatch> shadowBatches(frameArena);
+		shadowBatches.reserve(casters.size());
+		for (uint32_t i = 0; i < casters.size(); i++)
+		{
+			const MeshDraw& caster = packet.draws[casters[i]];
+			Mesh* mesh = drawMeshes[casters[i]];
+			casterInstances[i] = caster.instance;
+
+			if (!shadowBatches.empty() && shadowBatches.back().isStatic == caster.isStatic && shadowBatches.back().mesh->getGeometry() == mesh->getGeometry())
+			{
+				shadowBatches.back().casterCount++;
+				continue;
+			}
+
+			shadowBatches.push_back(ShadowBatch{ mesh, SHADOW_DRAW_INDICES + i, 1, caster.isStatic });
+		}
+
+		const vk::CommandBuffer commandBuffer = shadowCommandBuffers[currentFrame].get();
+		commandBuffer.reset(vk::CommandBufferResetFlags());
+		commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, shadowPipeline.get());
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, shadowPipelineLayout.get(), 0, instanceDescriptorSets[currentFrame].get(), nullptr);
+		shadowStats.pipelineBinds++;
+		shadowStats.descriptorSetBinds++;
+
+		vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(SHADOW_MAP_SIZE), static_cast<float>(SHADOW_MAP_SIZE), 0.0f, 1.0f);
+		commandBuffer.setViewport(0, 1, &viewport);
+		vk::Rect2D scissor({ 0, 0 }, { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE });
+		commandBuffer.setScissor(0, 1, &scissor);
+
+		const vk::PipelineStageFlags depthStages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+		const vk::AccessFlags depthAccess = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+		if (anyStale)
+		{
+			// an earlier frame may still be copying out of the layers
+			attachmentBarrier(
+				commandBuffer,
+				staticShadowImage.image.get(),
+				vk::ImageAspectFlagBits::eDepth,
+				vk::ImageLayout::eTransferSrcOptimal,
+				vk::ImageLayout::eDepthStencilAttachmentOptimal,
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::AccessFlags(),
+				depthStages,
+				depthAccess,
+				SHADOW_CASCADES
+			);
+
+			for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+			{
+				if (!staleLayers[c])
+				{
+					continue;
+				}
+
+				recordShadowCasters(commandBuffer, shadowBatches, c, true);
+				staticShadowViewProj[c] = shadowCascades[c].viewProj;
+				staticShadowValid[c] = true;
+			}
+			staticShadowVersion = packet.staticVersion;
+
+			attachmentBarrier(
+				commandBuffer,
+				staticShadowImage.image.get(),
+				vk::ImageAspectFlagBits::eDepth,
+				vk::ImageLayout::eDepthStencilAttachmentOptimal,
+				vk::ImageLayout::eTransferSrcOptimal,
+				vk::PipelineStageFlagBits::eLateFragmentTests,
+				vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::AccessFlagBits::eTransferRead,
+				SHADOW_CASCADES
+			);
+		}
+
+		// rebuild the sampled map from the static layers, once the previous frame is done sampling it
+		attachmentBarrier(
+			commandBuffer,
+			shadowImage.image.get(),
+			vk::ImageAspectFlagBits::eDepth,
+			vk::ImageLayout::eShaderReadOnlyOptimal,
+			vk::ImageLayout::eTransferDstOptimal,
+			vk::PipelineStageFlagBits::eFragmentShader,
+			vk::AccessFlags(),
+			vk::PipelineStageFlagBits::eTransfer,
+			vk::AccessFlagBits::eTransferWrite,
+			SHADOW_CASCADES
+		);
+
+		const vk::ImageSubresourceLayers layers(vk::ImageAspectFlagBits::eDepth, 0, 0, SHADOW_CASCADES);
+		vk::ImageCopy region(layers, vk::Offset3D(0, 0, 0), layers, vk::Offset3D(0, 0, 0), vk::Extent3D(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1));
+		commandBuffer.copyImage(staticShadowImage.image.get(), vk::ImageLayout::eTransferSrcOptimal, shadowImage.image.get(), vk::ImageLayout::eTransferDstOptimal, region);
+
+		if (hasDynamicCasters)
+		{
+			// and the dynamic casters on top
+			attachmentBarrier(
+				commandBuffer,
+				shadowImage.image.get(),
+				vk::ImageAspectFlagBits::eDepth,
+				vk::ImageLayout::eTransferDstOptimal,
+				vk::ImageLayout::eDepthStencilAttachmentOptimal,
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::AccessFlagBits::eTransferWrite,
+				depthStages,
+				depthAccess,
+				SHADOW_CASCADES
+			);
+
+			for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+			{
+				recordShadowCasters(commandBuffer, shadowBatches, c, false);
+			}
+
+			attachmentBarrier(
+				commandBuffer,
+				shadowImage.image.get(),
+				vk::ImageAspectFlagBits::eDepth,
+				vk::ImageLayout::eDepthStencilAttachmentOptimal,
+				vk::ImageLayout::eShaderReadOnlyOptimal,
+				vk::PipelineStageFlagBits::eLateFragmentTests,
+				vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+				vk::PipelineStageFlagBits::eFragmentShader,
+				vk::AccessFlagBits::eShaderRead,
+				SHADOW_CASCADES
+			);
+		}
+		else
+		{
+			attachmentBarrier(
+				commandBuffer,
+				shadowImage.image.get(),
+				vk::ImageAspectFlagBits::eDepth,
+				vk::ImageLayout::eTransferDstOptimal,
+				vk::ImageLayout::eShaderReadOnlyOptimal,
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::AccessFlagBits::eTransferWrite,
+				vk::PipelineStageFlagBits::eFragmentShader,
+				vk::AccessFlagBits::eShaderRead,
+				SHADOW_CASCADES
+			);
+		}
+		shadowHasDynamicCasters = hasDynamicCasters;
+
+		commandBuffer.end();
+		return true;
 	}
 
 	void Renderer::createSyncObjects()
 	{
 		imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-		imagesInFlight.resize(swapChainImages.size());
+		// 0 has always been reached, so nothing waits on the first frame
+		imageValues.assign(swapChainImages.size(), 0);
 
-		// create semaphore for each frame
+		// binary semaphores are still needed to acquire and present swap chain images
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			imageAvailableSemaphores[i] = device->createSemaphoreUnique(vk::SemaphoreCreateInfo());
 			renderFinishedSemaphores[i] = device->createSemaphoreUnique(vk::SemaphoreCreateInfo());
-			// create already signaled so it works on the first frame
-			inFlightFences[i] = device->createFenceUnique(vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
 		}
 		
-		log::trace("Created sync objects");
+		BENTO_LOG_TRACE("Created sync objects");
 	}
 
-	void Renderer::rebuildCommandBuffers()
+	glm::mat4 Renderer::cameraView() const
 	{
-		createCommandBuffers();
+		return glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 	}
 
-	void Renderer::updateUniformBuffer(uint32_t currentImage)
+	void Renderer::updateUniformBuffer(uint32_t currentImage, const RenderPacket& packet)
 	{
-		static auto startTime = std::chrono::high_resolution_clock::now();
-
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
+		GlobalUBO ubo{};
+		//ubo.model = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, -0.5f, 0.0f));
+		//ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.5f, 0.0f, 1.0f));
+		ubo.view = cameraView();
+		ubo.proj = glm::perspective(glm::radians(cameraFieldOfView), swapChainExtent.width / static_cast<float>(swapChainExtent.height), cameraNear, cameraFar);
+		ubo.proj[1][1] *= -1;
+
+		ubo.inverseProj = glm::inverse(ubo.proj);
+		ubo.screen = glm::vec4(static_cast<float>(swapChainExtent.width), static_cast<float>(swapChainExtent.height), cameraNear, cameraFar);
+		ubo.clusters = glm::uvec4(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, std::min(packet.lightCount, MAX_LIGHTS));
+
+		// recordShadowCommandBuffer has fitted the cascades for this frame
+		if (packet.directionalLight)
 		{
-			GlobalUBO ubo{};
-			//ubo.model = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, -0.5f, 0.0f));
-			//ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.5f, 0.0f, 1.0f));
-			ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-			ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / static_cast<float>(swapChainExtent.height), 0.1f, 10.0f);
-			ubo.proj[1][1] *= -1;
-
-			void* data = device->mapMemory(uniformBufferData[currentImage].memory.get(), 0, sizeof(ubo), {});
-			memcpy(data, &ubo, sizeof(ubo));
-			device->unmapMemory(uniformBufferData[currentImage].memory.get());
+			ubo.lightDirection = glm::vec4(glm::normalize(glm::vec3(packet.directionalLight->directionCone)), 1.0f);
+			ubo.lightColor = packet.directionalLight->colorIntensity;
+			for (uint32_t c = 0; c < SHADOW_CASCADES; c++)
+			{
+				ubo.cascadeViewProj[c] = shadowCascades[c].viewProj;
+				ubo.cascadeSplits[c] = shadowCascades[c].splitDepth;
+			}
 		}
 
-		{
-			ObjectUBO ubo{};
-			//ubo.model = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, -0.5f, 0.0f));
-			ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.5f, 0.0f, 1.0f));
-
-			void* data = device->mapMemory(transformationBufferData[currentImage].memory.get(), 0, sizeof(ubo), {});
-			memcpy(data, &ubo, sizeof(ubo));
-			device->unmapMemory(transformationBufferData[currentImage].memory.get());
-		}
+		void* data = device->mapMemory(uniformBufferData[currentImage].memory.get(), 0, sizeof(ubo), {});
+		memcpy(data, &ubo, sizeof(ubo));
+		device->unmapMemory(uniformBufferData[currentImage].memory.get());
 	}
 
 	std::vector<const char*> Renderer::getRequiredExtensions()
 	{
-		// get the extensions required by glfw
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char*> extensions;
+
+		// get the extensions required by glfw; headless rendering doesn't need any surface extensions
+		if (!headless)
+		{
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		// add validation layer extensions if active
 		if (enableValidationLayers) {
@@ -1477,6 +3021,17 @@ namespace bento
 		return extensions;
 	}
 
+	std::vector<std::string> Renderer::getRequiredDeviceExtensions()
+	{
+		// the swap chain extension is only needed when presenting
+		if (headless)
+		{
+			return {};
+		}
+
+		return deviceExtensions;
+	}
+
 	bool Renderer::checkValidationLayerSupport()
 	{
 		std::vector<vk::LayerProperties> instanceLayerProperties = vk::enumerateInstanceLayerProperties();
@@ -1493,18 +3048,42 @@ namespace bento
 		// does the device support requested extensions
 		bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-		// does the device support requested swap chain features
-		bool swapChainAdequate = false;
-		if (extensionsSupported)
+		// does the device support requested swap chain features (nothing to present to when headless)
+		bool swapChainAdequate = headless;
+		if (extensionsSupported && !headless)
 		{
 			SwapChainSupportDetails swapChainSupport = VulkanUtils::querySwapChainSupport(device, surface.get());
 			swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 		}
 
-		vk::PhysicalDeviceFeatures supportedFeatures;
-		device.getFeatures(&supportedFeatures);
+		// everything is synchronized with timeline semaphores
+		vk::PhysicalDeviceVulkan12Features vulkan12Features;
+		vk::PhysicalDeviceFeatures2 features;
+		features.pNext = &vulkan12Features;
+		device.getFeatures2(&features);
 
-		return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+		return indices.isComplete() && extensionsSupported && swapChainAdequate && vulkan12Features.timelineSemaphore;
+	}
+
+	bool Renderer::checkDynamicRenderingSupport(vk::PhysicalDevice device)
+	{
+		const std::vector<vk::ExtensionProperties> availableExtensions = device.enumerateDeviceExtensionProperties(nullptr);
+		const bool extensionSupported = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const vk::ExtensionProperties& extension)
+		{
+			return std::strcmp(extension.extensionName, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0;
+		});
+
+		if (!extensionSupported)
+		{
+			return false;
+		}
+
+		vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures;
+		vk::PhysicalDeviceFeatures2 features;
+		features.pNext = &dynamicRenderingFeatures;
+		device.getFeatures2(&features);
+
+		return dynamicRenderingFeatures.dynamicRendering;
 	}
 
 	bool Renderer::checkDeviceExtensionSupport(vk::PhysicalDevice device)
@@ -1513,7 +3092,8 @@ namespace bento
 		std::vector<vk::ExtensionProperties> availableExtensions = device.enumerateDeviceExtensionProperties(nullptr);
 
 		// check that all required extensions are supported
-		std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+		const std::vector<std::string> extensions = getRequiredDeviceExtensions();
+		std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 		for (const auto& extension : availableExtensions) {
 			requiredExtensions.erase(extension.extensionName);
 		}
@@ -1537,14 +3117,25 @@ namespace bento
 	// choose present mode; represents the conditions for showing images to the screen; defaults to FIFO
 	vk::PresentModeKHR Renderer::chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes)
 	{
-		// check if our preferred format combination is available
-		for (const auto& availablePresentMode : availablePresentModes) {
-			if (availablePresentMode == vk::PresentModeKHR::eMailbox) {
-				return availablePresentMode;
-			}
+		const PresentMode mode = presentMode.load();
+
+		vk::PresentModeKHR preferred = vk::PresentModeKHR::eFifo;
+		switch (mode)
+		{
+		case PresentMode::Vsync: preferred = vk::PresentModeKHR::eFifo; break;
+		case PresentMode::Mailbox: preferred = vk::PresentModeKHR::eMailbox; break;
+		case PresentMode::Immediate: preferred = vk::PresentModeKHR::eImmediate; break;
+		case PresentMode::FifoRelaxed: preferred = vk::PresentModeKHR::eFifoRelaxed; break;
+		}
+
+		if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferred) != availablePresentModes.end())
+		{
+			BENTO_LOG_INFO("Presenting with {}", vk::to_string(preferred));
+			return preferred;
 		}
 
-		// otherwise just settle a guaranteed mode
+		// fifo is the only mode every surface has to support
+		BENTO_LOG_WARN("{} isn't supported by the surface; falling back to vsync", vk::to_string(preferred));
 		return vk::PresentModeKHR::eFifo;
 	}
 
@@ -1561,7 +3152,7 @@ namespace bento
 		}
 		else // otherwise get the best within the minImageExtent and maxImageExtent bounds
 		{
-			VkExtent2D actualExtent = { static_cast<uint32_t>(window->getWidth()), static_cast<uint32_t>(window->getHeight()) };
+			VkExtent2D actualExtent = framebufferExtent;
 
 			actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
 			actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
@@ -1590,9 +3181,16 @@ namespace bento
 				indices.graphicsFamily = i;
 			}
 
-			// check if the queue family can present to our Window surface
+			// check if the queue family can present to our Window surface; headless never presents, so any graphics queue will do
 			vk::Bool32 presentSupport = false;
-			device.getSurfaceSupportKHR(static_cast<uint32_t>(i), surface.get(), &presentSupport);
+			if (headless)
+			{
+				presentSupport = indices.graphicsFamily.has_value();
+			}
+			else
+			{
+				device.getSurfaceSupportKHR(static_cast<uint32_t>(i), surface.get(), &presentSupport);
+			}
 
 			if (presentSupport) {
 				indices.presentFamily = i;
@@ -3,47 +3,154 @@
 #include <vulkan/vulkan.hpp>
 #include <vk_mem_alloc.h>
 #include <vector>
+#include <array>
+#include <functional>
+#include <optional>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <glm/mat4x4.hpp>
 
 #include "../core/Window.h"
+#include "../core/memory.h"
 #include "Vertex.h"
 #include "BufferData.h"
 #include "QueueFamilyIndices.h"
 #include "VulkanContext.h"
 #include "Mesh.h"
+#include "AssetCache.h"
 #include "Primitives.h"
 #include "ImageData.h"
 #include "ImGuiLayer.h"
+#include "FrameStats.h"
+#include "RenderPacket.h"
+#include "RenderQueue.h"
+#include "RenderSubmission.h"
+#include "Timeline.h"
+#include "PresentMode.h"
+#include "RenderGraph.h"
+#include "ShadowCascades.h"
+#include "DrawSort.h"
+#include "Material.h"
+#include "PipelineCache.h"
 
 namespace bento
 {
-	class Renderer
+	class Renderer : public RenderSubmission
 	{
 	public:
 		Renderer();
 		~Renderer();
 
 		void initialize(Window* window);
-		void drawFrame();
+		// renders into offscreen images instead of a window; no surface, swap chain or presentation is required
+		void initializeHeadless(uint32_t width, uint32_t height);
 		void clean();
 
-		void rebuildCommandBuffers();
+		// once started, every vulkan call for drawing happens on the render thread; the main thread only fills packets
+		// meshes may only be changed while it is stopped or after waitIdle
+		void startRenderThread();
+		// draws whatever is still queued, then joins
+		void stopRenderThread();
+		// waits until the render thread has drawn everything submitted so far; the gpu may still be busy with it,
+		// so anything removed afterwards has to go through the timeline's deletion queue (MeshFactory::destroy does)
+		void waitIdle();
+		// waitIdle, then also waits for the gpu to finish the frame before the one submitted last; input sampled afterwards
+		// goes into a frame with at most one frame of rendering queued ahead of it, and the gpu stays busy with that one meanwhile
+		// this is a rendering wait, not a present wait: the finished frames may still be waiting for scanout (or the compositor)
+		void waitForPreviousFrame();
+
+		// begin blocks while every packet is still queued or being drawn; either rethrows anything the render thread threw
+		// time is the application's simulation time in seconds; inputTime is when the input the frame reacts to was sampled
+		// (profiler::now()), from which the input to present latency is measured, or 0 to leave it unmeasured
+		RenderPacket& beginFrame(float time, int64_t inputTime = 0);
+		void submitFrame();
+
+		// per-frame instance data (world matrices) for the packet being filled; only valid between beginFrame and submitFrame
+		glm::mat4* beginInstances(uint32_t& capacity) override;
+		void endInstances(uint32_t count) override { packing->instanceCount = count; }
+
+		// the mesh entities to draw, filled the same way; each is looked up by content hash in the mesh factory and placed by its instance
+		// the same draws cast the shadows; staticVersion has to change whenever the static ones do
+		MeshDraw* beginDraws(uint32_t& capacity) override;
+		void endDraws(uint32_t count, uint64_t staticVersion) override
+		{
+			packing->drawCount = count;
+			packing->staticVersion = staticVersion;
+		}
+
+		// the frame's lights, filled the same way; binned into the cluster grid on the gpu each frame
+		Light* beginLights(uint32_t& capacity) override;
+		void endLights(uint32_t count) override { packing->lightCount = count; }
+
+		// the frame's directional light, which casts the cascaded shadows; the last call before submitFrame wins
+		void setDirectionalLight(const Light& light) override { packing->directionalLight = light; }
+
+		// headless only: receives each frame as tightly packed rgba8 once the gpu has finished it
+		// called on the render thread while it is running; the pixels are only valid for the duration of the call
+		using ReadbackCallback = std::function<void(const uint8_t* pixels, uint32_t width, uint32_t height, uint64_t frame)>;
+		void setReadbackCallback(ReadbackCallback callback) { readbackCallback = callback; }
+		// waits for the frames still in flight and delivers their readbacks
+		void flushReadbacks();
+
+		bool isHeadless() const { return headless; }
+
+		// before initialize; renders through render passes and framebuffers even where VK_KHR_dynamic_rendering is available
+		void setDynamicRenderingAllowed(bool allowed) { dynamicRenderingAllowed = allowed; }
+		bool usesDynamicRendering() const { return dynamicRendering; }
+
+		// before initialize; clamped to the highest count the device supports for both color and depth attachments
+		// the scene is drawn into transient multisampled attachments and resolved into the swap chain image at the end of the pass
+		void setSampleCount(vk::SampleCountFlagBits samples) { requestedSamples = samples; }
+		vk::SampleCountFlagBits getSampleCount() const { return msaaSamples; }
+
+		// lays the scene's depth down front to back in a depth only pass first, so the main pass only shades the visible surface of each pixel
+		// applies from the next frame
+		void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+		bool getDepthPrepass() const { return depthPrepass; }
+
+		// blocks until every material drawn so far has its own pipeline; the next frame draws with them
+		void waitForPipelines() { pipelineCache.waitIdle(); }
+
+		// takes effect from the next frame by rebuilding the swap chain; a mode the surface doesn't support falls back to vsync
+		void setPresentMode(PresentMode mode);
+		PresentMode getPresentMode() const { return presentMode.load(); }
+
+		// the stats the render thread left in the packet last returned by beginFrame, i.e. a few frames old
+		const FrameStats& getFrameStats() const { return completedStats; }
+		const std::string& getDeviceName() const { return deviceName; }
 
 		static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
 			auto app = reinterpret_cast<Renderer*>(glfwGetWindowUserPointer(window));
-			app->framebufferResized = true;
+			app->framebufferResized.store(true);
 		}
 
 		VulkanContext context;
 
-		MeshFactory meshFactory = MeshFactory(&context);
+		// shared geometry and textures; has to outlive every mesh
+		AssetCache assets = AssetCache(&context);
+		MeshFactory meshFactory = MeshFactory(&context, &assets);
 
 	private:
-		//ImGuiLayer imGuiLayer = ImGuiLayer(&context);
+		ImGuiLayer imGuiLayer = ImGuiLayer(&context);
 
 		const std::vector<Vertex> vertices = Cube::vertices;
 		const std::vector<uint32_t> indices = Cube::indices;
 
-		Window* window;
+		Window* window = nullptr;
+
+		bool headless = false;
+		vk::Extent2D headlessExtent;
+
+		std::thread renderThread;
+		RenderQueue<RenderPacket> packets;
+		// the packet the main thread is filling
+		RenderPacket* packing = nullptr;
+		std::exception_ptr renderError;
+		FrameStats completedStats;
+
+		// the window's framebuffer as of the packet being drawn; render thread only
+		vk::Extent2D framebufferExtent;
 
 		vk::UniqueInstance instance;
 		VkDebugUtilsMessengerEXT debugMessenger;
@@ -52,6 +159,16 @@ namespace bento
 
 		vk::PhysicalDevice physicalDevice;
 		vk::UniqueDevice device;
+		std::string deviceName;
+
+		// every graphics queue submit goes through the timeline; declared after the device so it is destroyed first
+		Timeline timeline;
+		// the timeline value each frame in flight and each swap chain image was last submitted with
+		std::vector<uint64_t> frameValues;
+		std::vector<uint64_t> imageValues;
+		// the values of the last two frames submitted; the render thread writes them, waitForPreviousFrame reads the older one
+		uint64_t latestFrameValue = 0;
+		std::atomic<uint64_t> previousFrameValue = 0;
 
 		vk::Queue graphicsQueue;
 		vk::Queue presentQueue;
@@ -63,46 +180,211 @@ namespace bento
 		std::vector<vk::UniqueImageView> swapChainImageViews;
 		std::vector<vk::UniqueFramebuffer> swapChainFramebuffers;
 
+		// with dynamic rendering there are no render passes or framebuffers; the pipelines are built against the attachment formats
+		// and the command buffers transition the attachments themselves
+		bool dynamicRenderingAllowed = true;
+		bool dynamicRendering = false;
+		PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+		PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+
+		// the scene (and headless readback) as a graph, recorded into each command buffer with that image bound as the target;
+		// only with dynamic rendering. its depth (and multisampled color) images are transient rather than depthImage and colorImage
+		RenderGraph frameGraph;
+		RenderGraph::Image frameGraphTarget = 0;
+
 		vk::UniqueRenderPass renderPass;
 		vk::UniquePipelineLayout pipelineLayout;
-		vk::UniquePipeline graphicsPipeline;
+
+		// every scene pipeline shares the layout above and is owned by the cache, one per material permutation
+		// meshes whose material is still compiling are drawn with the defaults below, which are built up front
+		PipelineCache pipelineCache;
+		static constexpr uint32_t PIPELINE_COMPILE_THREADS = 2;
+		vk::Pipeline graphicsPipeline;
+
+		// variants of the default material for drawing with a depth prepass: the prepass has no fragment stage or color writes,
+		// the main pass after it only passes fragments at exactly the depth laid down and writes none
+		bool depthPrepass = false;
+		vk::Pipeline depthPrepassPipeline;
+		vk::Pipeline depthEqualPipeline;
+
+		// the order the scene is drawn in, worked out every frame from the packet's draws (the items index them)
+		// - the main pass is sorted by state (pipeline, material, mesh) and then front to back
+		// - the prepass is sorted front to back only, so later draws are rejected by the depth test as early as possible
+		// - blended materials are drawn last, back to front, and never go through the prepass
+		// runs of the same geometry and pipeline become one instanced draw
+		std::vector<DrawSort::Item> opaqueDraws;
+		std::vector<DrawSort::Item> depthDraws;
+		std::vector<DrawSort::Item> blendedDraws;
+		std::vector<DrawSort::Item> drawScratch;
+		// each of the packet's draws resolved to its mesh; null if the mesh isn't loaded
+		std::vector<Mesh*> drawMeshes;
+		// the packet the command buffer being recorded draws, and how much of the frame's draw index buffer it has used
+		const RenderPacket* recordingPacket = nullptr;
+		uint32_t recordedDrawIndices = 0;
 
 		vk::UniqueDescriptorSetLayout descriptorSetLayout;
 		vk::UniqueDescriptorPool descriptorPool;
 		std::vector<vk::UniqueDescriptorSet> descriptorSets;
 
-		vk::UniqueDescriptorSetLayout objectDescriptorSetLayout;
-		vk::UniqueDescriptorPool objectDescriptorPool;
-		std::vector<vk::UniqueDescriptorSet> objectDescriptorSets;
-
 		vk::UniqueCommandPool commandPool;
+		// one per image, recorded again each frame it is drawn
 		std::vector<vk::UniqueCommandBuffer> commandBuffers;
 
+		// the ui changes every frame, so it gets its own pass on top of the finished image and a command buffer per frame in flight that is re-recorded each frame
+		vk::UniqueRenderPass imGuiRenderPass;
+		std::vector<vk::UniqueFramebuffer> imGuiFramebuffers;
+		std::vector<vk::UniqueCommandBuffer> imGuiCommandBuffers;
+
 		std::vector<vk::UniqueSemaphore> imageAvailableSemaphores;
 		std::vector<vk::UniqueSemaphore> renderFinishedSemaphores;
-		std::vector<vk::UniqueFence> inFlightFences;
-		std::vector<vk::Fence> imagesInFlight;
 
 		BufferData vertexBufferData;
 		BufferData indexBufferData;
 
 		std::vector<BufferData> uniformBufferData;
-		std::vector<BufferData> transformationBufferData;
 
-		BufferData stagingBuffer;
+		// one per frame in flight, mapped for the renderer's lifetime; each packet's instances are copied in once its frame is free
+		std::vector<BufferData> instanceBufferData;
+		uint32_t instanceCount = 0;
+		const uint32_t MAX_INSTANCES = 16384;
+
+		// one per frame in flight, mapped like the instance buffers; for every instanced draw the frame records, the instances it covers.
+		// an instanced draw's first instance is where its entries start, so gl_InstanceIndex picks out the world matrix
+		// the main pass writes at most two entries per draw (prepass and main pass) ahead of the shadow casters' entries
+		std::vector<BufferData> drawIndexBufferData;
+		const uint32_t SHADOW_DRAW_INDICES = 2 * MAX_INSTANCES;
+		// the instances and the draw index buffer, read by the main and shadow passes alike; one set per frame in flight
+		vk::UniqueDescriptorSetLayout instanceDescriptorSetLayout;
+		vk::UniqueDescriptorPool instanceDescriptorPool;
+		std::vector<vk::UniqueDescriptorSet> instanceDescriptorSets;
+
+		// clustered lighting: a compute pass bins the frame's lights into a grid of view space clusters (screen tiles times exponential depth slices)
+		// and the fragment shader only walks the list of the cluster it falls in. one set of buffers per swap chain image, like the uniform buffers
+		// - the lights are host visible and mapped, copied in once the image is free
+		// - the grid holds a light count per cluster and the index list a fixed number of slots per cluster, so binning needs no atomics or clearing
+		std::vector<BufferData> lightBufferData;
+		std::vector<BufferData> lightGridBufferData;
+		std::vector<BufferData> lightIndexBufferData;
+		vk::UniquePipelineLayout lightCullingPipelineLayout;
+		vk::UniquePipeline lightCullingPipeline;
+		const uint32_t MAX_LIGHTS = 16384;
+		// must match the shaders
+		const uint32_t CLUSTERS_X = 16;
+		const uint32_t CLUSTERS_Y = 9;
+		const uint32_t CLUSTERS_Z = 24;
+		const uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+		const uint32_t LIGHT_CULLING_GROUP_SIZE = 64;
+
+		// cascaded shadow maps for the directional light; depth only, one layer per cascade, fitted to the camera's frustum every frame
+		// - static casters are drawn into layers of their own, which are kept until the static casters change or their cascade moves (or the light turns)
+		// - the sampled map is the static layers copied over, with the dynamic casters drawn on top; it is only rebuilt when either part changed,
+		//   so with nothing moving and no dynamic casters no shadow work is submitted at all
+		// - both images are shared by the frames in flight; rebuilding the map waits for the previous frame to finish sampling it
+		static constexpr uint32_t SHADOW_CASCADES = 4;
+		const uint32_t SHADOW_MAP_SIZE = 2048;
+		// blends logarithmic (1) and uniform (0) cascade splits
+		const float SHADOW_SPLIT_LAMBDA = 0.75f;
+		// how far towards the light past a cascade's bounds casters are still drawn
+		const float SHADOW_CASTER_REACH = 20.0f;
+		vk::Format shadowFormat;
+		ImageData staticShadowImage;
+		ImageData shadowImage;
+		std::vector<vk::UniqueImageView> staticShadowLayerViews;
+		std::vector<vk::UniqueImageView> shadowLayerViews;
+		vk::UniqueImageView shadowArrayView;
+		vk::UniqueSampler shadowSampler;
+		// render pass path only; the static layers are cleared, the sampled map keeps the static depth copied into it
+		vk::UniqueRenderPass shadowClearRenderPass;
+		vk::UniqueRenderPass shadowLoadRenderPass;
+		std::vector<vk::UniqueFramebuffer> staticShadowFramebuffers;
+		std::vector<vk::UniqueFramebuffer> shadowFramebuffers;
+		vk::UniquePipelineLayout shadowPipelineLayout;
+		vk::UniquePipeline shadowPipeline;
+		// re-recorded by every frame that has shadow work, one per frame in flight
+		std::vector<vk::UniqueCommandBuffer> shadowCommandBuffers;
+
+		// the cascades of the frame being drawn, and what each static layer was last drawn with
+		std::array<ShadowCascades::Cascade, SHADOW_CASCADES> shadowCascades = {};
+		std::array<glm::mat4, SHADOW_CASCADES> staticShadowViewProj = {};
+		std::array<bool, SHADOW_CASCADES> staticShadowValid = {};
+		uint64_t staticShadowVersion = 0;
+		// the sampled map holds dynamic casters, which have to be cleared out again even if nothing else changed
+		bool shadowHasDynamicCasters = false;
+
+		// consecutive casters with the same geometry, drawn with one instanced draw per cascade
+		struct ShadowBatch
+		{
+			Mesh* mesh;
+			uint32_t firstCaster;
+			uint32_t casterCount;
+			bool isStatic;
+		};
+		// what the frame's shadow command buffer submits, if it submits one
+		FrameStats shadowStats;
+
+		// the scene camera, fixed for now; the cascades are fitted to its frustum
+		const float cameraFieldOfView = 45.0f;
+		const float cameraNear = 0.1f;
+		const float cameraFar = 10.0f;
 
 		// bundle
-		ImageData textureImage;
-		vk::UniqueImageView textureImageView;
+		TextureHandle texture;
 		vk::UniqueSampler textureSampler;
 
+		vk::SampleCountFlagBits requestedSamples = vk::SampleCountFlagBits::e1;
+		vk::SampleCountFlagBits msaaSamples = vk::SampleCountFlagBits::e1;
+		// the multisampled attachments are never stored, so where the device has lazily allocated memory they are never backed on tilers
+		vk::MemoryPropertyFlags transientMemory = vk::MemoryPropertyFlagBits::eDeviceLocal;
+
+		// only with render passes; the frame graph owns its own. the color image is only there when multisampling
+		ImageData colorImage;
+		vk::UniqueImageView colorImageView;
 		ImageData depthImage;
+		vk::Format depthFormat;
 		vk::UniqueImageView depthImageView;
 
+		// headless render targets, one per frame in flight; their handles stand in for the swap chain images
+		std::vector<ImageData> offscreenImages;
+
+		// pooled, persistently mapped buffers the offscreen images are copied into, one per frame in flight
+		std::vector<BufferData> readbackBufferData;
+		// the frame waiting in each readback buffer, if any
+		std::vector<std::optional<uint64_t>> readbackFrames;
+		uint64_t frameNumber = 0;
+		ReadbackCallback readbackCallback;
+
+		bool anisotropySupported = false;
+
+		// the frame the render thread is drawing
+		FrameStats frameStats;
+		// the render thread's scratch memory for the frame it is drawing, reset as each frame starts
+		linearArena frameArena;
+		// what each image's command buffer submits (draws, binds), counted while recording
+		std::vector<FrameStats> recordedStats;
+
+		// timestamps written by each command buffer; read back once the frame using it has finished
+		static constexpr uint32_t FRAME_BEGIN_TIMESTAMP = 0;
+		static constexpr uint32_t MAIN_PASS_BEGIN_TIMESTAMP = 1;
+		static constexpr uint32_t MAIN_PASS_END_TIMESTAMP = 2;
+		static constexpr uint32_t FRAME_END_TIMESTAMP = 3;
+		static constexpr uint32_t TIMESTAMPS_PER_FRAME = 4;
+
+		vk::UniqueQueryPool timestampQueryPool;
+		const uint32_t MAX_TIMESTAMP_QUERIES = 32;
+		bool timestampsSupported = false;
+		float timestampPeriod = 0.0f;
+		// the command buffer each frame in flight last submitted and when, for reading its timestamps
+		std::vector<std::optional<uint32_t>> submittedImages;
+		std::vector<int64_t> submittedAt;
+
 		const int MAX_FRAMES_IN_FLIGHT = 2;
 		size_t currentFrame = 0;
 
-		bool framebufferResized = false;
+		// set from the window callback on the main thread
+		std::atomic<bool> framebufferResized = false;
+
+		// requested on the main thread, applied by the render thread the next time it builds the swap chain
+		std::atomic<PresentMode> presentMode = PresentMode::Mailbox;
 
 		const std::vector<const char*> instanceLayerNames = {
 			"VK_LAYER_KHRONOS_validation"
@@ -121,46 +403,94 @@ namespace bento
 
 		void initalizeVulkan();
 
-		void cleanupSwapChain();
 		void recreateSwapChain();
+		// for when recreating the swap chain changed the image count: retires and rebuilds the uniform and light buffers and descriptor sets
+		void recreatePerImageResources();
 
 		void createInstance();
 		void setupDebugMessenger();
 		void createSurface();
 		void pickPhysicalDevice();
 		void createLogicalDevice();
+		void createTimeline();
 		void createAllocator();
 		void createSwapChain();
+		void createOffscreenTargets();
 		void createImageViews();
 		void createRenderPass();
 		void createDescriptorSetLayout();
-		void createObjectDescriptorSetLayout();
 		void createGraphicsPipeline();
+		void createLightCullingPipeline();
+		// picks the shadow map format; the render passes are only created without dynamic rendering
+		void createShadowRenderPasses();
+		void createShadowPipeline();
 		void createFramebuffers();
 		void createCommandPool();
+		void createTimestampQueryPool();
 		// move this out
+		void createColorResources();
 		void createDepthResources();
 		void createTextureImage();
-		void createTextureImageView();
 		void createTextureSampler();
 
 		void createVertexBuffer();
 		void createIndexBuffer();
 		void createUniformBuffers();
+		void createInstanceBuffers();
+		void createLightBuffers();
+		void createShadowResources();
+		void createReadbackBuffers();
 		void createDescriptorPool();
-		void createObjectDescriptorPool();
 		void createDescriptorSets();
-		//void createObjectDescriptorSets();
+		void createInstanceDescriptorSets();
 		void allocateCommandBuffers();
-		void createCommandBuffers();
+		// records the image's command buffer to draw the packet; the image's previous frame has to have finished
+		void recordCommandBuffer(uint32_t image, const RenderPacket& packet);
+		void createFrameGraph();
+		// render pass path only; the frame graph begins its own passes
+		void beginMainPass(vk::CommandBuffer commandBuffer, size_t image);
+		void recordLightCulling(vk::CommandBuffer commandBuffer, size_t image);
+		void sortDraws(const RenderPacket& packet);
+		void recordScene(vk::CommandBuffer commandBuffer, size_t image);
+		// binds the pipeline, vertex and index buffers and the material's constants only when they change
+		void recordDraws(vk::CommandBuffer commandBuffer, size_t image, const std::vector<DrawSort::Item>& draws, bool prepass);
+		// the pipeline a mesh is drawn with in the prepass or main pass; a default one while its own is still being built
+		vk::Pipeline pipelineFor(const Material& material, bool prepass);
+		void recordReadback(vk::CommandBuffer commandBuffer, size_t image);
+		// one cascade's static or dynamic casters into its layer of the static or sampled shadow map
+		void recordShadowCasters(vk::CommandBuffer commandBuffer, const arenaVector<ShadowBatch>& batches, uint32_t cascade, bool isStatic);
+		// skipped when there is no room in the query pool for the image's timestamps
+		void writeTimestamp(vk::CommandBuffer commandBuffer, size_t image, uint32_t timestamp, vk::PipelineStageFlagBits stage);
 		void createSyncObjects();
 
-		void updateUniformBuffer(uint32_t currentImage);
+		void createImGuiRenderPass();
+		void createImGuiFramebuffers();
+		void allocateImGuiCommandBuffers();
+		void recordImGuiCommandBuffer(uint32_t imageIndex, const RenderPacket& packet);
+
+		void allocateShadowCommandBuffers();
+		// fits the cascades and records whatever shadow work the frame needs; false if there is none and nothing needs submitting
+		bool recordShadowCommandBuffer(const RenderPacket& packet);
+
+		glm::mat4 cameraView() const;
+		void updateUniformBuffer(uint32_t currentImage, const RenderPacket& packet);
+
+		void renderLoop();
+		void drawFrame(const RenderPacket& packet);
+		void drawFrameHeadless(const RenderPacket& packet);
+		void uploadInstances(const RenderPacket& packet);
+		void uploadLights(uint32_t currentImage, const RenderPacket& packet);
+		void readGpuTime(size_t frame);
+		// also tracks the frame's timeline value for waitForPreviousFrame
+		void recordSubmission(uint32_t imageIndex);
+		void deliverReadback(size_t frame);
 
 		std::vector<const char*> getRequiredExtensions();
+		std::vector<std::string> getRequiredDeviceExtensions();
 		bool checkValidationLayerSupport();
 		bool isDeviceSuitable(vk::PhysicalDevice device);
 		bool checkDeviceExtensionSupport(vk::PhysicalDevice device);
+		bool checkDynamicRenderingSupport(vk::PhysicalDevice device);
 
 		vk::SurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats);
 		vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes);
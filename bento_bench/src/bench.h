@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// synthetic scene rendered headless for a fixed number of frames; results are written as json
+struct FrameBenchOptions
+{
+	size_t entities = 10000;
+	uint32_t meshes = 16;
+	uint32_t frames = 1000;
+	// frames run before measuring so caches, pipelines and the driver settle
+	uint32_t warmup = 60;
+	uint32_t width = 1280;
+	uint32_t height = 720;
+	uint32_t seed = 1234;
+	// draw the scene's depth in a prepass first
+	bool depthPrepass = false;
+	std::string output = "bento_bench.json";
+	// chrome trace of the measured frames; none if empty
+	std::string trace;
+};
+
+int runFrameBench(const FrameBenchOptions& options);
+
+// compares the batched SIMD transform kernel against the naive glm path
+int runTransformBench(size_t entityCount, int iterations);
+
+// times the spatial index's inserts, updates, overlap queries and raycasts; the overlap results are checked against brute force
+int runQueryBench(size_t entityCount, int iterations);
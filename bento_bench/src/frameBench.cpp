@@ -0,0 +1,328 @@
+#include "bench.h"
+
+#include <bento/core/application.h>
+#include <bento/core/log.h>
+#include <bento/core/memory.h>
+#include <bento/core/profiler.h>
+#include <bento/core/state.h>
+#include <bento/ecs/Scene.h>
+#include <bento/ecs/Entity.h>
+#include <bento/ecs/Components.h>
+#include <bento/renderer/VulkanUtils.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	double millisecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	struct Sample
+	{
+		double frame = 0.0;
+		double simulate = 0.0;
+		double update = 0.0;
+		double render = 0.0;
+		// made by the main thread from one frame's update to the next
+		uint64_t heapAllocations = 0;
+		bento::FrameStats renderer;
+	};
+
+	struct Summary
+	{
+		double mean = 0.0;
+		double min = 0.0;
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	template<typename Value>
+	Summary summarize(const std::vector<Sample>& samples, Value value)
+	{
+		std::vector<double> values;
+		values.reserve(samples.size());
+		for (const auto& sample : samples)
+		{
+			values.push_back(static_cast<double>(value(sample)));
+		}
+
+		Summary summary;
+		if (values.empty()) return summary;
+
+		std::sort(values.begin(), values.end());
+
+		auto percentile = [&](double p)
+		{
+			return values[std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())))];
+		};
+
+		double total = 0.0;
+		for (double v : values) total += v;
+
+		summary.mean = total / static_cast<double>(values.size());
+		summary.min = values.front();
+		summary.p50 = percentile(0.50);
+		summary.p95 = percentile(0.95);
+		summary.p99 = percentile(0.99);
+		summary.max = values.back();
+		return summary;
+	}
+
+	// builds a synthetic scene, then records per-stage timings for every measured frame
+	class benchState : public bento::state
+	{
+	public:
+		benchState(const FrameBenchOptions& options)
+			: options(options), random(options.seed)
+		{
+			scene = std::make_shared<bento::Scene>();
+		}
+
+		void start() override
+		{
+			auto& renderer = bento::application::get().getRenderer();
+
+			// distinct content per mesh so they aren't deduplicated by hash
+			std::vector<uint64_t> meshes;
+			for (uint32_t i = 0; i < options.meshes; i++)
+			{
+				std::vector<Vertex> vertices = Cube::vertices;
+				for (auto& vertex : vertices)
+				{
+					vertex.pos *= 1.0f + static_cast<float>(i) * 0.01f;
+				}
+
+				bento::MeshHandle handle = renderer.meshFactory.create(vertices, Cube::indices);
+				meshes.push_back(renderer.meshFactory.get(handle)->getContentHash());
+			}
+
+			std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+			std::uniform_real_distribution<float> size(0.5f, 2.0f);
+			std::uniform_int_distribution<size_t> mesh(0, meshes.empty() ? 0 : meshes.size() - 1);
+
+			entities.reserve(options.entities);
+			origins.reserve(options.entities);
+			for (size_t i = 0; i < options.entities; i++)
+			{
+				auto entity = scene->CreateEntity();
+
+				const glm::vec3 origin(position(random), position(random), position(random));
+				entity.GetComponent<bento::TranslationComponent>().translation = origin;
+				entity.GetComponent<bento::RotationComponent>().rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+				entity.GetComponent<bento::ScaleComponent>().scale = glm::vec3(size(random));
+
+				entity.AddComponent<bento::BoundsComponent>();
+				entity.AddComponent<bento::MeshComponent>(glm::vec4(1.0f), meshes.empty() ? 0 : meshes[mesh(random)]);
+
+				entities.push_back(entity);
+				origins.push_back(origin);
+			}
+
+			allocationsAtStart = bento::VulkanUtils::getAllocationCount();
+			samples.reserve(options.frames);
+		}
+
+		void update(float delta) override
+		{
+			const auto frameStart = Clock::now();
+			const uint64_t heapAllocations = bento::memory::threadHeapAllocations();
+
+			// the renderer's numbers belong to the drawFrame that ran since the last update
+			if (frame > options.warmup)
+			{
+				current.frame = std::chrono::duration<double, std::milli>(frameStart - lastFrameStart).count();
+				current.heapAllocations = heapAllocations - lastHeapAllocations;
+				current.renderer = bento::application::get().getRenderer().getFrameStats();
+				samples.push_back(current);
+			}
+			else if (frame == options.warmup)
+			{
+				allocationsAtMeasure = bento::VulkanUtils::getAllocationCount();
+
+				if (!options.trace.empty())
+				{
+					bento::profiler::beginCapture();
+				}
+			}
+
+			if (samples.size() >= options.frames)
+			{
+				allocationsAtEnd = bento::VulkanUtils::getAllocationCount();
+
+				if (bento::profiler::isCapturing())
+				{
+					bento::profiler::endCapture(options.trace);
+				}
+
+				bento::application::get().close();
+				return;
+			}
+
+			lastFrameStart = frameStart;
+			lastHeapAllocations = heapAllocations;
+			current = Sample();
+
+			// deterministic movement so every run does the same work
+			auto start = Clock::now();
+			{
+				BENTO_PROFILE_SCOPE("simulate");
+				const float time = static_cast<float>(frame) * delta;
+				for (size_t i = 0; i < entities.size(); i++)
+				{
+					const float phase = static_cast<float>(i) * 0.1f;
+					const glm::vec3 translation = origins[i] + glm::vec3(std::sin(time + phase), std::cos(time + phase), 0.0f);
+					entities[i].PatchComponent<bento::TranslationComponent>([&](bento::TranslationComponent& t) { t.translation = translation; });
+				}
+			}
+			current.simulate = millisecondsSince(start);
+
+			start = Clock::now();
+			scene->OnUpdate();
+			current.update = millisecondsSince(start);
+
+			frame++;
+		}
+
+		void render(float alpha) override
+		{
+			const auto start = Clock::now();
+			scene->OnRender(bento::application::get().getRenderer(), alpha);
+			current.render = millisecondsSince(start);
+		}
+
+		bool write() const
+		{
+			std::FILE* file = std::fopen(options.output.c_str(), "w");
+			if (!file)
+			{
+				BENTO_LOG_ERROR("failed to open {} for writing", options.output);
+				return false;
+			}
+
+			auto& renderer = bento::application::get().getRenderer();
+
+			std::fprintf(file, "{\n");
+			std::fprintf(file, "\t\"config\": { \"entities\": %zu, \"meshes\": %u, \"textures\": 1, \"frames\": %u, \"warmup\": %u, \"width\": %u, \"height\": %u, \"seed\": %u, \"depthPrepass\": %s },\n",
+				options.entities, options.meshes, options.frames, options.warmup, options.width, options.height, options.seed, options.depthPrepass ? "true" : "false");
+			std::fprintf(file, "\t\"device\": \"%s\",\n", renderer.getDeviceName().c_str());
+
+			auto writeSummary = [&](const char* name, const Summary& summary, bool last = false)
+			{
+				std::fprintf(file, "\t\t\"%s\": { \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+					name, summary.mean, summary.min, summary.p50, summary.p95, summary.p99, summary.max, last ? "" : ",");
+			};
+
+			// milliseconds
+			std::fprintf(file, "\t\"timings\": {\n");
+			writeSummary("frame", summarize(samples, [](const Sample& s) { return s.frame; }));
+			writeSummary("simulate", summarize(samples, [](const Sample& s) { return s.simulate; }));
+			writeSummary("update", summarize(samples, [](const Sample& s) { return s.update; }));
+			writeSummary("render", summarize(samples, [](const Sample& s) { return s.render; }));
+			writeSummary("drawFrame", summarize(samples, [](const Sample& s) { return s.renderer.cpuTime; }));
+			writeSummary("fenceWait", summarize(samples, [](const Sample& s) { return s.renderer.waitTime; }));
+			writeSummary("gpu", summarize(samples, [](const Sample& s) { return s.renderer.gpuTime; }), true);
+			std::fprintf(file, "\t},\n");
+
+			std::fprintf(file, "\t\"counters\": {\n");
+			writeSummary("drawCalls", summarize(samples, [](const Sample& s) { return s.renderer.drawCalls; }));
+			writeSummary("pipelineBinds", summarize(samples, [](const Sample& s) { return s.renderer.pipelineBinds; }));
+			writeSummary("descriptorSetBinds", summarize(samples, [](const Sample& s) { return s.renderer.descriptorSetBinds; }));
+			writeSummary("vertexBufferBinds", summarize(samples, [](const Sample& s) { return s.renderer.vertexBufferBinds; }));
+			writeSummary("pushConstantUpdates", summarize(samples, [](const Sample& s) { return s.renderer.pushConstantUpdates; }), true);
+			std::fprintf(file, "\t},\n");
+
+			// a warmed up frame loop shouldn't touch the heap on either thread
+			std::fprintf(file, "\t\"memory\": {\n");
+			writeSummary("mainHeapAllocations", summarize(samples, [](const Sample& s) { return s.heapAllocations; }));
+			writeSummary("renderHeapAllocations", summarize(samples, [](const Sample& s) { return s.renderer.heapAllocations; }));
+			writeSummary("frameArenaBytes", summarize(samples, [](const Sample& s) { return s.renderer.arenaBytes; }), true);
+			std::fprintf(file, "\t},\n");
+
+			std::fprintf(file, "\t\"deviceAllocations\": { \"scene\": %llu, \"measured\": %llu, \"total\": %llu }\n",
+				static_cast<unsigned long long>(allocationsAtStart),
+				static_cast<unsigned long long>(allocationsAtEnd - allocationsAtMeasure),
+				static_cast<unsigned long long>(allocationsAtEnd));
+			std::fprintf(file, "}\n");
+
+			const bool ok = std::ferror(file) == 0;
+			std::fclose(file);
+
+			const Summary frames = summarize(samples, [](const Sample& s) { return s.frame; });
+			BENTO_LOG_INFO("{} frames, mean {:.3f} ms, p95 {:.3f} ms, p99 {:.3f} ms; written to {}", samples.size(), frames.mean, frames.p95, frames.p99, options.output);
+
+			return ok;
+		}
+
+	private:
+		FrameBenchOptions options;
+		std::mt19937 random;
+
+		std::shared_ptr<bento::Scene> scene;
+		std::vector<bento::Entity> entities;
+		std::vector<glm::vec3> origins;
+
+		uint32_t frame = 0;
+		Clock::time_point lastFrameStart;
+		uint64_t lastHeapAllocations = 0;
+		Sample current;
+		std::vector<Sample> samples;
+
+		uint64_t allocationsAtStart = 0;
+		uint64_t allocationsAtMeasure = 0;
+		uint64_t allocationsAtEnd = 0;
+	};
+
+	class benchApplication : public bento::application
+	{
+	public:
+		benchApplication(const FrameBenchOptions& options)
+			: state(options)
+		{
+		}
+
+		benchState state;
+	};
+}
+
+int runFrameBench(const FrameBenchOptions& options)
+{
+	// console output stays off the measured thread
+	bento::log::initialize(true);
+
+	benchApplication app(options);
+	app.getRenderer().setDepthPrepass(options.depthPrepass);
+	app.initializeHeadless(static_cast<int>(options.width), static_cast<int>(options.height));
+	app.pushState(&app.state);
+
+	try
+	{
+		app.run();
+	}
+	catch (std::exception& err)
+	{
+		BENTO_LOG_ERROR(err.what());
+		bento::log::shutdown();
+		return 1;
+	}
+
+	const bool written = app.state.write();
+	app.clean();
+
+	bento::log::shutdown();
+	return written ? 0 : 1;
+}
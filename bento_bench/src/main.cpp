@@ -0,0 +1,54 @@
+#include "bench.h"
+
+#include <bento/core/allocationHooks.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// usage:
+//   bento_bench [--entities N] [--meshes N] [--frames N] [--warmup N] [--width N] [--height N] [--seed N] [--prepass 0|1] [--output file] [--trace file]
+//   bento_bench transform [entity count] [iterations]
+//   bento_bench query [entity count] [iterations]
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::strcmp(argv[1], "transform") == 0)
+	{
+		const size_t entityCount = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+		const int iterations = argc > 3 ? std::atoi(argv[3]) : 50;
+		return runTransformBench(entityCount, iterations);
+	}
+
+	if (argc > 1 && std::strcmp(argv[1], "query") == 0)
+	{
+		const size_t entityCount = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+		const int iterations = argc > 3 ? std::atoi(argv[3]) : 20;
+		return runQueryBench(entityCount, iterations);
+	}
+
+	FrameBenchOptions options;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const char* name = argv[i];
+		const char* value = argv[i + 1];
+
+		if (std::strcmp(name, "--entities") == 0) options.entities = std::strtoul(value, nullptr, 10);
+		else if (std::strcmp(name, "--meshes") == 0) options.meshes = std::strtoul(value, nullptr, 10);
+		else if (std::strcmp(name, "--frames") == 0) options.frames = std::strtoul(value, nullptr, 10);
+		else if (std::strcmp(name, "--warmup") == 0) options.warmup = std::strtoul(value, nullptr, 10);
+		else if (std::strcmp(name, "--width") == 0) options.width = std::strtoul(value, nullptr, 10);
+		else if (std::strcmp(name, "--height") == 0) options.height = std::strtoul(value, nullptr, 10);
+		else if (std::strcmp(name, "--seed") == 0) options.seed = std::strtoul(value, nullptr, 10);
+		else if (std::strcmp(name, "--prepass") == 0) options.depthPrepass = std::atoi(value) != 0;
+		else if (std::strcmp(name, "--output") == 0) options.output = value;
+		else if (std::strcmp(name, "--trace") == 0) options.trace = value;
+		else
+		{
+			std::fprintf(stderr, "unknown option %s\n", name);
+			return 1;
+		}
+	}
+
+	return runFrameBench(options);
+}
@@ -0,0 +1,135 @@
+#include "bench.h"
+
+#include <bento/ecs/SpatialIndex.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	double nanosecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	}
+
+	bento::AABB boxAt(const glm::vec3& center, float halfSize)
+	{
+		return bento::AABB(center - glm::vec3(halfSize), center + glm::vec3(halfSize));
+	}
+}
+
+int runQueryBench(size_t entityCount, int iterations)
+{
+	using bento::AABB;
+
+	// fixed seed so runs are comparable
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.25f, 1.0f);
+	// most steps stay inside the fat margin, a few leave it
+	std::uniform_real_distribution<float> step(-0.08f, 0.08f);
+
+	entt::registry registry;
+	std::vector<entt::entity> entities(entityCount);
+	std::vector<glm::vec3> centers(entityCount);
+	std::vector<float> halfSizes(entityCount);
+	std::vector<AABB> bounds(entityCount);
+
+	bento::SpatialIndex index;
+
+	auto start = Clock::now();
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		entities[i] = registry.create();
+		centers[i] = glm::vec3(position(random), position(random), position(random));
+		halfSizes[i] = size(random);
+		bounds[i] = boxAt(centers[i], halfSizes[i]);
+		index.insert(entities[i], bounds[i]);
+	}
+	const double insertTime = nanosecondsSince(start) / static_cast<double>(entityCount);
+
+	// every entity drifts each iteration, like a scene refitting after a step where everything moved
+	double updateTime = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		for (size_t e = 0; e < entityCount; e++)
+		{
+			centers[e] += glm::vec3(step(random), step(random), step(random));
+			bounds[e] = boxAt(centers[e], halfSizes[e]);
+		}
+
+		start = Clock::now();
+		for (size_t e = 0; e < entityCount; e++)
+		{
+			index.update(entities[e], bounds[e]);
+		}
+		updateTime += nanosecondsSince(start);
+	}
+	updateTime /= static_cast<double>(entityCount) * iterations;
+
+	// overlap queries, checked against a brute force pass over the exact bounds
+	const int queryCount = 1000;
+	std::vector<AABB> queries(queryCount);
+	for (auto& query : queries)
+	{
+		query = boxAt(glm::vec3(position(random), position(random), position(random)), 5.0f);
+	}
+
+	size_t found = 0;
+	double queryTime = 1e30;
+	for (int i = 0; i < iterations; i++)
+	{
+		found = 0;
+		start = Clock::now();
+		for (const AABB& query : queries)
+		{
+			index.queryOverlap(query, [&](entt::entity) { found++; });
+		}
+		queryTime = std::min(queryTime, nanosecondsSince(start));
+	}
+	queryTime /= queryCount;
+
+	size_t expected = 0;
+	for (const AABB& query : queries)
+	{
+		expected += std::count_if(bounds.begin(), bounds.end(), [&](const AABB& b) { return b.overlaps(query); });
+	}
+
+	// rays through the middle of the volume from random points on its edge
+	const int rayCount = 1000;
+	std::vector<bento::Ray> rays(rayCount);
+	for (auto& ray : rays)
+	{
+		ray.origin = glm::vec3(position(random), position(random), -120.0f);
+		ray.direction = glm::normalize(glm::vec3(position(random), position(random), 120.0f) - ray.origin);
+	}
+
+	size_t hits = 0;
+	double rayTime = 1e30;
+	for (int i = 0; i < iterations; i++)
+	{
+		hits = 0;
+		start = Clock::now();
+		for (const bento::Ray& ray : rays)
+		{
+			entt::entity hit;
+			float distance;
+			hits += index.raycast(ray, hit, distance) ? 1 : 0;
+		}
+		rayTime = std::min(rayTime, nanosecondsSince(start));
+	}
+	rayTime /= rayCount;
+
+	std::printf("entities: %zu, iterations: %d\n", entityCount, iterations);
+	std::printf("insert:      %.2f ns/entity\n", insertTime);
+	std::printf("update:      %.2f ns/entity\n", updateTime);
+	std::printf("overlap:     %.2f ns/query (%zu found, %zu expected)\n", queryTime, found, expected);
+	std::printf("raycast:     %.2f ns/ray (%zu hits)\n", rayTime, hits);
+
+	return found == expected ? 0 : 1;
+}
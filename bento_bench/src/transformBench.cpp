@@ -0,0 +1,85 @@
+#include "bench.h"
+
+#include <bento/ecs/Components.h>
+#include <bento/ecs/TransformSystem.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using ComposeFunction = void(*)(const bento::TranslationComponent*, const bento::RotationComponent*, const bento::ScaleComponent*, size_t, glm::mat4*);
+
+	// best of several runs, in nanoseconds per entity
+	double measure(ComposeFunction compose, entt::registry& registry, std::vector<glm::mat4>& destination, int iterations)
+	{
+		auto transforms = bento::TransformSystem::group(registry);
+		double best = 1e30;
+
+		for (int i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			compose(
+				transforms.raw<bento::TranslationComponent>(),
+				transforms.raw<bento::RotationComponent>(),
+				transforms.raw<bento::ScaleComponent>(),
+				transforms.size(),
+				destination.data()
+			);
+			auto end = std::chrono::high_resolution_clock::now();
+
+			best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+		}
+
+		return best / static_cast<double>(transforms.size());
+	}
+}
+
+int runTransformBench(size_t entityCount, int iterations)
+{
+	// fixed seed so runs are comparable
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+
+	entt::registry registry;
+	bento::TransformSystem::group(registry);
+
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		auto entity = registry.create();
+		registry.emplace<bento::TranslationComponent>(entity, glm::vec3(distribution(random), distribution(random), distribution(random)));
+		registry.emplace<bento::RotationComponent>(entity, glm::normalize(glm::quat(distribution(random), distribution(random), distribution(random), distribution(random))));
+		registry.emplace<bento::ScaleComponent>(entity, glm::vec3(distribution(random), distribution(random), distribution(random)));
+	}
+
+	std::vector<glm::mat4> naive(entityCount);
+	std::vector<glm::mat4> batched(entityCount);
+
+	const double naiveTime = measure(bento::TransformSystem::composeNaive, registry, naive, iterations);
+	const double batchedTime = measure(bento::TransformSystem::compose, registry, batched, iterations);
+
+	// both paths should agree to within float rounding
+	float maxError = 0.0f;
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				maxError = std::max(maxError, std::abs(naive[i][column][row] - batched[i][column][row]));
+			}
+		}
+	}
+
+	std::printf("entities: %zu, iterations: %d\n", entityCount, iterations);
+	std::printf("naive glm:   %.2f ns/entity\n", naiveTime);
+	std::printf("batched:     %.2f ns/entity (%.2fx)\n", batchedTime, naiveTime / batchedTime);
+	std::printf("max error:   %g\n", maxError);
+
+	return 0;
+}
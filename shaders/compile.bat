@@ -1,3 +1,5 @@
-E:/VS_Dev_Lib/VulkanSDK/1.2.148.1/Bin32/glslc.exe shader.vert -o vert.spv
-E:/VS_Dev_Lib/VulkanSDK/1.2.148.1/Bin32/glslc.exe shader.frag -o frag.spv
+E:/VS_Dev_Lib/VulkanSDK/1.2.198.1/Bin32/glslc.exe shader.vert -o vert.spv
+E:/VS_Dev_Lib/VulkanSDK/1.2.198.1/Bin32/glslc.exe shader.frag -o frag.spv
+E:/VS_Dev_Lib/VulkanSDK/1.2.198.1/Bin32/glslc.exe cluster.comp -o cluster.spv
+E:/VS_Dev_Lib/VulkanSDK/1.2.198.1/Bin32/glslc.exe shadow.vert -o shadow_vert.spv
 pause
\ No newline at end of file
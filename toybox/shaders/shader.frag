@@ -1,13 +1,133 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(set = 1, binding = 1) uniform sampler2D texSampler;
+// must match Renderer::MAX_LIGHTS_PER_CLUSTER and Renderer::SHADOW_CASCADES
+#define MAX_LIGHTS_PER_CLUSTER 256
+#define SHADOW_CASCADES 4
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 inverseProj;
+    vec4 screen;
+    uvec4 clusters;
+    vec4 lightDirection;
+    vec4 lightColor;
+    mat4 cascadeViewProj[SHADOW_CASCADES];
+    vec4 cascadeSplits;
+} ubo;
+
+struct Light {
+    vec4 positionRange;
+    vec4 colorIntensity;
+    vec4 directionCone;
+    vec4 spot;
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, set = 0, binding = 4) readonly buffer LightGrid {
+    uint lightCounts[];
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+layout(set = 0, binding = 6) uniform sampler2DArrayShadow shadowMap;
+
+layout(set = 0, binding = 2) uniform sampler2D texSampler;
+
+// per draw, must match DrawConstants; there is just texSampler so far, so material is always 0
+layout(push_constant) uniform Draw {
+    uint material;
+} draw;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragWorldPosition;
+layout(location = 3) in float fragViewDepth;
 
 layout(location = 0) out vec4 outColor;
 
+const float AMBIENT = 0.05;
+
+// how much of the directional light reaches the fragment, from the first cascade that covers it; 2x2 pcf through the comparison sampler
+float directionalShadow(vec3 normal) {
+    uint cascade = 0;
+    while (cascade < SHADOW_CASCADES - 1 && fragViewDepth > ubo.cascadeSplits[cascade]) {
+        cascade++;
+    }
+
+    // nudged along the normal against acne on surfaces at grazing angles
+    vec4 position = ubo.cascadeViewProj[cascade] * vec4(fragWorldPosition + normal * 0.01, 1.0);
+    vec3 coordinates = position.xyz / position.w;
+    vec2 uv = coordinates.xy * 0.5 + 0.5;
+    if (coordinates.z > 1.0) {
+        return 1.0;
+    }
+
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int x = 0; x < 2; x++) {
+        for (int y = 0; y < 2; y++) {
+            lit += texture(shadowMap, vec4(uv + (vec2(x, y) - 0.5) * texel, float(cascade), coordinates.z));
+        }
+    }
+    return lit * 0.25;
+}
+
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
-}
\ No newline at end of file
+    vec4 albedo = texture(texSampler, fragTexCoord);
+
+    // scenes without lights are drawn unlit
+    if (ubo.clusters.w == 0 && ubo.lightDirection.w == 0.0) {
+        outColor = albedo;
+        return;
+    }
+
+    // the cluster this fragment falls in; the same split the light culling pass uses
+    uvec3 size = ubo.clusters.xyz;
+    float nearPlane = ubo.screen.z;
+    float farPlane = ubo.screen.w;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / ubo.screen.xy * vec2(size.xy)), size.xy - 1);
+    uint slice = uint(clamp(log(fragViewDepth / nearPlane) / log(farPlane / nearPlane) * float(size.z), 0.0, float(size.z - 1)));
+    uint cluster = (slice * size.y + tile.y) * size.x + tile.x;
+
+    // there are no vertex normals, so shade the faces flat
+    vec3 normal = normalize(cross(dFdx(fragWorldPosition), dFdy(fragWorldPosition)));
+
+    vec3 lighting = vec3(AMBIENT);
+
+    if (ubo.lightDirection.w != 0.0) {
+        // lit from whichever side faces the light, like the point lights below
+        vec3 normalTowardsLight = dot(normal, ubo.lightDirection.xyz) > 0.0 ? -normal : normal;
+        float diffuse = max(dot(normalTowardsLight, -ubo.lightDirection.xyz), 0.0);
+        lighting += ubo.lightColor.rgb * ubo.lightColor.a * diffuse * directionalShadow(normalTowardsLight);
+    }
+
+    uint count = lightCounts[cluster];
+    for (uint i = 0; i < count; i++) {
+        Light light = lights[lightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i]];
+
+        vec3 toLight = light.positionRange.xyz - fragWorldPosition;
+        float distance = length(toLight);
+        vec3 direction = toLight / max(distance, 0.0001);
+
+        // smooth falloff that reaches zero at the light's range
+        float fade = clamp(1.0 - pow(distance / light.positionRange.w, 4.0), 0.0, 1.0);
+        float attenuation = fade * fade / (distance * distance + 1.0);
+
+        // point lights have cone cosines below -1, so they are never outside it
+        float cone = smoothstep(light.directionCone.w, max(light.spot.x, light.directionCone.w + 0.0001), dot(-direction, light.directionCone.xyz));
+
+        // faces are lit from whichever side the light is on, since the flat normal's winding isn't known
+        float diffuse = abs(dot(normal, direction));
+
+        lighting += light.colorIntensity.rgb * light.colorIntensity.a * diffuse * attenuation * cone;
+    }
+
+    outColor = vec4(albedo.rgb * lighting, albedo.a);
+}
@@ -5,12 +5,19 @@ layout(set = 0, binding = 0) uniform UniformBufferObject {
     //mat4 model;
     mat4 view;
     mat4 proj;
+    mat4 inverseProj;
+    vec4 screen;
+    uvec4 clusters;
 } ubo;
 
-layout(set = 1, binding = 0) uniform TransformationUBO {
-    mat4 model;
-} transform;
-//layout(set = 1, binding = 0) uniform mat4 model;
+// the frame's world matrices, and the entries of each instanced draw; gl_InstanceIndex starts at the draw's first entry
+layout(std430, set = 1, binding = 0) readonly buffer Instances {
+    mat4 instances[];
+};
+
+layout(std430, set = 1, binding = 1) readonly buffer DrawInstances {
+    uint drawInstances[];
+};
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
@@ -18,9 +25,18 @@ layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragWorldPosition;
+layout(location = 3) out float fragViewDepth;
+
+// the depth prepass runs this same shader; the main pass after it tests for equal depth, so both have to compute it identically
+invariant gl_Position;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * transform.model * vec4(inPosition, 1.0);
+    vec4 worldPosition = instances[drawInstances[gl_InstanceIndex]] * vec4(inPosition, 1.0);
+    vec4 viewPosition = ubo.view * worldPosition;
+    gl_Position = ubo.proj * viewPosition;
     fragColor = inColor;
     fragTexCoord = inTexCoord;
-}
\ No newline at end of file
+    fragWorldPosition = worldPosition.xyz;
+    fragViewDepth = -viewPosition.z;
+}
@@ -0,0 +1,22 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// depth only; one instanced draw per mesh and cascade. gl_InstanceIndex starts at the batch's first caster's entry
+
+layout(push_constant) uniform Cascade {
+    mat4 viewProj;
+} cascade;
+
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    mat4 instances[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer DrawInstances {
+    uint drawInstances[];
+};
+
+layout(location = 0) in vec3 inPosition;
+
+void main() {
+    gl_Position = cascade.viewProj * instances[drawInstances[gl_InstanceIndex]] * vec4(inPosition, 1.0);
+}
@@ -1,4 +1,5 @@
 #include <bento.h>
+#include <optional>
 
 class toyboxState : public bento::state
 {
@@ -12,28 +13,63 @@ public:
 
 	void start() override
 	{
-		bento::log::info("state start"); // is this right?
+		BENTO_LOG_INFO("state start"); // is this right?
+
+		// entities refer to meshes by content, so the meshes have to be loaded first
+		auto& meshes = bento::application::get().getRenderer().meshFactory;
+		const uint64_t planeMesh = meshes.get(meshes.create(Plane::vertices, Plane::indices))->getContentHash();
+		const uint64_t quadMesh = meshes.get(meshes.create(Quad::vertices, Quad::indices))->getContentHash();
 
 		auto entity = scene->CreateEntity("new entity");
 
 		//entity.AddComponent<bento::TransformComponent>(glm::mat4(1.0f));
-		entity.AddComponent<bento::MeshComponent>(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+		entity.GetComponent<bento::TranslationComponent>().translation = glm::vec3(1.0f, 0.0f, 0.0f);
+		entity.AddComponent<bento::MeshComponent>(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), planeMesh);
+		// never moves, so its shadows are cached
+		entity.AddComponent<bento::StaticComponent>();
+
+		// spun every update
+		quad = scene->CreateEntity("quad");
+		quad->AddComponent<bento::MeshComponent>(glm::vec4(1.0f), quadMesh);
+
+		// a dim sun from above at an angle, casting shadows
+		auto sun = scene->CreateEntity("sun");
+		sun.GetComponent<bento::RotationComponent>().rotation = glm::angleAxis(0.6f, glm::vec3(1.0f, 0.0f, 0.0f));
+		auto& sunLight = sun.AddComponent<bento::LightComponent>(glm::vec3(1.0f, 0.95f, 0.85f), 0.6f, 0.0f);
+		sunLight.type = bento::LightComponent::Type::Directional;
+
+		// a ring of colored point lights around it
+		const int lightCount = 64;
+		for (int i = 0; i < lightCount; i++)
+		{
+			const float angle = 6.2831853f * static_cast<float>(i) / static_cast<float>(lightCount);
+
+			auto light = scene->CreateEntity("light");
+			light.GetComponent<bento::TranslationComponent>().translation = glm::vec3(std::cos(angle) * 1.5f, std::sin(angle) * 1.5f, 0.5f);
+			light.AddComponent<bento::LightComponent>(glm::vec3(0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::sin(angle), 1.0f), 2.0f, 1.5f);
+		}
 	}
 
-	void update() override
+	void update(float delta) override
 	{
-		//bento::log::info("state update");
+		//BENTO_LOG_INFO("state update");
+		spin += delta;
+		const glm::quat rotation = glm::angleAxis(spin * glm::radians(90.0f), glm::normalize(glm::vec3(0.5f, 0.0f, 1.0f)));
+		quad->PatchComponent<bento::RotationComponent>([&](bento::RotationComponent& r) { r.rotation = rotation; });
+
 		scene->OnUpdate();
 	}
 
-	void render() override
+	void render(float alpha) override
 	{
-		//bento::log::info("state render");
-		scene->OnRender();
+		//BENTO_LOG_INFO("state render");
+		scene->OnRender(bento::application::get().getRenderer(), alpha);
 	}
 
 private:
 	std::shared_ptr<bento::Scene> scene;
+	std::optional<bento::Entity> quad;
+	float spin = 0.0f;
 };
 
 class toybox : public bento::application
@@ -43,6 +79,9 @@ public:
 	{
 		state = new toyboxState();
 		pushState(state);
+
+		// clamped to what the device can do
+		getRenderer().setSampleCount(vk::SampleCountFlagBits::e4);
 	}
 
 	~toybox()